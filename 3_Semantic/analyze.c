@@ -11,6 +11,7 @@
 #include "symtab.h"
 #include "analyze.h"
 #include "util.h"
+#include "outbuf.h"
 
 /* counter for variable memory locations */
 int function_decl;
@@ -22,7 +23,8 @@ int function_decl;
  */
 
 static void semanticError(TreeNode * t, char * message)
-{ fprintf(listing,"Semantic error at line %d: %s\n",t->lineno,message);
+{ outFlush();
+  fprintf(listing,"Semantic error at line %d: %s\n",t->lineno,message);
   Error = TRUE;
 }
 
@@ -346,3 +348,63 @@ static void checkNode(ScopeList scope, TreeNode* t)
 void typeCheck(TreeNode * syntaxTree)
 { traverse(tree, syntaxTree, 0, nullProc, checkNode);
 }
+
+/* the function whose body markNode is in, or NULL
+ * outside functions; changed tells if markNode set
+ * a used field
+ */
+static BucketList markFunction;
+static int changed;
+
+/* markUsed sets the used field of l */
+static void markUsed(BucketList l)
+{ if ((l != NULL) && !l->used)
+  { l->used = TRUE;
+    changed = TRUE;
+  }
+}
+
+/* Procedure markNode marks what node t references
+ * if it is in the body of a used function
+ */
+static void markNode(ScopeList scope, TreeNode * t)
+{ BucketList l;
+  if (t->nodekind == StmtK)
+  { if (t->kind.stmt == FunDeclK)
+      markFunction = st_lookup_now(tree,t->attr.name);
+    else if ((t->kind.stmt == VarDeclK) && (scope == tree))
+      markFunction = NULL;
+    else if ((t->kind.stmt == CallK) && (markFunction != NULL) &&
+             markFunction->used)
+      markUsed(st_lookup_now(tree,t->attr.name));
+  }
+  else if ((t->kind.exp == IdK) && (markFunction != NULL) &&
+           markFunction->used)
+  { l = st_lookup(scope,t->attr.name);
+    if (l == st_lookup_now(tree,t->attr.name)) markUsed(l);
+  }
+}
+
+/* Procedure markReachable sets the used field of
+ * the functions reachable from main through calls
+ * and of the globals they reference. The tree is
+ * walked again as long as that finds more; without
+ * a main everything is used
+ */
+void markReachable(TreeNode * syntaxTree)
+{ BucketList l = st_lookup_now(tree,"main");
+  int i;
+  if ((l == NULL) || (l->type.sym != Function))
+  { for (i=0;i<SIZE;i++)
+      for (l=tree->hashTable[i];l != NULL;l=l->next) l->used = TRUE;
+    return;
+  }
+  l->used = TRUE;
+  changed = TRUE;
+  while (changed)
+  { changed = FALSE;
+    markFunction = NULL;
+    tree->visit = 0;
+    traverse(tree, syntaxTree, 0, markNode, nullProc);
+  }
+}
@@ -18,4 +18,11 @@ void buildSymtab(TreeNode *);
  */
 void typeCheck(TreeNode *);
 
+/* Procedure markReachable sets the used field of
+ * the functions reachable from main through calls
+ * and of the globals they reference; the code
+ * generators leave out the others
+ */
+void markReachable(TreeNode *);
+
 #endif
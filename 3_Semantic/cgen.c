@@ -1,7 +1,7 @@
 /****************************************************/
 /* File: cgen.c                                     */
 /* The code generator implementation                */
-/* for the TINY compiler                            */
+/* for the C-MINUS compiler                         */
 /* (generates code for the TM machine)              */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
@@ -10,7 +10,33 @@
 #include "globals.h"
 #include "symtab.h"
 #include "code.h"
+#include "peep.h"
 #include "cgen.h"
+#include "stack.h"
+
+/* Runtime organization:
+ *
+ * Global variables live at the bottom of memory,
+ * addressed from gp (which stays 0). Each call gets
+ * an activation record at the top of memory, growing
+ * downward and addressed from fp:
+ *
+ *    0(fp)      the caller's fp
+ *   -1(fp)      the return address
+ *   -2-i(fp)    parameter i
+ *   below that  the locals of all blocks of the
+ *               function, then the temporaries
+ *
+ * An array parameter holds the address of the
+ * array's first element; the elements of an array
+ * variable are at increasing addresses. Functions
+ * return their value in ac.
+ *
+ * The symbol table scopes are entered in the same
+ * order as by the traversal in analyze.c. Since the
+ * global scope is called tree, syntax tree nodes are
+ * called t here.
+ */
 
 /* tmpOffset is the memory offset for temps
    It is decremented each time a temp is
@@ -18,115 +44,421 @@
 */
 static int tmpOffset = 0;
 
-/* prototype for internal recursive code generator */
-static void cGen (TreeNode * tree);
+/* the lowest offset used by the frame of the
+ * current function, for the stack analysis
+ */
+static int frameLow = 0;
+
+/* offset of the next global and of the next
+ * local variable of the current function
+ */
+static int globalOffset = 0;
+static int localOffset = 0;
+
+/* the scope the code being generated is in */
+static ScopeList curScope;
+static int functionBody = FALSE;
+
+/* entry label of main, jumped to by the prelude */
+static int mainLabel;
+
+/* the function the code being generated is in, and
+ * whether its calls to itself in a return may reuse
+ * its frame
+ */
+static BucketList curFunction;
+static int tailCalls;
+
+/* prototypes for internal recursive code generator */
+static void cGen (TreeNode * t);
+static void genNode (TreeNode * t);
+
+/* varSize returns the number of memory words
+ * of the variable declared by t
+ */
+static int varSize( TreeNode * t )
+{ if (t->child[0] != NULL) return t->child[0]->attr.val;
+  return 1;
+}
+
+/* localSize returns the number of memory words
+ * needed by the variables declared in the tree t.
+ * Blocks side by side share the same words, so it
+ * is the most words declared by blocks nested in
+ * one another
+ */
+static int localSize( TreeNode * t )
+{ int size = 0, inner = 0, n, i;
+  for (;t != NULL;t = t->sibling)
+  { if ((t->nodekind == StmtK) && (t->kind.stmt == VarDeclK))
+      size += varSize(t);
+    else
+    { if ((t->nodekind == StmtK) && (t->kind.stmt == CompoundK))
+        n = localSize(t->child[0]) + localSize(t->child[1]);
+      else
+        for (i=0,n=0;i<MAXCHILDREN;i++)
+          if (localSize(t->child[i]) > n) n = localSize(t->child[i]);
+      if (n > inner) inner = n;
+    }
+  }
+  return size + inner;
+}
+
+/* hasLocalArray tells if an array variable is
+ * declared in the tree t
+ */
+static int hasLocalArray( TreeNode * t )
+{ int i;
+  for (;t != NULL;t = t->sibling)
+  { if ((t->nodekind == StmtK) && (t->kind.stmt == VarDeclK))
+    { if (t->child[0] != NULL) return TRUE;
+    }
+    else
+      for (i=0;i<MAXCHILDREN;i++)
+        if (hasLocalArray(t->child[i])) return TRUE;
+  }
+  return FALSE;
+}
+
+/* baseReg returns the register the offset
+ * of variable l is relative to
+ */
+static int baseReg( BucketList l )
+{ return (st_lookup_now(tree,l->name) == l) ? gp : fp; }
+
+/* pushTemp returns the offset of a new temp */
+static int pushTemp( void )
+{ if (tmpOffset < frameLow) frameLow = tmpOffset;
+  return tmpOffset--;
+}
+
+/* genAddress generates code to put the address of
+ * the first element of array l into register r
+ */
+static void genAddress( BucketList l, int r )
+{ if (l->type.sym == Argument)
+    emitRM("LD",r,l->offset,fp,"load array address");
+  else
+    emitRM("LDA",r,l->offset,baseReg(l),"compute array address");
+}
+
+/* genCall generates code at a call node */
+static void genCall( TreeNode * t )
+{ TreeNode * p;
+  BucketList l;
+  int base, i;
+  if (strcmp(t->attr.name,"input") == 0)
+  { emitRO("IN",ac,0,0,"read integer value");
+    return;
+  }
+  if (strcmp(t->attr.name,"output") == 0)
+  { cGen(t->child[0]);
+    emitRO("OUT",ac,0,0,"write ac");
+    return;
+  }
+  if (TraceCode) emitComment("-> call") ;
+  l = st_lookup(tree,t->attr.name);
+  /* the new frame starts at the first free temp;
+     its parameter slots are reserved first so that
+     temps used by the arguments go below them */
+  base = tmpOffset;
+  for (p=t->child[0],i=0;p != NULL;p=p->sibling) i++;
+  tmpOffset -= 2 + i;
+  for (p=t->child[0],i=0;p != NULL;p=p->sibling,i++)
+  { genNode(p);
+    emitRM("ST",ac,base-2-i,fp,"call: store argument");
+  }
+  emitRM("ST",fp,base,fp,"call: store old fp");
+  emitRM("LDA",fp,base,fp,"call: push frame");
+  emitRM("LDA",ac,2,pc,"call: compute return address");
+  emitRM("ST",ac,-1,fp,"call: store return address");
+  emitRM_Label("LDA",pc,l->offset,"call: jump to function");
+  stackCall(t->attr.name,base);
+  emitRM("LD",fp,0,fp,"call: pop frame");
+  tmpOffset = base;
+  if (TraceCode)  emitComment("<- call") ;
+}
+
+/* isTailCall tells if the returned expression t is
+ * a call of the current function to itself that
+ * can reuse its frame. It cannot when the function
+ * has local arrays, whose address might be passed
+ */
+static int isTailCall( TreeNode * t )
+{ return tailCalls && (t->nodekind == StmtK) && (t->kind.stmt == CallK) &&
+         (strcmp(t->attr.name,curFunction->name) == 0);
+}
+
+/* genTailCall generates code for the call t in
+ * isTailCall: the arguments are computed into temps,
+ * copied over the parameters, and the function is
+ * entered again in the same frame
+ */
+static void genTailCall( TreeNode * t )
+{ TreeNode * p;
+  int base = tmpOffset, n, i;
+  if (TraceCode) emitComment("-> tail call") ;
+  for (p=t->child[0],n=0;p != NULL;p=p->sibling) n++;
+  tmpOffset -= n;
+  if (tmpOffset+1 < frameLow) frameLow = tmpOffset+1;
+  for (p=t->child[0],i=0;p != NULL;p=p->sibling,i++)
+  { genNode(p);
+    /* the last one stays in ac */
+    if (i < n-1) emitRM("ST",ac,base-i,fp,"tail call: store argument");
+  }
+  for (i=n-1;i>=0;i--)
+  { if (i < n-1) emitRM("LD",ac,base-i,fp,"tail call: load argument");
+    emitRM("ST",ac,-2-i,fp,"tail call: store parameter");
+  }
+  tmpOffset = base;
+  emitRM_Label("LDA",pc,curFunction->offset,"tail call: jump to function");
+  if (TraceCode)  emitComment("<- tail call") ;
+}
+
+/* falseJump returns the jump taken when the
+ * comparison t is false, or NULL if t is not
+ * a comparison
+ */
+static char * falseJump( TreeNode * t )
+{ if ((t->nodekind != ExpK) || (t->kind.exp != OpK)) return NULL;
+  switch (t->attr.op) {
+    case LT : return "JGE";
+    case LE : return "JGT";
+    case GT : return "JLE";
+    case GE : return "JLT";
+    case EQ : return "JNE";
+    case NE : return "JEQ";
+    default : return NULL;
+  }
+}
+
+/* genCond generates code for the test t of an if or
+ * while statement that jumps to label when t is
+ * false. A comparison jumps on the opposite
+ * condition directly instead of computing 0 or 1
+ */
+static void genCond( TreeNode * t, int label )
+{ char * op = falseJump(t);
+  if (op == NULL)
+  { cGen(t);
+    emitRM_Label("JEQ",ac,label,"cond: jmp if false");
+    return;
+  }
+  if (TraceCode) emitComment("-> cond") ;
+  emitLine(t->lineno);
+  cGen(t->child[0]);
+  emitRM_Temp("ST",ac,pushTemp(),fp,"cond: push left");
+  cGen(t->child[1]);
+  emitRM_Temp("LD",ac1,++tmpOffset,fp,"cond: load left");
+  emitRO("SUB",ac,ac1,ac,"cond: compare");
+  emitRM_Label(op,ac,label,"cond: jmp if false");
+  if (TraceCode)  emitComment("<- cond") ;
+}
+
+/* genFunction generates code at a function
+ * declaration node
+ */
+static void genFunction( TreeNode * t )
+{ BucketList l = st_lookup_now(tree,t->attr.name);
+  TreeNode * p;
+  int i;
+  if (!l->used)
+  { if (TraceCode)
+    { emitComment("function not reachable from main:");
+      emitComment(t->attr.name);
+    }
+    tree->visit++;
+    return;
+  }
+  if (TraceCode) emitComment("-> function") ;
+  if (strcmp(t->attr.name,"main") == 0) l->offset = mainLabel;
+  else l->offset = newLabel();
+  curScope = tree->child[tree->visit++];
+  curScope->visit = 0;
+  functionBody = TRUE;
+  for (p=t->child[0],i=0;p != NULL;p=p->sibling)
+    if (p->kind.stmt == ParamK)
+      st_lookup_now(curScope,p->attr.name)->offset = -2 - i++;
+  localOffset = -2 - i;
+  tmpOffset = localOffset - localSize(t->child[1]);
+  frameLow = tmpOffset + 1;
+  stackFunction(t->attr.name);
+  curFunction = l;
+  tailCalls = !hasLocalArray(t->child[1]);
+  emitLabel(l->offset);
+  cGen(t->child[1]);
+  emitRM("LD",pc,-1,fp,"return to caller");
+  stackFrame(1 - frameLow);
+  curScope = tree;
+  if (TraceCode)  emitComment("<- function") ;
+}
 
 /* Procedure genStmt generates code at a statement node */
-static void genStmt( TreeNode * tree)
+static void genStmt( TreeNode * t)
 { TreeNode * p1, * p2, * p3;
-  int savedLoc1,savedLoc2,currentLoc;
-  int loc;
-  switch (tree->kind.stmt) {
+  ScopeList savedScope;
+  BucketList l;
+  int label1, label2, savedOffset;
+  switch (t->kind.stmt) {
+
+      case VarDeclK :
+         l = st_lookup_now(curScope,t->attr.name);
+         if (curScope == tree)
+         { if (!l->used) break;
+           l->offset = globalOffset;
+           globalOffset += varSize(t);
+         }
+         else
+         { localOffset -= varSize(t);
+           l->offset = localOffset + 1;
+         }
+         break; /* VarDeclK */
+
+      case FunDeclK :
+         genFunction(t);
+         break; /* FunDeclK */
+
+      case CompoundK :
+         savedScope = curScope;
+         savedOffset = localOffset;
+         /* the body of a function shares its scope */
+         if (functionBody) functionBody = FALSE;
+         else
+         { curScope = curScope->child[curScope->visit++];
+           curScope->visit = 0;
+         }
+         cGen(t->child[0]);
+         cGen(t->child[1]);
+         curScope = savedScope;
+         /* the next block reuses the words of this one */
+         localOffset = savedOffset;
+         break; /* CompoundK */
 
       case IfK :
+      case IfElseK :
          if (TraceCode) emitComment("-> if") ;
-         p1 = tree->child[0] ;
-         p2 = tree->child[1] ;
-         p3 = tree->child[2] ;
+         p1 = t->child[0] ;
+         p2 = t->child[1] ;
+         p3 = t->child[2] ;
+         label1 = newLabel();
+         label2 = newLabel();
          /* generate code for test expression */
-         cGen(p1);
-         savedLoc1 = emitSkip(1) ;
-         emitComment("if: jump to else belongs here");
+         genCond(p1,label1);
          /* recurse on then part */
          cGen(p2);
-         savedLoc2 = emitSkip(1) ;
-         emitComment("if: jump to end belongs here");
-         currentLoc = emitSkip(0) ;
-         emitBackup(savedLoc1) ;
-         emitRM_Abs("JEQ",ac,currentLoc,"if: jmp to else");
-         emitRestore() ;
+         if (t->kind.stmt == IfElseK)
+           emitRM_Label("LDA",pc,label2,"jmp to end");
+         emitLabel(label1);
          /* recurse on else part */
          cGen(p3);
-         currentLoc = emitSkip(0) ;
-         emitBackup(savedLoc2) ;
-         emitRM_Abs("LDA",pc,currentLoc,"jmp to end") ;
-         emitRestore() ;
+         emitLabel(label2);
          if (TraceCode)  emitComment("<- if") ;
          break; /* if_k */
 
-      case RepeatK:
-         if (TraceCode) emitComment("-> repeat") ;
-         p1 = tree->child[0] ;
-         p2 = tree->child[1] ;
-         savedLoc1 = emitSkip(0);
-         emitComment("repeat: jump after body comes back here");
-         /* generate code for body */
-         cGen(p1);
+      case WhileK:
+         if (TraceCode) emitComment("-> while") ;
+         p1 = t->child[0] ;
+         p2 = t->child[1] ;
+         label1 = newLabel();
+         label2 = newLabel();
+         emitLabel(label1);
          /* generate code for test */
+         genCond(p1,label2);
+         /* generate code for body */
          cGen(p2);
-         emitRM_Abs("JEQ",ac,savedLoc1,"repeat: jmp back to body");
-         if (TraceCode)  emitComment("<- repeat") ;
-         break; /* repeat */
+         emitRM_Label("LDA",pc,label1,"while: jmp back to test");
+         emitLabel(label2);
+         if (TraceCode)  emitComment("<- while") ;
+         break; /* while */
+
+      case ReturnK:
+         if (isTailCall(t->child[0]))
+         { genTailCall(t->child[0]);
+           break;
+         }
+         cGen(t->child[0]);
+         emitRM("LD",pc,-1,fp,"return to caller");
+         break;
+
+      case NReturnK:
+         emitRM("LD",pc,-1,fp,"return to caller");
+         break;
 
       case AssignK:
          if (TraceCode) emitComment("-> assign") ;
-         /* generate code for rhs */
-         cGen(tree->child[0]);
-         /* now store value */
-         loc = st_lookup(tree->attr.name);
-         emitRM("ST",ac,loc,gp,"assign: store value");
+         p1 = t->child[0] ;
+         l = st_lookup(curScope,p1->attr.name);
+         if (p1->child[0] == NULL)
+         { /* generate code for rhs */
+           cGen(t->child[1]);
+           /* now store value */
+           emitRM("ST",ac,l->offset,baseReg(l),"assign: store value");
+         }
+         else
+         { /* compute the element address first */
+           cGen(p1->child[0]);
+           genAddress(l,ac1);
+           emitRO("ADD",ac,ac1,ac,"assign: element address");
+           emitRM_Temp("ST",ac,pushTemp(),fp,"assign: push address");
+           cGen(t->child[1]);
+           emitRM_Temp("LD",ac1,++tmpOffset,fp,"assign: load address");
+           emitRM("ST",ac,0,ac1,"assign: store value");
+         }
          if (TraceCode)  emitComment("<- assign") ;
          break; /* assign_k */
 
-      case ReadK:
-         emitRO("IN",ac,0,0,"read integer value");
-         loc = st_lookup(tree->attr.name);
-         emitRM("ST",ac,loc,gp,"read: store value");
-         break;
-      case WriteK:
-         /* generate code for expression to write */
-         cGen(tree->child[0]);
-         /* now output it */
-         emitRO("OUT",ac,0,0,"write ac");
+      case CallK:
+         genCall(t);
          break;
+
       default:
          break;
     }
 } /* genStmt */
 
 /* Procedure genExp generates code at an expression node */
-static void genExp( TreeNode * tree)
-{ int loc;
+static void genExp( TreeNode * t)
+{ BucketList l;
   TreeNode * p1, * p2;
-  switch (tree->kind.exp) {
+  switch (t->kind.exp) {
 
     case ConstK :
       if (TraceCode) emitComment("-> Const") ;
       /* gen code to load integer constant using LDC */
-      emitRM("LDC",ac,tree->attr.val,0,"load const");
+      emitRM("LDC",ac,t->attr.val,0,"load const");
       if (TraceCode)  emitComment("<- Const") ;
       break; /* ConstK */
-    
+
     case IdK :
       if (TraceCode) emitComment("-> Id") ;
-      loc = st_lookup(tree->attr.name);
-      emitRM("LD",ac,loc,gp,"load id value");
+      l = st_lookup(curScope,t->attr.name);
+      if (l->type.ret != IntegerPtr)
+        emitRM("LD",ac,l->offset,baseReg(l),"load id value");
+      else if (t->child[0] == NULL)
+        /* a whole array is passed by address */
+        genAddress(l,ac);
+      else
+      { cGen(t->child[0]);
+        genAddress(l,ac1);
+        emitRO("ADD",ac,ac1,ac,"element address");
+        emitRM("LD",ac,0,ac,"load element value");
+      }
       if (TraceCode)  emitComment("<- Id") ;
       break; /* IdK */
 
     case OpK :
          if (TraceCode) emitComment("-> Op") ;
-         p1 = tree->child[0];
-         p2 = tree->child[1];
+         p1 = t->child[0];
+         p2 = t->child[1];
          /* gen code for ac = left arg */
          cGen(p1);
          /* gen code to push left operand */
-         emitRM("ST",ac,tmpOffset--,mp,"op: push left");
+         emitRM_Temp("ST",ac,pushTemp(),fp,"op: push left");
          /* gen code for ac = right operand */
          cGen(p2);
          /* now load left operand */
-         emitRM("LD",ac1,++tmpOffset,mp,"op: load left");
-         switch (tree->attr.op) {
+         emitRM_Temp("LD",ac1,++tmpOffset,fp,"op: load left");
+         switch (t->attr.op) {
             case PLUS :
                emitRO("ADD",ac,ac1,ac,"op +");
                break;
@@ -140,15 +472,20 @@ static void genExp( TreeNode * tree)
                emitRO("DIV",ac,ac1,ac,"op /");
                break;
             case LT :
-               emitRO("SUB",ac,ac1,ac,"op <") ;
-               emitRM("JLT",ac,2,pc,"br if true") ;
-               emitRM("LDC",ac,0,ac,"false case") ;
-               emitRM("LDA",pc,1,pc,"unconditional jmp") ;
-               emitRM("LDC",ac,1,ac,"true case") ;
-               break;
+            case LE :
+            case GT :
+            case GE :
             case EQ :
-               emitRO("SUB",ac,ac1,ac,"op ==") ;
-               emitRM("JEQ",ac,2,pc,"br if true");
+            case NE :
+               emitRO("SUB",ac,ac1,ac,"op relational") ;
+               switch (t->attr.op) {
+                  case LT : emitRM("JLT",ac,2,pc,"br if true") ; break;
+                  case LE : emitRM("JLE",ac,2,pc,"br if true") ; break;
+                  case GT : emitRM("JGT",ac,2,pc,"br if true") ; break;
+                  case GE : emitRM("JGE",ac,2,pc,"br if true") ; break;
+                  case EQ : emitRM("JEQ",ac,2,pc,"br if true") ; break;
+                  default : emitRM("JNE",ac,2,pc,"br if true") ; break;
+               }
                emitRM("LDC",ac,0,ac,"false case") ;
                emitRM("LDA",pc,1,pc,"unconditional jmp") ;
                emitRM("LDC",ac,1,ac,"true case") ;
@@ -165,25 +502,50 @@ static void genExp( TreeNode * tree)
   }
 } /* genExp */
 
+/* Procedure genNode generates code at the single
+ * node t, without its siblings
+ */
+static void genNode( TreeNode * t )
+{ emitLine(t->lineno);
+  switch (t->nodekind) {
+    case StmtK:
+      genStmt(t);
+      break;
+    case ExpK:
+      genExp(t);
+      break;
+    default:
+      break;
+  }
+}
+
 /* Procedure cGen recursively generates code by
  * tree traversal
  */
-static void cGen( TreeNode * tree)
-{ if (tree != NULL)
-  { switch (tree->nodekind) {
-      case StmtK:
-        genStmt(tree);
-        break;
-      case ExpK:
-        genExp(tree);
-        break;
-      default:
-        break;
-    }
-    cGen(tree->sibling);
+static void cGen( TreeNode * t)
+{ while (t != NULL)
+  { genNode(t);
+    t = t->sibling;
   }
 }
 
+/* Procedure genPrelude generates the standard
+ * prelude, which calls the function at label entry
+ * and halts when it returns
+ */
+void genPrelude( int entry )
+{  emitComment("Standard prelude:");
+   emitRM("LD",mp,0,ac,"load maxaddress from location 0");
+   emitRM("ST",ac,0,ac,"clear location 0");
+   emitRM("LDA",fp,0,mp,"set up the frame of main");
+   emitRM("LDA",ac,2,pc,"compute return address");
+   emitRM("ST",ac,-1,fp,"store return address");
+   emitRM_Label("LDA",pc,entry,"jump to main");
+   emitComment("End of execution.");
+   emitRO("HALT",0,0,0,"");
+   emitComment("End of standard prelude.");
+}
+
 /**********************************************/
 /* the primary function of the code generator */
 /**********************************************/
@@ -197,16 +559,21 @@ void codeGen(TreeNode * syntaxTree, char * codefile)
 {  char * s = malloc(strlen(codefile)+7);
    strcpy(s,"File: ");
    strcat(s,codefile);
-   emitComment("TINY Compilation to TM Code");
+   emitComment("C-MINUS Compilation to TM Code");
    emitComment(s);
-   /* generate standard prelude */
-   emitComment("Standard prelude:");
-   emitRM("LD",mp,0,ac,"load maxaddress from location 0");
-   emitRM("ST",ac,0,ac,"clear location 0");
-   emitComment("End of standard prelude.");
-   /* generate code for TINY program */
+   free(s);
+   mainLabel = newLabel();
+   genPrelude(mainLabel);
+   /* generate code for C-MINUS program */
+   curScope = tree;
+   tree->visit = 0;
    cGen(syntaxTree);
-   /* finish */
-   emitComment("End of execution.");
-   emitRO("HALT",0,0,0,"");
+   if (labelLoc(mainLabel) < 0)
+   { fprintf(listing,"Code generation error: no main function\n");
+     Error = TRUE;
+     return;
+   }
+   stackGlobals(globalOffset);
+   if (Optimize) peephole();
+   writeCode(code,TmFormat);
 }
@@ -16,4 +16,11 @@
  */
 void codeGen(TreeNode * syntaxTree, char * codefile);
 
+/* Procedure genPrelude generates the standard
+ * prelude, which sets up the frame of main, calls
+ * the function at label entry and halts when it
+ * returns
+ */
+void genPrelude( int entry );
+
 #endif
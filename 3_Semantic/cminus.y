@@ -11,18 +11,23 @@
 #include "util.h"
 #include "scan.h"
 #include "parse.h"
+#include "token.h"
+#include "outbuf.h"
 
-#define YYSTYPE TreeNode *
-static char * savedName; /* for use in assignments */
-static int savedLineNo;  /* ditto */
-static int savedNum;
 static TreeNode * savedTree; /* stores syntax tree for later return */
 static int yylex(void); // added 11/2/11 to ensure no conflict with lex
 
 %}
 
+/* ID and NUM carry the index of their token in the
+ * token buffer, so their lexeme and line are read
+ * back from there when the rule is reduced
+ */
+%union { struct treeNode * node;
+         int tok; }
+
 %token IF ELSE WHILE RETURN INT VOID
-%token ID NUM 
+%token <tok> ID NUM 
 %token ASSIGN EQ NE LT LE GT GE PLUS MINUS TIMES OVER LPAREN RPAREN LBRACE RBRACE LCURLY RCURLY SEMI COMMA
 %token ERROR 
 
@@ -33,13 +38,20 @@ static int yylex(void); // added 11/2/11 to ensure no conflict with lex
 %nonassoc REDUCE
 %nonassoc ELSE
 
+%type <node> program declaration_list declaration var_declaration
+%type <node> type_specifier fun_declaration params param_list param
+%type <node> compound_stmt local_declarations statement_list statement
+%type <node> expression_stmt selection_stmt iteration_stmt return_stmt
+%type <node> expression var simple_expression relop additive_expression
+%type <node> addop term mulop factor call args arg_list
+
 %% /* Grammar for C-MINUS */
 
 program             : declaration_list
                          { savedTree = $1;} 
                     ;
 declaration_list    : declaration_list declaration
-                         { YYSTYPE t = $1;
+                         { TreeNode * t = $1;
                            if (t != NULL)
                            { while (t->sibling != NULL)
                              t = t->sibling;
@@ -52,28 +64,23 @@ declaration_list    : declaration_list declaration
 declaration         : var_declaration { $$ = $1; }
                     | fun_declaration { $$ = $1; }
                     ;
-var_declaration     : type_specifier ID { savedNameStack[curStackTop++] = copyString(tokenString[curTokenPos]); 
-                       savedLineNoStack[curLineTop++] = lineno; } SEMI
+var_declaration     : type_specifier ID SEMI
                          {
                            $$ = newStmtNode(VarDeclK);
-                           YYSTYPE t = $1;
-                           $$->type = t->type;
-                           $$->attr.name = savedNameStack[--curStackTop];
-                           $$->lineno = savedLineNoStack[--curLineTop];
-                         }
-                    | type_specifier ID { savedNameStack[curStackTop++] = copyString(tokenString[curTokenPos]); 
-                                          savedLineNoStack[curLineTop++] = lineno; } 
-                       LBRACE NUM { savedNum = atoi(tokenString[!curTokenPos]); } RBRACE SEMI
+                           $$->type = $1->type;
+                           $$->attr.name = tokenText($2);
+                           $$->lineno = tokenLine($2);
+                         }
+                    | type_specifier ID LBRACE NUM RBRACE SEMI
                          {
                            $$ = newStmtNode(VarDeclK);
-                           YYSTYPE t = $1;
-                           $$->type = t->type;
+                           $$->type = $1->type;
                            $$->type += 2;
-                           $$->attr.name = savedNameStack[--curStackTop];
-                           $$->lineno = savedLineNoStack[--curLineTop];
+                           $$->attr.name = tokenText($2);
+                           $$->lineno = tokenLine($2);
                            $$->child[0] = newExpNode(ConstK);
                            $$->child[0]->type = Integer;
-                           $$->child[0]->attr.val = savedNum; 
+                           $$->child[0]->attr.val = atoi(tokenText($4));
                          }
                     ;
 type_specifier      : INT 
@@ -85,15 +92,13 @@ type_specifier      : INT
                            $$->type = Void;
                          }
                     ;
-fun_declaration     : type_specifier ID { savedNameStack[curStackTop++] = copyString(tokenString[curTokenPos]);
-                       savedLineNoStack[curLineTop++] = lineno; } LPAREN params RPAREN compound_stmt 
+fun_declaration     : type_specifier ID LPAREN params RPAREN compound_stmt 
                          { $$ = newStmtNode(FunDeclK);
-                           YYSTYPE t = $1;
-                           $$->type = t->type;
-                           $$->child[0] = $5;
-                           $$->child[1] = $7;
-                           $$->attr.name = savedNameStack[--curStackTop];
-                           $$->lineno = savedLineNoStack[--curLineTop];
+                           $$->type = $1->type;
+                           $$->child[0] = $4;
+                           $$->child[1] = $6;
+                           $$->attr.name = tokenText($2);
+                           $$->lineno = tokenLine($2);
                          }
                     ;
 params              : param_list { $$ = $1; }
@@ -103,7 +108,7 @@ params              : param_list { $$ = $1; }
                          }
                     ;
 param_list          : param_list COMMA param 
-                         { YYSTYPE t = $1;
+                         { TreeNode * t = $1;
                            if (t != NULL)
                            { while (t->sibling != NULL)
                            t = t->sibling;
@@ -114,22 +119,17 @@ param_list          : param_list COMMA param
                     | param { $$ = $1; }
                     ;
 param               : type_specifier ID
-                         { savedNameStack[curStackTop++] = copyString(tokenString[curTokenPos]);
-                           savedLineNoStack[curLineTop++] = lineno;
-                           $$ = newStmtNode(ParamK);
-                           YYSTYPE t = $1;
-                           $$->type = t->type;
-                           $$->attr.name = savedNameStack[--curStackTop];
-                           $$->lineno = savedLineNoStack[--curLineTop];
-                         }
-                    | type_specifier ID { savedNameStack[curStackTop++] = copyString(tokenString[curTokenPos]);
-                       savedLineNoStack[curLineTop++] = lineno; } LBRACE RBRACE 
                          { $$ = newStmtNode(ParamK);
-                           YYSTYPE t = $1;
-                           $$->type = t->type;
+                           $$->type = $1->type;
+                           $$->attr.name = tokenText($2);
+                           $$->lineno = tokenLine($2);
+                         }
+                    | type_specifier ID LBRACE RBRACE 
+                         { $$ = newStmtNode(ParamK);
+                           $$->type = $1->type;
                            $$->type += 2;
-                           $$->attr.name = savedNameStack[--curStackTop];
-                           $$->lineno = savedLineNoStack[--curLineTop];
+                           $$->attr.name = tokenText($2);
+                           $$->lineno = tokenLine($2);
                          }
                     ;
 compound_stmt       : LCURLY local_declarations statement_list RCURLY 
@@ -139,7 +139,7 @@ compound_stmt       : LCURLY local_declarations statement_list RCURLY
                          }
                     ;
 local_declarations  : local_declarations var_declaration
-                         { YYSTYPE t = $1;
+                         { TreeNode * t = $1;
                            if (t != NULL)
                            { while (t->sibling != NULL)
                            t = t->sibling;
@@ -150,7 +150,7 @@ local_declarations  : local_declarations var_declaration
                     | %empty {$$ = NULL;}
                     ;
 statement_list      : statement_list statement 
-                         { YYSTYPE t = $1;
+                         { TreeNode * t = $1;
                            if (t != NULL)
                            { while (t->sibling != NULL)
                            t = t->sibling;
@@ -202,15 +202,14 @@ expression          : var ASSIGN expression
                     ;
 var                 : ID
                          { $$ = newExpNode(IdK);
-                           $$->attr.name = copyString(tokenString[curTokenPos]);
-                           $$->lineno = lineno;
+                           $$->attr.name = tokenText($1);
+                           $$->lineno = tokenLine($1);
                          }
-                    | ID {savedNameStack[curStackTop++] = copyString(tokenString[curTokenPos]);
-                       savedLineNoStack[curLineTop++] = lineno;} LBRACE expression RBRACE
+                    | ID LBRACE expression RBRACE
                          { $$ = newExpNode(IdK);
-                           $$->attr.name = savedNameStack[--curStackTop];
-                           $$->lineno = savedLineNoStack[--curLineTop];
-                           $$->child[0] = $4;
+                           $$->attr.name = tokenText($1);
+                           $$->lineno = tokenLine($1);
+                           $$->child[0] = $3;
                          }
                     ;
 simple_expression   : additive_expression relop additive_expression 
@@ -282,22 +281,21 @@ factor              : LPAREN expression RPAREN { $$ = $2; }
                     | call { $$ = $1; }
                     | NUM 
                          { $$ = newExpNode(ConstK);
-                           $$->attr.val = atoi(tokenString[!curTokenPos]);
+                           $$->attr.val = atoi(tokenText($1));
                          }
                     ;
-call                : ID {savedNameStack[curStackTop++] = copyString(tokenString[curTokenPos]);
-                       savedLineNoStack[curLineTop++] = lineno;} LPAREN args RPAREN
+call                : ID LPAREN args RPAREN
                          { $$ = newStmtNode(CallK);
-                           $$->attr.name = savedNameStack[--curStackTop];
-                           $$->lineno = savedLineNoStack[--curLineTop];
-                           $$->child[0] = $4;
+                           $$->attr.name = tokenText($1);
+                           $$->lineno = tokenLine($1);
+                           $$->child[0] = $3;
                          }
                     ;
 args                : arg_list { $$ = $1; }
                     | %empty { $$ = NULL; }
                     ;
 arg_list            : arg_list COMMA expression
-                         { YYSTYPE t = $1;
+                         { TreeNode * t = $1;
                            if (t != NULL)
                            { while (t->sibling != NULL)
                            t = t->sibling;
@@ -311,18 +309,24 @@ arg_list            : arg_list COMMA expression
 %%
 
 int yyerror(char * message)
-{ fprintf(listing,"Syntax error at line %d: %s\n",lineno,message);
-  fprintf(listing,"Current token: ");
-  printToken(yychar,tokenString[curTokenPos]);
+{ outFlush();
+  fprintf(listing,"Syntax error at line %d: %s\n",lineno,message);
+  outStr(listing,"Current token: ");
+  printToken(yychar,tokenPos > 0 ? tokenText(tokenPos-1) : "");
   Error = TRUE;
   return 0;
 }
 
-/* yylex calls getToken to make Yacc/Bison output
- * compatible with ealier versions of the TINY scanner
+/* yylex hands the parser the next token of the
+ * token buffer, calling getToken to scan more of
+ * the source only when the buffer is exhausted
  */
 static int yylex(void)
-{ return getToken(); }
+{ if (tokenPos == tokenCount) getToken();
+  lineno = tokenBuf[tokenPos].lineno;
+  yylval.tok = tokenPos;
+  return tokenBuf[tokenPos++].kind;
+}
 
 TreeNode * parse(void)
 { yyparse();
@@ -7,21 +7,109 @@
 /****************************************************/
 
 #include "globals.h"
+#include "util.h"
+#include "outbuf.h"
 #include "code.h"
 
-/* TM location number for current instruction emission */
-static int emitLoc = 0 ;
+/* the code buffer, indexed by code location */
+TmInstr * codeBuf = NULL;
+static int codeCap = 0;
 
 /* Highest TM location emitted so far
    For use in conjunction with emitSkip,
    emitBackup, and emitRestore */
-static int highEmitLoc = 0;
+int codeSize = 0;
+
+/* TM location number for current instruction emission */
+static int emitLoc = 0 ;
+
+/* source line recorded with new instructions */
+static int emitLineno = 0;
+
+/* the location each label is bound to, or -1 */
+static int * labels = NULL;
+int labelCount = 0;
+static int labelCap = 0;
+
+/* comment lines, with the location they precede */
+typedef struct
+   { int loc;
+     char * text;
+   } CodeComment;
+
+static CodeComment * comments = NULL;
+static int commentCount = 0;
+static int commentCap = 0;
+
+/* opcode names, indexed by TmOp */
+static char * opNames[] =
+   { "HALT","IN","OUT","ADD","SUB","MUL","DIV",
+     "LD","ST",
+     "LDA","LDC","JLT","JLE","JGT","JGE","JEQ","JNE" };
 
-/* Procedure emitComment prints a comment line 
+/* grow makes room for n elements of size bytes in
+ * the array at *p holding *cap elements
+ */
+static void grow( void ** p, int * cap, int n, int size )
+{ void * q;
+  int newCap;
+  if (n <= *cap) return;
+  newCap = *cap ? *cap : 256;
+  while (newCap < n) newCap *= 2;
+  q = realloc(*p,(size_t) newCap * size);
+  if (q == NULL)
+  { outFlush();
+    fprintf(listing,"Out of memory error in code emitter\n");
+    exit(1);
+  }
+  *p = q;
+  *cap = newCap;
+}
+
+/* opCode returns the TmOp named op */
+static TmOp opCode( char * op )
+{ int i;
+  for (i=opHALT;i<opNONE;i++)
+    if (strcmp(opNames[i],op) == 0) return (TmOp) i;
+  emitComment("BUG: Unknown opcode");
+  return opHALT;
+}
+
+/* newInstr puts a new instruction with opcode op at
+ * the current location and returns it
+ */
+static TmInstr * newInstr( char * op, char * c )
+{ TmInstr * i;
+  grow((void **) &codeBuf,&codeCap,emitLoc+1,sizeof(TmInstr));
+  i = &codeBuf[emitLoc++];
+  if (codeSize < emitLoc) codeSize = emitLoc;
+  i->op = opCode(op);
+  i->r = i->s = i->t = i->d = 0;
+  i->label = -1;
+  i->target = -1;
+  i->lineno = emitLineno;
+  i->temp = FALSE;
+  i->comment = TraceCode ? copyString(c) : NULL;
+  return i;
+}
+
+/* Procedure emitComment prints a comment line
  * with comment c in the code file
  */
 void emitComment( char * c )
-{ if (TraceCode) fprintf(code,"* %s\n",c);}
+{ if (TraceCode)
+  { grow((void **) &comments,&commentCap,commentCount+1,sizeof(CodeComment));
+    comments[commentCount].loc = emitLoc;
+    comments[commentCount].text = copyString(c);
+    commentCount++;
+  }
+}
+
+/* Procedure emitLine sets the source line
+ * recorded with the instructions emitted next
+ */
+void emitLine( int lineno )
+{ emitLineno = lineno; }
 
 /* Procedure emitRO emits a register-only
  * TM instruction
@@ -32,10 +120,10 @@ void emitComment( char * c )
  * c = a comment to be printed if TraceCode is TRUE
  */
 void emitRO( char *op, int r, int s, int t, char *c)
-{ fprintf(code,"%3d:  %5s  %d,%d,%d ",emitLoc++,op,r,s,t);
-  if (TraceCode) fprintf(code,"\t%s",c) ;
-  fprintf(code,"\n") ;
-  if (highEmitLoc < emitLoc) highEmitLoc = emitLoc ;
+{ TmInstr * i = newInstr(op,c);
+  i->r = r;
+  i->s = s;
+  i->t = t;
 } /* emitRO */
 
 /* Procedure emitRM emits a register-to-memory
@@ -47,39 +135,58 @@ void emitRO( char *op, int r, int s, int t, char *c)
  * c = a comment to be printed if TraceCode is TRUE
  */
 void emitRM( char * op, int r, int d, int s, char *c)
-{ fprintf(code,"%3d:  %5s  %d,%d(%d) ",emitLoc++,op,r,d,s);
-  if (TraceCode) fprintf(code,"\t%s",c) ;
-  fprintf(code,"\n") ;
-  if (highEmitLoc < emitLoc)  highEmitLoc = emitLoc ;
+{ TmInstr * i = newInstr(op,c);
+  i->r = r;
+  i->d = d;
+  i->s = s;
 } /* emitRM */
 
+/* Procedure emitRM_Temp emits an RM instruction
+ * that pushes or pops a temporary
+ */
+void emitRM_Temp( char * op, int r, int d, int s, char *c)
+{ TmInstr * i = newInstr(op,c);
+  i->r = r;
+  i->d = d;
+  i->s = s;
+  i->temp = TRUE;
+} /* emitRM_Temp */
+
 /* Function emitSkip skips "howMany" code
  * locations for later backpatch. It also
  * returns the current code position
  */
 int emitSkip( int howMany)
 {  int i = emitLoc;
+   int loc;
    emitLoc += howMany ;
-   if (highEmitLoc < emitLoc)  highEmitLoc = emitLoc ;
+   if (codeSize < emitLoc)
+   { grow((void **) &codeBuf,&codeCap,emitLoc,sizeof(TmInstr));
+     for (loc=codeSize;loc<emitLoc;loc++)
+     { codeBuf[loc].op = opNONE;
+       codeBuf[loc].comment = NULL;
+     }
+     codeSize = emitLoc;
+   }
    return i;
 } /* emitSkip */
 
-/* Procedure emitBackup backs up to 
+/* Procedure emitBackup backs up to
  * loc = a previously skipped location
  */
 void emitBackup( int loc)
-{ if (loc > highEmitLoc) emitComment("BUG in emitBackup");
+{ if (loc > codeSize) emitComment("BUG in emitBackup");
   emitLoc = loc ;
 } /* emitBackup */
 
-/* Procedure emitRestore restores the current 
+/* Procedure emitRestore restores the current
  * code position to the highest previously
  * unemitted position
  */
 void emitRestore(void)
-{ emitLoc = highEmitLoc;}
+{ emitLoc = codeSize;}
 
-/* Procedure emitRM_Abs converts an absolute reference 
+/* Procedure emitRM_Abs converts an absolute reference
  * to a pc-relative reference when emitting a
  * register-to-memory TM instruction
  * op = the opcode
@@ -88,10 +195,223 @@ void emitRestore(void)
  * c = a comment to be printed if TraceCode is TRUE
  */
 void emitRM_Abs( char *op, int r, int a, char * c)
-{ fprintf(code,"%3d:  %5s  %d,%d(%d) ",
-               emitLoc,op,r,a-(emitLoc+1),pc);
-  ++emitLoc ;
-  if (TraceCode) fprintf(code,"\t%s",c) ;
-  fprintf(code,"\n") ;
-  if (highEmitLoc < emitLoc) highEmitLoc = emitLoc ;
+{ TmInstr * i = newInstr(op,c);
+  i->r = r;
+  i->s = pc;
+  i->target = a;
 } /* emitRM_Abs */
+
+/* Function newLabel returns a new code label,
+ * not yet bound to a location
+ */
+int newLabel( void )
+{ grow((void **) &labels,&labelCap,labelCount+1,sizeof(int));
+  labels[labelCount] = -1;
+  return labelCount++;
+}
+
+/* Procedure emitLabel binds label to the
+ * current code position
+ */
+void emitLabel( int label )
+{ labels[label] = emitLoc; }
+
+/* Function labelLoc returns the location label
+ * is bound to, or -1 if it is not bound
+ */
+int labelLoc( int label )
+{ return labels[label]; }
+
+/* Procedure emitRM_Label emits a pc-relative
+ * register-to-memory TM instruction whose
+ * target is label
+ */
+void emitRM_Label( char *op, int r, int label, char * c)
+{ TmInstr * i = newInstr(op,c);
+  i->r = r;
+  i->s = pc;
+  i->label = label;
+} /* emitRM_Label */
+
+/* Procedure compactCode removes the locations
+ * whose opcode is opNONE
+ */
+void compactCode( void )
+{ int * newLoc;
+  int loc, n = 0, i;
+  newLoc = (int *) malloc((codeSize+1) * sizeof(int));
+  if (newLoc == NULL)
+  { outFlush();
+    fprintf(listing,"Out of memory error in code emitter\n");
+    exit(1);
+  }
+  /* a removed location maps to the next one kept */
+  for (loc=0;loc<codeSize;loc++)
+  { newLoc[loc] = n;
+    if (codeBuf[loc].op != opNONE) codeBuf[n++] = codeBuf[loc];
+    else free(codeBuf[loc].comment);
+  }
+  newLoc[codeSize] = n;
+  for (i=0;i<n;i++)
+    if (codeBuf[i].target >= 0)
+      codeBuf[i].target = newLoc[codeBuf[i].target];
+  for (i=0;i<labelCount;i++)
+    if (labels[i] >= 0) labels[i] = newLoc[labels[i]];
+  for (i=0;i<commentCount;i++)
+    comments[i].loc = newLoc[comments[i].loc];
+  emitLoc = newLoc[emitLoc];
+  codeSize = n;
+  free(newLoc);
+}
+
+/* targetOf returns the absolute location the
+ * pc-relative instruction at loc jumps to
+ */
+static int targetOf( int loc )
+{ TmInstr * i = &codeBuf[loc];
+  if (i->target >= 0) return i->target;
+  if (labels[i->label] < 0)
+  { outFlush();
+    fprintf(listing,"BUG: label L%d used but not bound\n",i->label);
+    Error = TRUE;
+    return loc+1;
+  }
+  return labels[i->label];
+}
+
+/* writeTm writes the instruction at loc in the
+ * format read by the TM simulator
+ */
+static void writeTm( FILE * f, int loc )
+{ TmInstr * i = &codeBuf[loc];
+  int d = i->d;
+  if ((i->label >= 0) || (i->target >= 0)) d = targetOf(loc) - (loc+1);
+  outIntRight(f,loc,3);
+  outStr(f,":  ");
+  outStrRight(f,opNames[i->op],5);
+  outStr(f,"  ");
+  outInt(f,i->r);
+  outChar(f,',');
+  if (i->op < opLD)
+  { outInt(f,i->s);
+    outChar(f,',');
+    outInt(f,i->t);
+  }
+  else
+  { outInt(f,d);
+    outChar(f,'(');
+    outInt(f,i->s);
+    outChar(f,')');
+  }
+  outChar(f,' ');
+  if (i->comment != NULL)
+  { outChar(f,'\t');
+    outStr(f,i->comment);
+  }
+  outChar(f,'\n');
+}
+
+/* writeListing writes the instruction at loc with
+ * its source line and symbolic jump targets
+ */
+static void writeListing( FILE * f, int loc )
+{ TmInstr * i = &codeBuf[loc];
+  outIntRight(f,loc,5);
+  outStr(f,"  [");
+  outIntRight(f,i->lineno,4);
+  outStr(f,"]  ");
+  outPadStr(f,opNames[i->op],5);
+  outInt(f,i->r);
+  outChar(f,',');
+  if (i->op < opLD)
+  { outInt(f,i->s);
+    outChar(f,',');
+    outInt(f,i->t);
+  }
+  else if (i->label >= 0)
+  { outChar(f,'L');
+    outInt(f,i->label);
+  }
+  else if (i->target >= 0)
+    outInt(f,i->target);
+  else
+  { outInt(f,i->d);
+    outChar(f,'(');
+    outInt(f,i->s);
+    outChar(f,')');
+  }
+  if ((i->comment != NULL) && (i->comment[0] != '\0'))
+  { outStr(f,"\t* ");
+    outStr(f,i->comment);
+  }
+  outChar(f,'\n');
+}
+
+/* Procedure writeCode writes the code buffer
+ * to file f in format fmt, unless it is for the
+ * TM simulator and does not fit in its memory
+ */
+void writeCode( FILE * f, CodeFormat fmt )
+{ int loc, c = 0, l;
+  int * first = NULL, * next = NULL;
+  if ((fmt == TmFormat) && (codeSize > IMEM_SIZE))
+  { /* the simulator would not load it */
+    outFlush();
+    fprintf(listing,"Code generation error: %d instructions, more than "
+            "the %d of TM instruction memory\n",codeSize,IMEM_SIZE);
+    Error = TRUE;
+    return;
+  }
+  if (fmt == ListingFormat)
+  { /* chain the labels bound at each location */
+    first = (int *) malloc((codeSize+1) * sizeof(int));
+    next = (int *) malloc((labelCount+1) * sizeof(int));
+    if ((first == NULL) || (next == NULL))
+    { outFlush();
+      fprintf(listing,"Out of memory error in code emitter\n");
+      exit(1);
+    }
+    for (loc=0;loc<=codeSize;loc++) first[loc] = -1;
+    for (l=labelCount-1;l>=0;l--)
+      if ((labels[l] >= 0) && (labels[l] <= codeSize))
+      { next[l] = first[labels[l]];
+        first[labels[l]] = l;
+      }
+  }
+  for (loc=0;loc<=codeSize;loc++)
+  { for (;(c < commentCount) && (comments[c].loc <= loc);c++)
+    { outStr(f,"* ");
+      outStr(f,comments[c].text);
+      outChar(f,'\n');
+    }
+    if (fmt == ListingFormat)
+      for (l=first[loc];l>=0;l=next[l])
+      { outChar(f,'L');
+        outInt(f,l);
+        outStr(f,":\n");
+      }
+    if ((loc == codeSize) || (codeBuf[loc].op == opNONE)) continue;
+    if (fmt == ListingFormat) writeListing(f,loc);
+    else writeTm(f,loc);
+  }
+  for (;c < commentCount;c++)
+  { outStr(f,"* ");
+    outStr(f,comments[c].text);
+    outChar(f,'\n');
+  }
+  outFlush();
+  free(first);
+  free(next);
+}
+
+/* Procedure resetCode empties the code buffer
+ * and forgets all labels
+ */
+void resetCode( void )
+{ int i;
+  for (i=0;i<codeSize;i++) free(codeBuf[i].comment);
+  for (i=0;i<commentCount;i++) free(comments[i].text);
+  codeSize = emitLoc = 0;
+  labelCount = commentCount = 0;
+  emitLineno = 0;
+}
@@ -23,19 +23,70 @@
  */
 #define gp 5
 
+/* fp = "frame pointer" points to the
+ * activation record of the current function
+ */
+#define fp 4
+
 /* accumulator */
 #define  ac 0
 
 /* 2nd accumulator */
 #define  ac1 1
 
+/* words of TM instruction memory, IADDR_SIZE in tm.c */
+#define IMEM_SIZE 1024
+
+/* the TM opcodes, in the order of the TM simulator */
+typedef enum
+   { opHALT,opIN,opOUT,opADD,opSUB,opMUL,opDIV,      /* RO */
+     opLD,opST,                                      /* RM */
+     opLDA,opLDC,opJLT,opJLE,opJGT,opJGE,opJEQ,opJNE,/* RA */
+     opNONE /* a skipped location not yet backpatched,
+               or an instruction removed by the optimizer */
+   } TmOp;
+
+/* Instructions are not written out as they are
+ * emitted but kept in the code buffer, indexed by
+ * code location, until writeCode is called. An RO
+ * instruction uses r, s and t; an RM or RA
+ * instruction uses r, d and s. A pc-relative jump to
+ * a label or to an absolute location keeps its
+ * target, and d is filled in when the code is
+ * written
+ */
+typedef struct
+   { TmOp op;
+     int r, s, t, d;
+     int label;     /* target label, or -1 */
+     int target;    /* absolute target location, or -1 */
+     int lineno;    /* source line the instruction is for */
+     int temp;      /* pushes or pops a compiler temporary */
+     char * comment;
+   } TmInstr;
+
+extern TmInstr * codeBuf;
+extern int codeSize; /* number of code locations used */
+extern int labelCount; /* number of labels created */
+
+/* the formats writeCode can produce */
+typedef enum
+   { TmFormat,      /* input for the TM simulator */
+     ListingFormat  /* with labels and source lines */
+   } CodeFormat;
+
 /* code emitting utilities */
 
-/* Procedure emitComment prints a comment line 
+/* Procedure emitComment prints a comment line
  * with comment c in the code file
  */
 void emitComment( char * c );
 
+/* Procedure emitLine sets the source line
+ * recorded with the instructions emitted next
+ */
+void emitLine( int lineno );
+
 /* Procedure emitRO emits a register-only
  * TM instruction
  * op = the opcode
@@ -56,24 +107,31 @@ void emitRO( char *op, int r, int s, int t, char *c);
  */
 void emitRM( char * op, int r, int d, int s, char *c);
 
+/* Procedure emitRM_Temp emits an RM instruction
+ * that pushes (ST) or pops (LD) a temporary. Every
+ * temporary is popped exactly once, so the
+ * optimizer may keep its value in a register
+ */
+void emitRM_Temp( char * op, int r, int d, int s, char *c);
+
 /* Function emitSkip skips "howMany" code
  * locations for later backpatch. It also
  * returns the current code position
  */
 int emitSkip( int howMany);
 
-/* Procedure emitBackup backs up to 
+/* Procedure emitBackup backs up to
  * loc = a previously skipped location
  */
 void emitBackup( int loc);
 
-/* Procedure emitRestore restores the current 
+/* Procedure emitRestore restores the current
  * code position to the highest previously
  * unemitted position
  */
 void emitRestore(void);
 
-/* Procedure emitRM_Abs converts an absolute reference 
+/* Procedure emitRM_Abs converts an absolute reference
  * to a pc-relative reference when emitting a
  * register-to-memory TM instruction
  * op = the opcode
@@ -83,4 +141,48 @@ void emitRestore(void);
  */
 void emitRM_Abs( char *op, int r, int a, char * c);
 
+/* Function newLabel returns a new code label,
+ * not yet bound to a location
+ */
+int newLabel( void );
+
+/* Procedure emitLabel binds label to the
+ * current code position
+ */
+void emitLabel( int label );
+
+/* Function labelLoc returns the location label
+ * is bound to, or -1 if it is not bound
+ */
+int labelLoc( int label );
+
+/* Procedure emitRM_Label emits a pc-relative
+ * register-to-memory TM instruction whose
+ * target is label, which may be bound later
+ * op = the opcode
+ * r = target register
+ * label = the target label
+ * c = a comment to be printed if TraceCode is TRUE
+ */
+void emitRM_Label( char *op, int r, int label, char * c);
+
+/* Procedure compactCode removes the locations
+ * whose opcode is opNONE, moving the labels, jump
+ * targets and comments along with the code
+ */
+void compactCode( void );
+
+/* Procedure writeCode writes the code buffer
+ * to file f in format fmt. All labels used must
+ * be bound by then. Code for the TM simulator that
+ * does not fit in IMEM_SIZE is not written, but
+ * reported as an error
+ */
+void writeCode( FILE * f, CodeFormat fmt );
+
+/* Procedure resetCode empties the code buffer
+ * and forgets all labels
+ */
+void resetCode( void );
+
 #endif
@@ -115,6 +115,35 @@ extern int TraceAnalyze;
  */
 extern int TraceCode;
 
+/* FastListing = TRUE causes the listing and trace
+ * output to be formatted by hand into a large
+ * buffer that is written out in bulk
+ */
+extern int FastListing;
+
+/* Optimize = TRUE causes the generated code to be
+ * improved by the peephole optimizer
+ */
+extern int Optimize;
+
+/* TracePeephole = TRUE causes the code to be listed
+ * before and after peephole optimization, with the
+ * number of times each rule was applied
+ */
+extern int TracePeephole;
+
+/* TraceIrOpt = TRUE causes the time spent in each
+ * IR optimization pass and what it did to be
+ * printed to the listing file
+ */
+extern int TraceIrOpt;
+
+/* InlineBudget is the size in IR instructions of
+ * the largest function whose calls are inlined by
+ * the IR optimizer; 0 turns inlining off
+ */
+extern int InlineBudget;
+
 /* Error = TRUE prevents further passes if an error occurs */
 extern int Error; 
 #endif
@@ -0,0 +1,313 @@
+/****************************************************/
+/* File: inline.c                                   */
+/* Inlining of small functions in the IR for the    */
+/* C-MINUS compiler                                 */
+/****************************************************/
+
+#include "globals.h"
+#include "outbuf.h"
+#include "symtab.h"
+#include "code.h"
+#include "ir.h"
+#include "inline.h"
+
+/* A call is inlined when the function called takes
+ * as many arguments as its signature in the global
+ * scope says, cannot reach itself through calls, and
+ * has at most InlineBudget instructions, or four
+ * times that if it is called from a single place.
+ * The functions are visited callees first, so that a
+ * function is inlined with the calls in it already
+ * inlined. The program may grow by at most its own
+ * size, plus the budget, and only as long as its
+ * code should still fit in TM instruction memory;
+ * inlining a function called from a single place
+ * does not count, as the function is dropped once
+ * it is no longer called.
+ *
+ * At the call, the block is split in two: the first
+ * half copies the arguments into the registers of
+ * the parameters and jumps to a copy of the body,
+ * whose returns copy the result and jump to the
+ * second half.
+ */
+
+/* what is known of each function, in the order of
+ * the program
+ */
+typedef struct
+   { IrFunc f;
+     int size;      /* instructions, with terminators */
+     int calls;     /* call sites in the program */
+     int recursive; /* reaches itself through calls */
+     int visited;
+   } FuncInfo;
+
+static FuncInfo * info;
+static int nfuncs;
+
+/* TM instructions the code generator makes of an IR
+ * instruction, rounded up from the programs seen
+ */
+#define TM_PER_IR 4
+
+/* infoOf returns what is known of the function
+ * called name, or NULL
+ */
+static FuncInfo * infoOf( char * name )
+{ int i;
+  for (i=0;i<nfuncs;i++)
+    if (strcmp(info[i].f->name,name) == 0) return &info[i];
+  return NULL;
+}
+
+/* funcSize returns the number of instructions of f */
+static int funcSize( IrFunc f )
+{ int b, n = 0;
+  for (b=0;b<f->nblocks;b++) n += f->blocks[b]->ncode + 1;
+  return n;
+}
+
+/* reaches tells if function f may call target,
+ * directly or not
+ */
+static int reaches( FuncInfo * f, FuncInfo * target )
+{ FuncInfo * g;
+  int b, i, r = FALSE;
+  IrBlock blk;
+  if (f->visited) return FALSE;
+  f->visited = TRUE;
+  for (b=0;(b<f->f->nblocks) && !r;b++)
+  { blk = f->f->blocks[b];
+    for (i=0;(i<blk->ncode) && !r;i++)
+      if (blk->code[i].op == irCall)
+      { g = infoOf(blk->code[i].name);
+        r = (g == target) || ((g != NULL) && reaches(g,target));
+      }
+  }
+  return r;
+}
+
+/* copyBody appends a copy of the body of g to f for
+ * call, which ended block blk, the code after it
+ * having been moved to block after; the registers
+ * of g become those from base on
+ */
+static void copyBody( IrFunc f, IrBlock blk, IrInstr * call, IrBlock after,
+                      IrFunc g, int base, int arrays )
+{ IrInstr * in, * c;
+  IrBlock * copy = (IrBlock *) irMalloc(g->nblocks * sizeof(IrBlock));
+  IrBlock gb, nb;
+  int b, i, j;
+  for (b=0;b<g->nblocks;b++) copy[b] = irNewBlock(f);
+  for (b=0;b<g->nblocks;b++)
+  { gb = g->blocks[b];
+    nb = copy[b];
+    for (i=0;i<gb->ncode;i++)
+    { in = &gb->code[i];
+      c = irEmit(nb,in->op,in->dst < 0 ? -1 : base + in->dst,
+                 in->a < 0 ? -1 : base + in->a,
+                 in->b < 0 ? -1 : base + in->b,
+                 in->op == irAddrL ? arrays + in->k : in->k);
+      c->name = in->name;
+      c->lineno = in->lineno;
+      c->mark = TRUE;
+      if (in->nargs > 0)
+      { c->nargs = in->nargs;
+        c->args = (int *) irMalloc(in->nargs * sizeof(int));
+        for (j=0;j<in->nargs;j++) c->args[j] = base + in->args[j];
+      }
+    }
+    if (gb->term == irReturn)
+    { if ((call->dst >= 0) && (gb->a >= 0))
+      { c = irEmit(nb,irCopy,call->dst,base + gb->a,-1,0);
+        c->lineno = call->lineno;
+      }
+      nb->term = irJump;
+      nb->nsucc = 1;
+      nb->succ[0] = after;
+    }
+    else
+    { nb->term = gb->term;
+      nb->rel = gb->rel;
+      nb->a = gb->a < 0 ? -1 : base + gb->a;
+      nb->b = gb->b < 0 ? -1 : base + gb->b;
+      nb->nsucc = gb->nsucc;
+      for (j=0;j<gb->nsucc;j++) nb->succ[j] = copy[gb->succ[j]->id];
+    }
+  }
+  /* the arguments go to the parameters */
+  for (j=0;j<g->nparams;j++)
+  { c = irEmit(blk,irCopy,base + g->params[j],call->args[j],-1,0);
+    c->lineno = call->lineno;
+  }
+  blk->term = irJump;
+  blk->nsucc = 1;
+  blk->succ[0] = copy[0];
+  free(copy);
+}
+
+/* inlineCall replaces the call at position pos of
+ * block blk of f by a copy of g
+ */
+static void inlineCall( IrFunc f, IrBlock blk, int pos, IrFunc g )
+{ IrBlock after = irNewBlock(f);
+  IrInstr call = blk->code[pos];
+  int base = f->nregs, i;
+  f->nregs += g->nregs;
+  /* the code after the call and the terminator move
+     to the new block */
+  for (i=pos+1;i<blk->ncode;i++)
+    *irEmit(after,irNop,-1,-1,-1,0) = blk->code[i];
+  after->term = blk->term;
+  after->rel = blk->rel;
+  after->a = blk->a;
+  after->b = blk->b;
+  after->nsucc = blk->nsucc;
+  after->succ[0] = blk->succ[0];
+  after->succ[1] = blk->succ[1];
+  blk->ncode = pos;
+  copyBody(f,blk,&call,after,g,base,f->arraySize);
+  free(call.args);
+  f->arraySize += g->arraySize;
+}
+
+/* visit inlines the calls of function fi, after
+ * doing so for the functions it calls; budget is
+ * what the program may still grow by
+ */
+static void visit( FuncInfo * fi, int * budget, int * count )
+{ FuncInfo * g;
+  BucketList sig;
+  IrFunc f = fi->f;
+  IrBlock blk;
+  IrInstr * in;
+  int b, i, cost, found = TRUE;
+  if (fi->visited) return;
+  fi->visited = TRUE;
+  for (b=0;b<f->nblocks;b++)
+    for (i=0;i<f->blocks[b]->ncode;i++)
+      if (f->blocks[b]->code[i].op == irCall)
+      { g = infoOf(f->blocks[b]->code[i].name);
+        if (g != NULL) visit(g,budget,count);
+        f->blocks[b]->code[i].mark = FALSE;
+      }
+  /* each call is looked at once; the calls copied in
+     have been looked at in the callee */
+  while (found)
+  { found = FALSE;
+    for (b=0;(b<f->nblocks) && !found;b++)
+    { blk = f->blocks[b];
+      for (i=0;(i<blk->ncode) && !found;i++)
+      { in = &blk->code[i];
+        if ((in->op != irCall) || in->mark) continue;
+        in->mark = TRUE;
+        g = infoOf(in->name);
+        sig = st_lookup_now(tree,in->name);
+        if ((g == NULL) || g->recursive || (sig == NULL) ||
+            (sig->type.sym != Function) || (sig->type.argcnt != in->nargs) ||
+            (g->f->nparams != in->nargs))
+          continue;
+        g->size = funcSize(g->f);
+        cost = g->calls == 1 ? 0 : g->size;
+        if ((g->size > InlineBudget * (g->calls == 1 ? 4 : 1)) ||
+            (cost > *budget))
+          continue;
+        if (TraceIrOpt)
+        { outFlush();
+          fprintf(listing,"  inlined %s into %s at line %d, %d instructions\n",
+                  g->f->name,f->name,in->lineno,g->size);
+        }
+        *budget -= cost;
+        (*count)++;
+        inlineCall(f,blk,i,g->f);
+        /* the copied calls are marked as in the callee */
+        found = TRUE;
+      }
+    }
+  }
+  irBuildCFG(f);
+}
+
+/* markCalled marks fi and the functions it may
+ * call, directly or not, as visited
+ */
+static void markCalled( FuncInfo * fi )
+{ int b, i;
+  IrBlock blk;
+  if (fi->visited) return;
+  fi->visited = TRUE;
+  for (b=0;b<fi->f->nblocks;b++)
+  { blk = fi->f->blocks[b];
+    for (i=0;i<blk->ncode;i++)
+      if ((blk->code[i].op == irCall) && (infoOf(blk->code[i].name) != NULL))
+        markCalled(infoOf(blk->code[i].name));
+  }
+}
+
+/* dropUncalled removes from p the functions main no
+ * longer reaches, their calls having all been
+ * inlined, and clears their used field; without a
+ * main every function is kept
+ */
+static void dropUncalled( IrProgram p )
+{ FuncInfo * m = infoOf("main");
+  IrFunc * f;
+  int i;
+  if (m == NULL) return;
+  for (i=0;i<nfuncs;i++) info[i].visited = FALSE;
+  markCalled(m);
+  for (i=0,f=&p->funcs;i<nfuncs;i++)
+    if (info[i].visited) f = &(*f)->next;
+    else
+    { if (TraceIrOpt)
+        fprintf(listing,"  dropped %s, no longer called\n",info[i].f->name);
+      st_lookup_now(tree,info[i].f->name)->used = FALSE;
+      *f = (*f)->next;
+    }
+}
+
+/* Function irInline replaces the calls of program p
+ * to small functions that are not recursive by a
+ * copy of their body, drops the functions no longer
+ * called, and returns how many calls it replaced
+ */
+int irInline( IrProgram p )
+{ IrFunc f;
+  FuncInfo * g;
+  int budget = InlineBudget, count = 0, i, j, b, size = 0;
+  IrBlock blk;
+  for (f=p->funcs,nfuncs=0;f != NULL;f=f->next) nfuncs++;
+  info = (FuncInfo *) irMalloc(nfuncs * sizeof(FuncInfo));
+  for (f=p->funcs,i=0;f != NULL;f=f->next,i++)
+  { info[i].f = f;
+    info[i].size = funcSize(f);
+    size += info[i].size;
+  }
+  budget += size;
+  if (budget > IMEM_SIZE / TM_PER_IR - size)
+    budget = IMEM_SIZE / TM_PER_IR - size;
+  if (budget < 0) budget = 0;
+  for (i=0;i<nfuncs;i++)
+    for (b=0;b<info[i].f->nblocks;b++)
+    { blk = info[i].f->blocks[b];
+      for (j=0;j<blk->ncode;j++)
+        if ((blk->code[j].op == irCall) &&
+            ((g = infoOf(blk->code[j].name)) != NULL))
+          g->calls++;
+    }
+  for (i=0;i<nfuncs;i++)
+  { for (j=0;j<nfuncs;j++) info[j].visited = FALSE;
+    info[i].recursive = reaches(&info[i],&info[i]);
+  }
+  if (TraceIrOpt)
+  { outFlush();
+    fprintf(listing,"\nInlining (budget %d instructions):\n",InlineBudget);
+  }
+  for (j=0;j<nfuncs;j++) info[j].visited = FALSE;
+  for (i=0;i<nfuncs;i++) visit(&info[i],&budget,&count);
+  dropUncalled(p);
+  if (TraceIrOpt) fprintf(listing,"  %d calls inlined\n",count);
+  free(info);
+  return count;
+}
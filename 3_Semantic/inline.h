@@ -0,0 +1,21 @@
+/****************************************************/
+/* File: inline.h                                   */
+/* Inlining of small functions in the IR for the    */
+/* C-MINUS compiler                                 */
+/****************************************************/
+
+#ifndef _INLINE_H_
+#define _INLINE_H_
+
+#include "ir.h"
+
+/* Function irInline replaces the calls of program p
+ * to small functions that are not recursive by a
+ * copy of their body, drops the functions that are
+ * then no longer called, and returns how many calls
+ * it replaced. If TraceIrOpt is TRUE each of them
+ * is reported to the listing file
+ */
+int irInline( IrProgram p );
+
+#endif
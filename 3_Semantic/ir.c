@@ -0,0 +1,369 @@
+/****************************************************/
+/* File: ir.c                                       */
+/* Three-address intermediate representation        */
+/* implementation for the C-MINUS compiler          */
+/****************************************************/
+
+#include "globals.h"
+#include "outbuf.h"
+#include "ir.h"
+
+/* Function irMalloc allocates n bytes of zeroed
+ * memory, and stops the compiler if there is none
+ */
+void * irMalloc( int n )
+{ void * p = calloc(1,n > 0 ? n : 1);
+  if (p == NULL)
+  { outFlush();
+    fprintf(listing,"Out of memory error in IR\n");
+    exit(1);
+  }
+  return p;
+}
+
+/* Procedure irGrow makes room for n elements of
+ * size bytes in the array at *p holding *cap
+ */
+void irGrow( void ** p, int * cap, int n, int size )
+{ void * q;
+  int newCap;
+  if (n <= *cap) return;
+  newCap = *cap ? *cap : 8;
+  while (newCap < n) newCap *= 2;
+  q = realloc(*p,(size_t) newCap * size);
+  if (q == NULL)
+  { outFlush();
+    fprintf(listing,"Out of memory error in IR\n");
+    exit(1);
+  }
+  *p = q;
+  *cap = newCap;
+}
+
+/* Function irNewBlock adds an empty block ending
+ * in a return to f and returns it
+ */
+IrBlock irNewBlock( IrFunc f )
+{ IrBlock b = (IrBlock) irMalloc(sizeof(struct IrBlockRec));
+  irGrow((void **) &f->blocks,&f->capblocks,f->nblocks+1,sizeof(IrBlock));
+  b->id = f->nblocks;
+  b->term = irReturn;
+  b->a = b->b = -1;
+  b->label = -1;
+  f->blocks[f->nblocks++] = b;
+  return b;
+}
+
+/* Function irEmit appends an instruction with the
+ * given opcode and operands to block blk and
+ * returns it
+ */
+IrInstr * irEmit( IrBlock blk, IrOp op, int dst, int a, int b, int k )
+{ IrInstr * i;
+  irGrow((void **) &blk->code,&blk->capcode,blk->ncode+1,sizeof(IrInstr));
+  i = &blk->code[blk->ncode++];
+  i->op = op;
+  i->dst = dst;
+  i->a = a;
+  i->b = b;
+  i->k = k;
+  i->name = NULL;
+  i->nargs = 0;
+  i->args = NULL;
+  i->from = NULL;
+  i->lineno = 0;
+  i->mark = FALSE;
+  return i;
+}
+
+/* Function irInsert inserts an instruction like
+ * irEmit does, but at position pos of block blk
+ */
+IrInstr * irInsert( IrBlock blk, int pos, IrOp op, int dst, int a, int b, int k )
+{ IrInstr i;
+  int j;
+  i = *irEmit(blk,op,dst,a,b,k);
+  for (j=blk->ncode-1;j>pos;j--) blk->code[j] = blk->code[j-1];
+  blk->code[pos] = i;
+  return &blk->code[pos];
+}
+
+/* Procedure irRemoveNops removes the irNop
+ * instructions of block blk
+ */
+void irRemoveNops( IrBlock blk )
+{ int i, n = 0;
+  for (i=0;i<blk->ncode;i++)
+    if (blk->code[i].op != irNop) blk->code[n++] = blk->code[i];
+    else
+    { free(blk->code[i].args);
+      free(blk->code[i].from);
+    }
+  blk->ncode = n;
+}
+
+/* Function irNewReg returns a new virtual register of f */
+int irNewReg( IrFunc f )
+{ return f->nregs++; }
+
+/* Function irIsRel tells if op is a comparison */
+int irIsRel( IrOp op )
+{ return (op >= irLT) && (op <= irNE); }
+
+/* Function irNegate returns the comparison that is
+ * true exactly when rel is false
+ */
+IrOp irNegate( IrOp rel )
+{ switch (rel)
+  { case irLT: return irGE;
+    case irLE: return irGT;
+    case irGT: return irLE;
+    case irGE: return irLT;
+    case irEQ: return irNE;
+    default: return irEQ;
+  }
+}
+
+/* Function irFindFunc returns the function called
+ * name in p, or NULL
+ */
+IrFunc irFindFunc( IrProgram p, char * name )
+{ IrFunc f;
+  for (f=p->funcs;f != NULL;f=f->next)
+    if (strcmp(f->name,name) == 0) return f;
+  return NULL;
+}
+
+/* Procedure irBuildCFG removes the blocks not
+ * reachable from the entry of f, puts the others
+ * in reverse postorder and computes their
+ * predecessors
+ */
+void irBuildCFG( IrFunc f )
+{ IrBlock * stack, * order, b, s;
+  int * next;
+  int sp = 0, n = 0, i, j;
+  if (f->nblocks == 0) return;
+  stack = (IrBlock *) irMalloc(f->nblocks * sizeof(IrBlock));
+  order = (IrBlock *) irMalloc(f->nblocks * sizeof(IrBlock));
+  next = (int *) irMalloc(f->nblocks * sizeof(int));
+  for (i=0;i<f->nblocks;i++)
+  { f->blocks[i]->mark = FALSE;
+    f->blocks[i]->npred = 0;
+  }
+  /* depth-first search without recursion; next
+     holds the successor to visit next in each block */
+  stack[sp++] = f->blocks[0];
+  f->blocks[0]->mark = TRUE;
+  next[0] = 0;
+  while (sp > 0)
+  { b = stack[sp-1];
+    if (next[sp-1] < b->nsucc)
+    { s = b->succ[next[sp-1]++];
+      s->npred++;
+      if (!s->mark)
+      { s->mark = TRUE;
+        next[sp] = 0;
+        stack[sp++] = s;
+      }
+    }
+    else order[n++] = stack[--sp];
+  }
+  for (i=0;i<f->nblocks;i++)
+    if (!f->blocks[i]->mark)
+    { for (j=0;j<f->blocks[i]->ncode;j++)
+      { free(f->blocks[i]->code[j].args);
+        free(f->blocks[i]->code[j].from);
+      }
+      free(f->blocks[i]->code);
+      free(f->blocks[i]->pred);
+      free(f->blocks[i]);
+    }
+  for (i=0;i<n;i++)
+  { b = order[n-1-i];
+    b->id = i;
+    f->blocks[i] = b;
+    free(b->pred);
+    b->pred = (IrBlock *) irMalloc(b->npred * sizeof(IrBlock));
+    b->npred = 0;
+  }
+  f->nblocks = n;
+  for (i=0;i<n;i++)
+  { b = f->blocks[i];
+    for (j=0;j<b->nsucc;j++)
+      b->succ[j]->pred[b->succ[j]->npred++] = b;
+  }
+  free(stack);
+  free(order);
+  free(next);
+}
+
+/* printing of IR */
+
+static char * relNames[] = { "<","<=",">",">=","==","!=" };
+
+static void printReg( int r )
+{ outChar(listing,'v');
+  outInt(listing,r);
+}
+
+static void printArgs( IrInstr * i )
+{ int j;
+  outChar(listing,'(');
+  for (j=0;j<i->nargs;j++)
+  { if (j > 0) outStr(listing,", ");
+    printReg(i->args[j]);
+  }
+  outChar(listing,')');
+}
+
+static void printInstr( IrInstr * i )
+{ int j;
+  if (i->op == irNop) return;
+  outStr(listing,"  ");
+  if (i->dst >= 0)
+  { printReg(i->dst);
+    outStr(listing," = ");
+  }
+  switch (i->op)
+  { case irConst: outInt(listing,i->k); break;
+    case irCopy: printReg(i->a); break;
+    case irAdd: case irSub: case irMul: case irDiv:
+      printReg(i->a);
+      outChar(listing,' ');
+      outChar(listing,"+-*/"[i->op - irAdd]);
+      outChar(listing,' ');
+      printReg(i->b);
+      break;
+    case irLT: case irLE: case irGT: case irGE: case irEQ: case irNE:
+      printReg(i->a);
+      outChar(listing,' ');
+      outStr(listing,relNames[i->op - irLT]);
+      outChar(listing,' ');
+      printReg(i->b);
+      break;
+    case irAddrG:
+      outStr(listing,"&global[");
+      outInt(listing,i->k);
+      outChar(listing,']');
+      break;
+    case irAddrL:
+      outStr(listing,"&local[");
+      outInt(listing,i->k);
+      outChar(listing,']');
+      break;
+    case irLoadG:
+      outStr(listing,"global[");
+      outInt(listing,i->k);
+      outChar(listing,']');
+      break;
+    case irStoreG:
+      outStr(listing,"global[");
+      outInt(listing,i->k);
+      outStr(listing,"] = ");
+      printReg(i->a);
+      break;
+    case irLoad:
+      outChar(listing,'[');
+      printReg(i->a);
+      outChar(listing,']');
+      break;
+    case irStore:
+      outChar(listing,'[');
+      printReg(i->a);
+      outStr(listing,"] = ");
+      printReg(i->b);
+      break;
+    case irIn: outStr(listing,"input()"); break;
+    case irOut:
+      outStr(listing,"output(");
+      printReg(i->a);
+      outChar(listing,')');
+      break;
+    case irCall:
+      outStr(listing,i->name);
+      printArgs(i);
+      break;
+    case irPhi:
+      outStr(listing,"phi(");
+      for (j=0;j<i->nargs;j++)
+      { if (j > 0) outStr(listing,", ");
+        printReg(i->args[j]);
+        outStr(listing," B");
+        outInt(listing,i->from[j]->id);
+      }
+      outChar(listing,')');
+      break;
+    default:
+      outStr(listing,"?");
+      break;
+  }
+  outChar(listing,'\n');
+}
+
+static void printBlockName( IrBlock b )
+{ outChar(listing,'B');
+  outInt(listing,b->id);
+}
+
+static void printBlock( IrBlock b )
+{ int i;
+  printBlockName(b);
+  outChar(listing,':');
+  if (b->npred > 0)
+  { outStr(listing,"    preds");
+    for (i=0;i<b->npred;i++)
+    { outChar(listing,' ');
+      printBlockName(b->pred[i]);
+    }
+  }
+  outChar(listing,'\n');
+  for (i=0;i<b->ncode;i++) printInstr(&b->code[i]);
+  outStr(listing,"  ");
+  switch (b->term)
+  { case irJump:
+      outStr(listing,"goto ");
+      printBlockName(b->succ[0]);
+      break;
+    case irBranch:
+      outStr(listing,"if ");
+      printReg(b->a);
+      outChar(listing,' ');
+      outStr(listing,relNames[b->rel - irLT]);
+      outChar(listing,' ');
+      printReg(b->b);
+      outStr(listing," goto ");
+      printBlockName(b->succ[0]);
+      outStr(listing," else ");
+      printBlockName(b->succ[1]);
+      break;
+    default:
+      outStr(listing,"return");
+      if (b->a >= 0)
+      { outChar(listing,' ');
+        printReg(b->a);
+      }
+      break;
+  }
+  outChar(listing,'\n');
+}
+
+/* Procedure irDump prints the IR of program p to
+ * the listing file
+ */
+void irDump( IrProgram p )
+{ IrFunc f;
+  int i;
+  outStr(listing,"\nIR:\n");
+  for (f=p->funcs;f != NULL;f=f->next)
+  { outStr(listing,"\nfunction ");
+    outStr(listing,f->name);
+    outChar(listing,'(');
+    for (i=0;i<f->nparams;i++)
+    { if (i > 0) outStr(listing,", ");
+      printReg(f->params[i]);
+    }
+    outStr(listing,")\n");
+    for (i=0;i<f->nblocks;i++) printBlock(f->blocks[i]);
+  }
+}
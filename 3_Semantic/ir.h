@@ -0,0 +1,147 @@
+/****************************************************/
+/* File: ir.h                                       */
+/* Three-address intermediate representation for    */
+/* the C-MINUS compiler: virtual registers, basic   */
+/* blocks and an explicit control-flow graph for    */
+/* each function                                    */
+/****************************************************/
+
+#ifndef _IR_H_
+#define _IR_H_
+
+/* The IR opcodes. Operands a and b and the result
+ * dst are virtual registers, written vN; -1 means
+ * none. k is a constant or a memory offset
+ */
+typedef enum
+   { irConst,                 /* dst = k */
+     irCopy,                  /* dst = a */
+     irAdd,irSub,irMul,irDiv, /* dst = a op b */
+     irLT,irLE,irGT,irGE,irEQ,irNE, /* dst = a rel b, 0 or 1 */
+     irAddrG,                 /* dst = address of global k */
+     irAddrL,                 /* dst = address of local array k */
+     irLoadG,                 /* dst = global k */
+     irStoreG,                /* global k = a */
+     irLoad,                  /* dst = memory[a] */
+     irStore,                 /* memory[a] = b */
+     irIn,                    /* dst = input() */
+     irOut,                   /* output(a) */
+     irCall,                  /* dst = name(args) */
+     irPhi,                   /* dst = args[i] when coming
+                                 from block from[i] */
+     irNop                    /* removed by an optimization */
+   } IrOp;
+
+typedef struct
+   { IrOp op;
+     int dst, a, b;
+     int k;
+     char * name;   /* the function called by irCall */
+     int nargs;     /* arguments of irCall or irPhi */
+     int * args;
+     struct IrBlockRec ** from; /* the predecessor each
+                                   irPhi argument comes from */
+     int lineno;
+     int mark;      /* scratch for the passes */
+   } IrInstr;
+
+/* the ways a basic block can end */
+typedef enum
+   { irJump,    /* go to succ[0] */
+     irBranch,  /* if a rel b go to succ[0] else succ[1] */
+     irReturn   /* return a, or nothing if a is -1 */
+   } IrTermKind;
+
+typedef struct IrBlockRec
+   { int id;         /* index in the function's blocks */
+     IrInstr * code;
+     int ncode, capcode;
+     IrTermKind term;
+     IrOp rel;       /* comparison of an irBranch */
+     int a, b;       /* operands of the terminator */
+     int nsucc;
+     struct IrBlockRec * succ[2];
+     int npred;
+     struct IrBlockRec ** pred;
+     int mark;       /* scratch for the passes */
+     int label;      /* code label used by the backend */
+   } * IrBlock;
+
+typedef struct IrFuncRec
+   { char * name;
+     int nparams;
+     int * params;      /* the register of each parameter */
+     int returnsValue;
+     int nregs;         /* virtual registers v0 .. v(nregs-1) */
+     int nblocks, capblocks;
+     IrBlock * blocks;  /* blocks[0] is the entry */
+     int arraySize;     /* memory words of the local arrays */
+     int label;         /* entry label used by the backend */
+     struct IrFuncRec * next;
+   } * IrFunc;
+
+typedef struct
+   { IrFunc funcs;
+     int globalSize;    /* memory words of the globals */
+   } * IrProgram;
+
+/* Function irMalloc allocates n bytes of zeroed
+ * memory, and stops the compiler if there is none
+ */
+void * irMalloc( int n );
+
+/* Procedure irGrow makes room for n elements of
+ * size bytes in the array at *p holding *cap
+ */
+void irGrow( void ** p, int * cap, int n, int size );
+
+/* Function irNewBlock adds an empty block ending
+ * in a return to f and returns it
+ */
+IrBlock irNewBlock( IrFunc f );
+
+/* Function irEmit appends an instruction with the
+ * given opcode and operands to block blk and
+ * returns it
+ */
+IrInstr * irEmit( IrBlock blk, IrOp op, int dst, int a, int b, int k );
+
+/* Function irInsert inserts an instruction like
+ * irEmit does, but at position pos of block blk
+ */
+IrInstr * irInsert( IrBlock blk, int pos, IrOp op, int dst, int a, int b, int k );
+
+/* Procedure irRemoveNops removes the irNop
+ * instructions of block blk
+ */
+void irRemoveNops( IrBlock blk );
+
+/* Function irNewReg returns a new virtual register of f */
+int irNewReg( IrFunc f );
+
+/* Function irIsRel tells if op is a comparison */
+int irIsRel( IrOp op );
+
+/* Function irNegate returns the comparison that is
+ * true exactly when rel is false
+ */
+IrOp irNegate( IrOp rel );
+
+/* Function irFindFunc returns the function called
+ * name in p, or NULL
+ */
+IrFunc irFindFunc( IrProgram p, char * name );
+
+/* Procedure irBuildCFG removes the blocks not
+ * reachable from the entry of f, puts the others
+ * in reverse postorder and computes their
+ * predecessors
+ */
+void irBuildCFG( IrFunc f );
+
+/* Procedure irDump prints the IR of program p to
+ * the listing file
+ */
+void irDump( IrProgram p );
+
+#endif
@@ -0,0 +1,462 @@
+/****************************************************/
+/* File: irgen.c                                    */
+/* Lowering of the syntax tree to three-address IR  */
+/* for the C-MINUS compiler                         */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "ir.h"
+#include "irgen.h"
+
+/* The offset field of a symbol holds, while lowering,
+ * the register of a scalar local or parameter, the
+ * register holding the address of an array parameter,
+ * the offset of a local array in the function's array
+ * area, or the offset of a global.
+ *
+ * The symbol table scopes are entered in the same
+ * order as by the traversal in analyze.c.
+ */
+
+static IrProgram prog;
+static IrFunc curFunc;
+static IrBlock curBlock;
+static int curLine = 0;
+
+/* the block after the entry of the current function,
+ * where its calls to itself in a return go, and
+ * whether they may; see isTailCall
+ */
+static IrBlock bodyBlock;
+static int tailCalls;
+
+/* the scope the code being lowered is in */
+static ScopeList curScope;
+static int functionBody = FALSE;
+
+static int globalOffset = 0;
+
+static void lowerStmts( TreeNode * t );
+static int lowerValue( TreeNode * t );
+
+static IrInstr * emit( IrOp op, int dst, int a, int b, int k )
+{ IrInstr * i = irEmit(curBlock,op,dst,a,b,k);
+  i->lineno = curLine;
+  return i;
+}
+
+/* endJump ends the current block with a jump to b */
+static void endJump( IrBlock b )
+{ curBlock->term = irJump;
+  curBlock->nsucc = 1;
+  curBlock->succ[0] = b;
+}
+
+/* endBranch ends the current block with a branch
+ * to t if a rel b and to f otherwise
+ */
+static void endBranch( IrOp rel, int a, int b, IrBlock t, IrBlock f )
+{ curBlock->term = irBranch;
+  curBlock->rel = rel;
+  curBlock->a = a;
+  curBlock->b = b;
+  curBlock->nsucc = 2;
+  curBlock->succ[0] = t;
+  curBlock->succ[1] = f;
+}
+
+static int isGlobal( BucketList l )
+{ return st_lookup_now(tree,l->name) == l; }
+
+/* varSize returns the number of memory words
+ * of the variable declared by t
+ */
+static int varSize( TreeNode * t )
+{ if (t->child[0] != NULL) return t->child[0]->attr.val;
+  return 1;
+}
+
+/* hasLocalArray tells if an array variable is
+ * declared in the tree t
+ */
+static int hasLocalArray( TreeNode * t )
+{ int i;
+  for (;t != NULL;t = t->sibling)
+  { if ((t->nodekind == StmtK) && (t->kind.stmt == VarDeclK))
+    { if (t->child[0] != NULL) return TRUE;
+    }
+    else
+      for (i=0;i<MAXCHILDREN;i++)
+        if (hasLocalArray(t->child[i])) return TRUE;
+  }
+  return FALSE;
+}
+
+/* relOp returns the IR comparison for token op,
+ * or irNop if op is not a comparison
+ */
+static IrOp relOp( TokenType op )
+{ switch (op)
+  { case LT: return irLT;
+    case LE: return irLE;
+    case GT: return irGT;
+    case GE: return irGE;
+    case EQ: return irEQ;
+    case NE: return irNE;
+    default: return irNop;
+  }
+}
+
+/* hasAssign tells if the tree list t contains an
+ * assignment
+ */
+static int hasAssign( TreeNode * t )
+{ int i;
+  for (;t != NULL;t = t->sibling)
+  { if ((t->nodekind == StmtK) && (t->kind.stmt == AssignK)) return TRUE;
+    for (i=0;i<MAXCHILDREN;i++)
+      if (hasAssign(t->child[i])) return TRUE;
+  }
+  return FALSE;
+}
+
+/* protect returns register v, the value of t, or a
+ * copy of it if v may be the register of a variable
+ * assigned by the trees in later, which are
+ * evaluated before v is used
+ */
+static int protect( int v, TreeNode * t, TreeNode * later )
+{ int c;
+  if (!(((t->nodekind == ExpK) && (t->kind.exp == IdK)) ||
+        ((t->nodekind == StmtK) && (t->kind.stmt == AssignK))))
+    return v;
+  if (!hasAssign(later)) return v;
+  c = irNewReg(curFunc);
+  emit(irCopy,c,v,-1,0);
+  return c;
+}
+
+/* address returns a register holding the address
+ * of the first element of array l
+ */
+static int address( BucketList l )
+{ int r;
+  if (l->type.sym == Argument) return l->offset;
+  r = irNewReg(curFunc);
+  if (isGlobal(l)) emit(irAddrG,r,-1,-1,l->offset);
+  else emit(irAddrL,r,-1,-1,l->offset);
+  return r;
+}
+
+/* element returns a register holding the address
+ * of the element of array l indexed by t
+ */
+static int element( BucketList l, TreeNode * t )
+{ int i = lowerValue(t);
+  int r = irNewReg(curFunc);
+  emit(irAdd,r,address(l),i,0);
+  return r;
+}
+
+/* lowerCall lowers a call and returns the register
+ * holding its result, or -1
+ */
+static int lowerCall( TreeNode * t )
+{ TreeNode * p;
+  IrInstr * i;
+  int * args, n, r = -1;
+  if (strcmp(t->attr.name,"input") == 0)
+  { r = irNewReg(curFunc);
+    emit(irIn,r,-1,-1,0);
+    return r;
+  }
+  if (strcmp(t->attr.name,"output") == 0)
+  { emit(irOut,-1,lowerValue(t->child[0]),-1,0);
+    return -1;
+  }
+  for (p=t->child[0],n=0;p != NULL;p=p->sibling) n++;
+  args = (int *) irMalloc(n * sizeof(int));
+  for (p=t->child[0],n=0;p != NULL;p=p->sibling,n++)
+    args[n] = protect(lowerValue(p),p,p->sibling);
+  if (st_lookup(tree,t->attr.name)->type.ret == Integer)
+    r = irNewReg(curFunc);
+  i = emit(irCall,r,-1,-1,0);
+  i->name = t->attr.name;
+  i->nargs = n;
+  i->args = args;
+  return r;
+}
+
+/* isTailCall tells if the returned expression t is
+ * a call of the current function to itself that
+ * can reuse its frame. It cannot when the function
+ * has local arrays, whose address might be passed
+ */
+static int isTailCall( TreeNode * t )
+{ return tailCalls && (t->nodekind == StmtK) && (t->kind.stmt == CallK) &&
+         (strcmp(t->attr.name,curFunc->name) == 0);
+}
+
+/* lowerTailCall lowers the call t in isTailCall to
+ * copies of the arguments into the parameters and a
+ * jump to the start of the body
+ */
+static void lowerTailCall( TreeNode * t )
+{ TreeNode * p;
+  int * args, n, i, c;
+  args = (int *) irMalloc(curFunc->nparams * sizeof(int));
+  for (p=t->child[0],n=0;p != NULL;p=p->sibling,n++)
+    args[n] = protect(lowerValue(p),p,p->sibling);
+  /* an argument held by another parameter is copied
+     first, as that parameter may be assigned before */
+  for (n=0;n<curFunc->nparams;n++)
+    for (i=0;i<curFunc->nparams;i++)
+      if ((i != n) && (args[n] == curFunc->params[i]))
+      { c = irNewReg(curFunc);
+        emit(irCopy,c,args[n],-1,0);
+        args[n] = c;
+        break;
+      }
+  for (n=0;n<curFunc->nparams;n++)
+    if (args[n] != curFunc->params[n])
+      emit(irCopy,curFunc->params[n],args[n],-1,0);
+  endJump(bodyBlock);
+  free(args);
+}
+
+/* lowerAssign lowers an assignment and returns the
+ * register holding the value assigned
+ */
+static int lowerAssign( TreeNode * t )
+{ TreeNode * v = t->child[0];
+  BucketList l = st_lookup(curScope,v->attr.name);
+  int r, a;
+  if (v->child[0] != NULL)
+  { a = element(l,v->child[0]);
+    r = lowerValue(t->child[1]);
+    emit(irStore,-1,a,r,0);
+  }
+  else if (isGlobal(l))
+  { r = lowerValue(t->child[1]);
+    emit(irStoreG,-1,r,-1,l->offset);
+  }
+  else
+  { r = lowerValue(t->child[1]);
+    emit(irCopy,l->offset,r,-1,0);
+    r = l->offset;
+  }
+  return r;
+}
+
+/* lowerValue lowers the expression t and returns
+ * the register holding its value, or -1
+ */
+static int lowerValue( TreeNode * t )
+{ BucketList l;
+  IrOp op;
+  int a, b, r;
+  curLine = t->lineno;
+  if (t->nodekind == StmtK)
+  { if (t->kind.stmt == AssignK) return lowerAssign(t);
+    if (t->kind.stmt == CallK) return lowerCall(t);
+    return -1;
+  }
+  switch (t->kind.exp)
+  { case ConstK:
+      r = irNewReg(curFunc);
+      emit(irConst,r,-1,-1,t->attr.val);
+      return r;
+    case IdK:
+      l = st_lookup(curScope,t->attr.name);
+      if (l->type.ret != IntegerPtr)
+      { if (!isGlobal(l)) return l->offset;
+        r = irNewReg(curFunc);
+        emit(irLoadG,r,-1,-1,l->offset);
+        return r;
+      }
+      /* a whole array is passed by address */
+      if (t->child[0] == NULL) return address(l);
+      a = element(l,t->child[0]);
+      r = irNewReg(curFunc);
+      emit(irLoad,r,a,-1,0);
+      return r;
+    case OpK:
+      a = protect(lowerValue(t->child[0]),t->child[0],t->child[1]);
+      b = lowerValue(t->child[1]);
+      curLine = t->lineno;
+      switch (t->attr.op)
+      { case PLUS: op = irAdd; break;
+        case MINUS: op = irSub; break;
+        case TIMES: op = irMul; break;
+        case OVER: op = irDiv; break;
+        default: op = relOp(t->attr.op); break;
+      }
+      r = irNewReg(curFunc);
+      emit(op,r,a,b,0);
+      return r;
+    default:
+      return -1;
+  }
+}
+
+/* lowerCond lowers the test t of an if or while
+ * statement, ending the current block with a branch
+ * to yes if t is true and to no otherwise
+ */
+static void lowerCond( TreeNode * t, IrBlock yes, IrBlock no )
+{ int a, b;
+  if ((t->nodekind == ExpK) && (t->kind.exp == OpK) &&
+      (relOp(t->attr.op) != irNop))
+  { a = protect(lowerValue(t->child[0]),t->child[0],t->child[1]);
+    b = lowerValue(t->child[1]);
+    endBranch(relOp(t->attr.op),a,b,yes,no);
+    return;
+  }
+  a = lowerValue(t);
+  b = irNewReg(curFunc);
+  emit(irConst,b,-1,-1,0);
+  endBranch(irNE,a,b,yes,no);
+}
+
+/* lowerFunction lowers a function declaration */
+static void lowerFunction( TreeNode * t )
+{ IrFunc f;
+  IrFunc * last;
+  TreeNode * p;
+  BucketList l;
+  if (!st_lookup_now(tree,t->attr.name)->used)
+  { /* not reachable from main */
+    tree->visit++;
+    return;
+  }
+  f = (IrFunc) irMalloc(sizeof(struct IrFuncRec));
+  f->name = t->attr.name;
+  f->returnsValue = (t->type == Integer);
+  f->label = -1;
+  for (last=&prog->funcs;*last != NULL;last=&(*last)->next);
+  *last = f;
+  curFunc = f;
+  curScope = tree->child[tree->visit++];
+  curScope->visit = 0;
+  functionBody = TRUE;
+  for (p=t->child[0];p != NULL;p=p->sibling)
+    if (p->kind.stmt == ParamK) f->nparams++;
+  f->params = (int *) irMalloc(f->nparams * sizeof(int));
+  f->nparams = 0;
+  for (p=t->child[0];p != NULL;p=p->sibling)
+    if (p->kind.stmt == ParamK)
+    { l = st_lookup_now(curScope,p->attr.name);
+      l->offset = irNewReg(f);
+      f->params[f->nparams++] = l->offset;
+    }
+  curBlock = irNewBlock(f);
+  bodyBlock = irNewBlock(f);
+  tailCalls = !hasLocalArray(t->child[1]);
+  endJump(bodyBlock);
+  curBlock = bodyBlock;
+  lowerStmts(t->child[1]);
+  irBuildCFG(f);
+  curScope = tree;
+}
+
+/* lowerStmt lowers the single statement t */
+static void lowerStmt( TreeNode * t )
+{ ScopeList savedScope;
+  BucketList l;
+  IrBlock b1, b2, b3;
+  curLine = t->lineno;
+  if (t->nodekind == ExpK)
+  { lowerValue(t);
+    return;
+  }
+  switch (t->kind.stmt)
+  { case VarDeclK:
+      l = st_lookup_now(curScope,t->attr.name);
+      if (curScope == tree)
+      { if (!l->used) break;
+        l->offset = globalOffset;
+        globalOffset += varSize(t);
+      }
+      else if (t->child[0] == NULL)
+        l->offset = irNewReg(curFunc);
+      else
+      { l->offset = curFunc->arraySize;
+        curFunc->arraySize += varSize(t);
+      }
+      break;
+    case FunDeclK:
+      lowerFunction(t);
+      break;
+    case CompoundK:
+      savedScope = curScope;
+      /* the body of a function shares its scope */
+      if (functionBody) functionBody = FALSE;
+      else
+      { curScope = curScope->child[curScope->visit++];
+        curScope->visit = 0;
+      }
+      lowerStmts(t->child[0]);
+      lowerStmts(t->child[1]);
+      curScope = savedScope;
+      break;
+    case IfK:
+    case IfElseK:
+      b1 = irNewBlock(curFunc);
+      b3 = irNewBlock(curFunc);
+      b2 = (t->kind.stmt == IfElseK) ? irNewBlock(curFunc) : b3;
+      lowerCond(t->child[0],b1,b2);
+      curBlock = b1;
+      lowerStmts(t->child[1]);
+      endJump(b3);
+      if (t->kind.stmt == IfElseK)
+      { curBlock = b2;
+        lowerStmts(t->child[2]);
+        endJump(b3);
+      }
+      curBlock = b3;
+      break;
+    case WhileK:
+      b1 = irNewBlock(curFunc);
+      b2 = irNewBlock(curFunc);
+      b3 = irNewBlock(curFunc);
+      endJump(b1);
+      curBlock = b1;
+      lowerCond(t->child[0],b2,b3);
+      curBlock = b2;
+      lowerStmts(t->child[1]);
+      endJump(b1);
+      curBlock = b3;
+      break;
+    case ReturnK:
+    case NReturnK:
+      if ((t->kind.stmt == ReturnK) && isTailCall(t->child[0]))
+        lowerTailCall(t->child[0]);
+      else
+      { curBlock->term = irReturn;
+        curBlock->a = (t->kind.stmt == ReturnK) ? lowerValue(t->child[0]) : -1;
+      }
+      /* code after a return is unreachable */
+      curBlock = irNewBlock(curFunc);
+      break;
+    default:
+      lowerValue(t);
+      break;
+  }
+}
+
+static void lowerStmts( TreeNode * t )
+{ for (;t != NULL;t = t->sibling) lowerStmt(t); }
+
+/* Function irGen lowers the syntax tree to IR and
+ * returns the program
+ */
+IrProgram irGen( TreeNode * syntaxTree )
+{ prog = (IrProgram) irMalloc(sizeof(*prog));
+  globalOffset = 0;
+  curScope = tree;
+  tree->visit = 0;
+  lowerStmts(syntaxTree);
+  prog->globalSize = globalOffset;
+  return prog;
+}
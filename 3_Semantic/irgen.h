@@ -0,0 +1,19 @@
+/****************************************************/
+/* File: irgen.h                                    */
+/* Lowering of the type-checked syntax tree to the  */
+/* three-address IR for the C-MINUS compiler        */
+/****************************************************/
+
+#ifndef _IRGEN_H_
+#define _IRGEN_H_
+
+#include "ir.h"
+
+/* Function irGen lowers the syntax tree to IR and
+ * returns the program. Scalar locals and parameters
+ * become virtual registers; globals and arrays stay
+ * in memory
+ */
+IrProgram irGen( TreeNode * syntaxTree );
+
+#endif
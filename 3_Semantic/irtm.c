@@ -0,0 +1,250 @@
+/****************************************************/
+/* File: irtm.c                                     */
+/* TM code generation from the three-address IR     */
+/* for the C-MINUS compiler                         */
+/****************************************************/
+
+#include "globals.h"
+#include "code.h"
+#include "peep.h"
+#include "cgen.h"
+#include "ir.h"
+#include "irtm.h"
+#include "stack.h"
+
+/* The activation record is laid out as by cgen.c:
+ *
+ *    0(fp)      the caller's fp
+ *   -1(fp)      the return address
+ *   -2-i(fp)    parameter i
+ *   below that  one slot for every other virtual
+ *               register, then the local arrays,
+ *               then the frames of the calls
+ *
+ * Every instruction loads its operands from their
+ * slots into ac1 and ac and stores its result back.
+ * Within a block, the register last stored from or
+ * loaded into ac is not loaded again.
+ */
+
+/* the slot of each register of the current function */
+static int * slot = NULL;
+
+/* offset of the first local array word */
+static int arrayBase;
+
+/* offset of the frame of a call */
+static int frameTop;
+
+/* the register whose value is in ac, or -1 */
+static int acReg = -1;
+
+/* TM jumps taken when a comparison is true,
+ * indexed by IrOp - irLT
+ */
+static char * jumpNames[] = { "JLT","JLE","JGT","JGE","JEQ","JNE" };
+
+/* TM opcodes of the arithmetic IR instructions */
+static char * arithNames[] = { "ADD","SUB","MUL","DIV" };
+
+/* load puts the value of register v into r */
+static void load( int r, int v )
+{ if (v == acReg)
+  { if (r != ac) emitRM("LDA",r,0,ac,"copy register");
+    return;
+  }
+  emitRM("LD",r,slot[v],fp,"load register");
+  if (r == ac) acReg = v;
+}
+
+/* store stores ac into the slot of register v */
+static void store( int v )
+{ emitRM("ST",ac,slot[v],fp,"store register");
+  acReg = v;
+}
+
+/* layoutFrame assigns the slots of the registers
+ * of f and the offsets of its arrays and calls
+ */
+static void layoutFrame( IrFunc f )
+{ int v, next;
+  free(slot);
+  slot = (int *) irMalloc((f->nregs+1) * sizeof(int));
+  for (v=0;v<f->nregs;v++) slot[v] = 0;
+  for (v=0;v<f->nparams;v++) slot[f->params[v]] = -2 - v;
+  next = -2 - f->nparams;
+  for (v=0;v<f->nregs;v++)
+    if (slot[v] == 0) slot[v] = next--;
+  arrayBase = next - f->arraySize + 1;
+  frameTop = next - f->arraySize;
+}
+
+/* genCall generates code for the call i */
+static void genCall( IrProgram p, IrInstr * i )
+{ IrFunc callee = irFindFunc(p,i->name);
+  int j;
+  for (j=0;j<i->nargs;j++)
+  { load(ac,i->args[j]);
+    emitRM("ST",ac,frameTop-2-j,fp,"call: store argument");
+  }
+  emitRM("ST",fp,frameTop,fp,"call: store old fp");
+  emitRM("LDA",fp,frameTop,fp,"call: push frame");
+  emitRM("LDA",ac,2,pc,"call: compute return address");
+  emitRM("ST",ac,-1,fp,"call: store return address");
+  emitRM_Label("LDA",pc,callee->label,"call: jump to function");
+  stackCall(i->name,frameTop);
+  emitRM("LD",fp,0,fp,"call: pop frame");
+  acReg = -1;
+  if (i->dst >= 0) store(i->dst);
+}
+
+/* genInstr generates code for instruction i */
+static void genInstr( IrProgram p, IrInstr * i )
+{ emitLine(i->lineno);
+  switch (i->op)
+  { case irConst:
+      emitRM("LDC",ac,i->k,0,"load const");
+      store(i->dst);
+      break;
+    case irCopy:
+      load(ac,i->a);
+      store(i->dst);
+      break;
+    case irAdd: case irSub: case irMul: case irDiv:
+      load(ac1,i->a);
+      load(ac,i->b);
+      emitRO(arithNames[i->op - irAdd],ac,ac1,ac,"op");
+      store(i->dst);
+      break;
+    case irLT: case irLE: case irGT: case irGE: case irEQ: case irNE:
+      load(ac1,i->a);
+      load(ac,i->b);
+      emitRO("SUB",ac,ac1,ac,"op relational");
+      emitRM(jumpNames[i->op - irLT],ac,2,pc,"br if true");
+      emitRM("LDC",ac,0,ac,"false case");
+      emitRM("LDA",pc,1,pc,"unconditional jmp");
+      emitRM("LDC",ac,1,ac,"true case");
+      store(i->dst);
+      break;
+    case irAddrG:
+      emitRM("LDA",ac,i->k,gp,"global array address");
+      store(i->dst);
+      break;
+    case irAddrL:
+      emitRM("LDA",ac,arrayBase+i->k,fp,"local array address");
+      store(i->dst);
+      break;
+    case irLoadG:
+      emitRM("LD",ac,i->k,gp,"load global");
+      store(i->dst);
+      break;
+    case irStoreG:
+      load(ac,i->a);
+      emitRM("ST",ac,i->k,gp,"store global");
+      break;
+    case irLoad:
+      load(ac,i->a);
+      emitRM("LD",ac,0,ac,"load element");
+      store(i->dst);
+      break;
+    case irStore:
+      load(ac1,i->a);
+      load(ac,i->b);
+      emitRM("ST",ac,0,ac1,"store element");
+      break;
+    case irIn:
+      emitRO("IN",ac,0,0,"read integer value");
+      store(i->dst);
+      break;
+    case irOut:
+      load(ac,i->a);
+      emitRO("OUT",ac,0,0,"write ac");
+      break;
+    case irCall:
+      genCall(p,i);
+      break;
+    case irNop:
+      break;
+    default:
+      emitComment("BUG: IR instruction without TM code");
+      break;
+  }
+}
+
+/* genBlock generates code for block b; the block
+ * laid out after it is next, or NULL
+ */
+static void genBlock( IrProgram p, IrBlock b, IrBlock next )
+{ int i;
+  emitLabel(b->label);
+  acReg = -1;
+  for (i=0;i<b->ncode;i++) genInstr(p,&b->code[i]);
+  switch (b->term)
+  { case irJump:
+      if (b->succ[0] != next)
+        emitRM_Label("LDA",pc,b->succ[0]->label,"jmp");
+      break;
+    case irBranch:
+      load(ac1,b->a);
+      load(ac,b->b);
+      emitRO("SUB",ac,ac1,ac,"compare");
+      if (b->succ[0] == next)
+        emitRM_Label(jumpNames[irNegate(b->rel) - irLT],ac,
+                     b->succ[1]->label,"br if false");
+      else
+      { emitRM_Label(jumpNames[b->rel - irLT],ac,
+                     b->succ[0]->label,"br if true");
+        if (b->succ[1] != next)
+          emitRM_Label("LDA",pc,b->succ[1]->label,"jmp");
+      }
+      break;
+    default:
+      if (b->a >= 0) load(ac,b->a);
+      emitRM("LD",pc,-1,fp,"return to caller");
+      break;
+  }
+}
+
+/* genFunction generates code for function f */
+static void genFunction( IrProgram p, IrFunc f )
+{ int i;
+  if (TraceCode)
+  { emitComment("-> function");
+    emitComment(f->name);
+  }
+  layoutFrame(f);
+  stackFunction(f->name);
+  stackFrame(-frameTop);
+  for (i=0;i<f->nblocks;i++) f->blocks[i]->label = newLabel();
+  emitLabel(f->label);
+  for (i=0;i<f->nblocks;i++)
+    genBlock(p,f->blocks[i],i+1 < f->nblocks ? f->blocks[i+1] : NULL);
+  if (TraceCode) emitComment("<- function");
+}
+
+/* Procedure irCodeGen generates TM code for program
+ * p to the code file
+ */
+void irCodeGen( IrProgram p, char * codefile )
+{ char * s = malloc(strlen(codefile)+7);
+  IrFunc f, entry = NULL;
+  strcpy(s,"File: ");
+  strcat(s,codefile);
+  emitComment("C-MINUS Compilation to TM Code");
+  emitComment(s);
+  free(s);
+  for (f=p->funcs;f != NULL;f=f->next)
+  { f->label = newLabel();
+    if (strcmp(f->name,"main") == 0) entry = f;
+  }
+  if (entry == NULL)
+  { fprintf(listing,"Code generation error: no main function\n");
+    Error = TRUE;
+    return;
+  }
+  genPrelude(entry->label);
+  for (f=p->funcs;f != NULL;f=f->next) genFunction(p,f);
+  stackGlobals(p->globalSize);
+  if (Optimize) peephole();
+  writeCode(code,TmFormat);
+}
@@ -0,0 +1,19 @@
+/****************************************************/
+/* File: irtm.h                                     */
+/* TM code generation from the three-address IR     */
+/* for the C-MINUS compiler                         */
+/****************************************************/
+
+#ifndef _IRTM_H_
+#define _IRTM_H_
+
+#include "ir.h"
+
+/* Procedure irCodeGen generates TM code for program
+ * p to the code file, like codeGen does from the
+ * syntax tree. codefile is the name of the code
+ * file, printed as a comment in it
+ */
+void irCodeGen( IrProgram p, char * codefile );
+
+#endif
@@ -0,0 +1,438 @@
+/****************************************************/
+/* File: loop.c                                     */
+/* Natural loops and loop optimizations of the IR   */
+/* for the C-MINUS compiler                         */
+/****************************************************/
+
+#include "globals.h"
+#include "ir.h"
+#include "ssa.h"
+#include "loop.h"
+
+/* A natural loop is found for every block h that
+ * dominates one of its predecessors: it holds h and
+ * the blocks that reach those predecessors without
+ * going through h. The loops are optimized from the
+ * innermost out, so that what is moved out of an
+ * inner loop can be moved again out of the next.
+ *
+ * In each loop, the instructions whose operands are
+ * all defined outside it are moved to its
+ * preheader, the block before h that jumps to it.
+ * Then, for every induction variable i, a phi of
+ * the header stepped by i = i + c with c invariant,
+ * the values of the form i * s + o computed from it
+ * in two or more instructions get their own
+ * induction variable, stepped by c * s.
+ */
+
+typedef struct
+   { IrBlock header;
+     IrBlock preheader; /* NULL when there is none */
+     IrBlock latch;     /* the only block jumping back to
+                           the header, or NULL */
+     int size;          /* blocks in the loop */
+     char * in;         /* in[b] tells if block b is in it */
+   } Loop;
+
+/* an induction variable phi = phi(init, next) with
+ * next = phi + step
+ */
+typedef struct
+   { int phi, init, next, step;
+   } Basic;
+
+/* the block and position defining a register */
+typedef struct
+   { int block, idx;
+   } Def;
+
+static IrFunc func;
+static Loop * loops;
+static int nloops;
+static Def * defs = NULL;
+static int ndefs, capdefs = 0;
+
+/* dominates tells if block a dominates block b */
+static int dominates( int * idom, int a, int b )
+{ while ((b != a) && (b != 0)) b = idom[b];
+  return b == a;
+}
+
+/* addPreheaders puts a block on the edge entering
+ * each loop header from outside when the block
+ * there has another successor, and tells if it did
+ */
+static int addPreheaders( IrFunc f )
+{ int * idom = irDominators(f);
+  int nb = f->nblocks, changed = FALSE, back, outside, b, i, j;
+  IrBlock h, p, n;
+  for (b=1;b<nb;b++)
+  { h = f->blocks[b];
+    p = NULL;
+    back = FALSE;
+    outside = 0;
+    for (j=0;j<h->npred;j++)
+      if (dominates(idom,b,h->pred[j]->id)) back = TRUE;
+      else
+      { p = h->pred[j];
+        outside++;
+      }
+    if (!back || (outside != 1) || (p->nsucc == 1)) continue;
+    n = irNewBlock(f);
+    n->term = irJump;
+    n->nsucc = 1;
+    n->succ[0] = h;
+    for (j=0;j<p->nsucc;j++)
+      if (p->succ[j] == h) p->succ[j] = n;
+    for (i=0;(i<h->ncode) && (h->code[i].op == irPhi);i++)
+      for (j=0;j<h->code[i].nargs;j++)
+        if (h->code[i].from[j] == p) h->code[i].from[j] = n;
+    changed = TRUE;
+  }
+  free(idom);
+  if (changed) irBuildCFG(f);
+  return changed;
+}
+
+/* findLoops fills in loops, innermost first */
+static void findLoops( IrFunc f )
+{ int * idom, * stack, nb, sp, nback, outside, b, j, k;
+  IrBlock h, x, p;
+  Loop * l, t;
+  addPreheaders(f);
+  nb = f->nblocks;
+  idom = irDominators(f);
+  stack = (int *) irMalloc(nb * sizeof(int));
+  loops = (Loop *) irMalloc(nb * sizeof(Loop));
+  nloops = 0;
+  for (b=1;b<nb;b++)
+  { h = f->blocks[b];
+    l = &loops[nloops];
+    l->in = NULL;
+    nback = 0;
+    for (j=0;j<h->npred;j++)
+    { x = h->pred[j];
+      if (!dominates(idom,b,x->id)) continue;
+      if (l->in == NULL)
+      { l->in = (char *) irMalloc(nb);
+        l->in[b] = TRUE;
+        l->size = 1;
+      }
+      l->latch = (nback++ == 0) ? x : NULL;
+      sp = 0;
+      if (!l->in[x->id])
+      { l->in[x->id] = TRUE;
+        l->size++;
+        stack[sp++] = x->id;
+      }
+      while (sp > 0)
+      { x = f->blocks[stack[--sp]];
+        for (k=0;k<x->npred;k++)
+          if (!l->in[x->pred[k]->id])
+          { l->in[x->pred[k]->id] = TRUE;
+            l->size++;
+            stack[sp++] = x->pred[k]->id;
+          }
+      }
+    }
+    if (l->in == NULL) continue;
+    l->header = h;
+    l->preheader = NULL;
+    p = NULL;
+    outside = 0;
+    for (j=0;j<h->npred;j++)
+      if (!l->in[h->pred[j]->id])
+      { p = h->pred[j];
+        outside++;
+      }
+    if ((outside == 1) && (p->nsucc == 1)) l->preheader = p;
+    nloops++;
+  }
+  /* a loop inside another has fewer blocks */
+  for (j=1;j<nloops;j++)
+    for (k=j;(k > 0) && (loops[k-1].size > loops[k].size);k--)
+    { t = loops[k];
+      loops[k] = loops[k-1];
+      loops[k-1] = t;
+    }
+  free(idom);
+  free(stack);
+}
+
+/* setDef records that register r is defined at
+ * position i of block b
+ */
+static void setDef( int r, int b, int i )
+{ irGrow((void **) &defs,&capdefs,r+1,sizeof(Def));
+  while (ndefs <= r) defs[ndefs++].block = -1;
+  defs[r].block = b;
+  defs[r].idx = i;
+}
+
+/* findDefs records where each register of f is
+ * defined
+ */
+static void findDefs( IrFunc f )
+{ int b, i;
+  ndefs = 0;
+  for (b=0;b<f->nblocks;b++)
+    for (i=0;i<f->blocks[b]->ncode;i++)
+      if ((f->blocks[b]->code[i].op != irNop) &&
+          (f->blocks[b]->code[i].dst >= 0))
+        setDef(f->blocks[b]->code[i].dst,b,i);
+}
+
+/* defOf returns the instruction defining r, or
+ * NULL for a parameter
+ */
+static IrInstr * defOf( int r )
+{ if ((r < 0) || (r >= ndefs) || (defs[r].block < 0)) return NULL;
+  return &func->blocks[defs[r].block]->code[defs[r].idx];
+}
+
+/* invariant tells if register r has the same value
+ * in every iteration of loop l
+ */
+static int invariant( Loop * l, int r )
+{ return (r < 0) || (r >= ndefs) || (defs[r].block < 0) ||
+         !l->in[defs[r].block];
+}
+
+/********************************************/
+/* loop-invariant code motion               */
+/********************************************/
+
+/* hoistable tells if in may be computed before the
+ * loop, even when the loop body is never run
+ */
+static int hoistable( IrInstr * in )
+{ IrInstr * d;
+  switch (in->op)
+  { case irConst: case irCopy: case irAdd: case irSub: case irMul:
+    case irLT: case irLE: case irGT: case irGE: case irEQ: case irNE:
+    case irAddrG: case irAddrL:
+      return TRUE;
+    case irDiv:
+      /* only by a constant, which cannot be 0 */
+      d = defOf(in->b);
+      return (d != NULL) && (d->op == irConst) && (d->k != 0);
+    default:
+      return FALSE;
+  }
+}
+
+/* hoist moves the invariant instructions of loop l
+ * to its preheader and returns how many it moved
+ */
+static int hoist( Loop * l )
+{ int moved = 0, b, i;
+  IrInstr * in, * h;
+  for (b=0;b<func->nblocks;b++)
+  { if (!l->in[b]) continue;
+    for (i=0;i<func->blocks[b]->ncode;i++)
+    { in = &func->blocks[b]->code[i];
+      if (!hoistable(in) || !invariant(l,in->a) || !invariant(l,in->b))
+        continue;
+      h = irEmit(l->preheader,in->op,in->dst,in->a,in->b,in->k);
+      h->lineno = in->lineno;
+      in->op = irNop;
+      setDef(h->dst,l->preheader->id,l->preheader->ncode-1);
+      moved++;
+    }
+  }
+  return moved;
+}
+
+/********************************************/
+/* induction-variable strength reduction    */
+/********************************************/
+
+/* what is known of the registers of a loop: base is
+ * the induction variable a register is computed
+ * from, or -1, its value being base * scale + offset;
+ * a scale of -1 stands for 1 and an offset of -1
+ * for 0. cost counts the instructions that compute
+ * it in the loop, and used tells if something other
+ * than another of these instructions reads it
+ */
+static int * base, * scale, * offset, * cost, * used;
+static int nknown;
+
+static int isIV( int r )
+{ return (r >= 0) && (r < nknown) && (base[r] >= 0); }
+
+/* emit returns a register holding a op b, computed
+ * in the preheader of l; an operand of -1 is the 1
+ * of a product or the 0 of a sum
+ */
+static int emit( Loop * l, IrOp op, int a, int b )
+{ IrInstr * in;
+  if ((op != irSub) && (a < 0)) return b;
+  if (b < 0) return a;
+  if (a < 0)
+  { in = irEmit(l->preheader,irConst,irNewReg(func),-1,-1,0);
+    setDef(in->dst,l->preheader->id,l->preheader->ncode-1);
+    a = in->dst;
+  }
+  in = irEmit(l->preheader,op,irNewReg(func),a,b,0);
+  setDef(in->dst,l->preheader->id,l->preheader->ncode-1);
+  return in->dst;
+}
+
+/* derive works out the induction value computed by
+ * in, if any
+ */
+static void derive( Loop * l, IrInstr * in )
+{ int x, k, r = in->dst;
+  if ((r < 0) || (r >= nknown)) return;
+  if (isIV(in->a) && invariant(l,in->b))
+  { x = in->a;
+    k = in->b;
+  }
+  else if (isIV(in->b) && invariant(l,in->a) &&
+           ((in->op == irAdd) || (in->op == irMul)))
+  { x = in->b;
+    k = in->a;
+  }
+  else return;
+  switch (in->op)
+  { case irCopy:
+      scale[r] = scale[x];
+      offset[r] = offset[x];
+      cost[r] = cost[x];
+      break;
+    case irAdd: case irSub:
+      scale[r] = scale[x];
+      offset[r] = emit(l,in->op,offset[x],k);
+      cost[r] = cost[x] + 1;
+      break;
+    case irMul:
+      scale[r] = emit(l,irMul,scale[x],k);
+      offset[r] = (offset[x] < 0) ? -1 : emit(l,irMul,offset[x],k);
+      cost[r] = cost[x] + 1;
+      break;
+    default:
+      return;
+  }
+  base[r] = base[x];
+}
+
+/* markUse records that r is read by in, or by a
+ * terminator if in is NULL
+ */
+static void markUse( Loop * l, int r, int b, IrInstr * in )
+{ if (!isIV(r)) return;
+  if ((in == NULL) || !l->in[b] || (in->op == irPhi) || !isIV(in->dst))
+    used[r] = TRUE;
+}
+
+/* reduce makes the induction variables of loop l
+ * and returns how many it made
+ */
+static int reduce( Loop * l )
+{ IrBlock h = l->header, blk;
+  IrInstr * in, * phi;
+  Basic * basics;
+  int nbasic = 0, made = 0, b, i, j, r, n, s, s2, init, step;
+  if ((l->preheader == NULL) || (l->latch == NULL) || (h->npred != 2))
+    return 0;
+  nknown = func->nregs;
+  base = (int *) irMalloc(nknown * sizeof(int));
+  scale = (int *) irMalloc(nknown * sizeof(int));
+  offset = (int *) irMalloc(nknown * sizeof(int));
+  cost = (int *) irMalloc(nknown * sizeof(int));
+  used = (int *) irMalloc(nknown * sizeof(int));
+  basics = (Basic *) irMalloc(nknown * sizeof(Basic));
+  for (r=0;r<nknown;r++) base[r] = -1;
+  /* the induction variables of the header */
+  for (i=0;(i<h->ncode) && (h->code[i].op == irPhi);i++)
+  { phi = &h->code[i];
+    n = (phi->from[0] == l->preheader) ? 0 : 1;
+    init = phi->args[n];
+    in = defOf(phi->args[1-n]);
+    if ((in == NULL) || (in->op != irAdd) || invariant(l,in->dst)) continue;
+    if ((in->a == phi->dst) && invariant(l,in->b)) step = in->b;
+    else if ((in->b == phi->dst) && invariant(l,in->a)) step = in->a;
+    else continue;
+    basics[nbasic].phi = phi->dst;
+    basics[nbasic].init = init;
+    basics[nbasic].next = in->dst;
+    basics[nbasic].step = step;
+    base[phi->dst] = nbasic++;
+    scale[phi->dst] = offset[phi->dst] = -1;
+  }
+  /* the values computed from them, in dominance order */
+  if (nbasic > 0)
+    for (b=0;b<func->nblocks;b++)
+      if (l->in[b])
+        for (i=0;i<func->blocks[b]->ncode;i++)
+          if (func->blocks[b]->code[i].op != irPhi)
+            derive(l,&func->blocks[b]->code[i]);
+  for (b=0;b<func->nblocks;b++)
+  { blk = func->blocks[b];
+    for (i=0;i<blk->ncode;i++)
+    { in = &blk->code[i];
+      markUse(l,in->a,b,in);
+      markUse(l,in->b,b,in);
+      for (j=0;j<in->nargs;j++) markUse(l,in->args[j],b,in);
+    }
+    markUse(l,blk->a,b,NULL);
+    markUse(l,blk->b,b,NULL);
+  }
+  /* r = s, with s = phi(init * scale + offset, s2) and
+     s2 = s + step * scale next to the step of the base */
+  for (r=0;r<nknown;r++)
+  { if (!isIV(r) || (cost[r] < 2) || !used[r]) continue;
+    init = emit(l,irAdd,emit(l,irMul,basics[base[r]].init,scale[r]),offset[r]);
+    step = emit(l,irMul,basics[base[r]].step,scale[r]);
+    s = irNewReg(func);
+    s2 = irNewReg(func);
+    in = defOf(r);
+    in->op = irCopy;
+    in->a = s;
+    in->b = -1;
+    blk = func->blocks[defs[basics[base[r]].next].block];
+    for (i=0;blk->code[i].dst != basics[base[r]].next;i++);
+    irInsert(blk,i+1,irAdd,s2,s,step,0);
+    phi = irInsert(h,0,irPhi,s,-1,-1,s);
+    phi->nargs = 2;
+    phi->args = (int *) irMalloc(2 * sizeof(int));
+    phi->from = (IrBlock *) irMalloc(2 * sizeof(IrBlock));
+    for (j=0;j<2;j++)
+    { phi->from[j] = h->pred[j];
+      phi->args[j] = (h->pred[j] == l->preheader) ? init : s2;
+    }
+    findDefs(func);
+    made++;
+  }
+  free(base);
+  free(scale);
+  free(offset);
+  free(cost);
+  free(used);
+  free(basics);
+  return made;
+}
+
+/* Procedure irOptimizeLoops moves the invariant
+ * code out of the natural loops of f and reduces
+ * the strength of their induction values
+ */
+void irOptimizeLoops( IrFunc f, int * count )
+{ int n, b;
+  Loop * l;
+  func = f;
+  findLoops(f);
+  count[0] += nloops;
+  for (n=0;n<nloops;n++)
+  { l = &loops[n];
+    if (l->preheader == NULL) continue;
+    findDefs(f);
+    count[1] += hoist(l);
+    count[2] += reduce(l);
+    for (b=0;b<f->nblocks;b++) irRemoveNops(f->blocks[b]);
+  }
+  for (n=0;n<nloops;n++) free(loops[n].in);
+  free(loops);
+}
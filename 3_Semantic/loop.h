@@ -0,0 +1,24 @@
+/****************************************************/
+/* File: loop.h                                     */
+/* Natural loops and loop optimizations of the IR   */
+/* for the C-MINUS compiler                         */
+/****************************************************/
+
+#ifndef _LOOP_H_
+#define _LOOP_H_
+
+#include "ir.h"
+
+/* Procedure irOptimizeLoops finds the natural loops
+ * of f, adding preheaders where needed, moves the
+ * instructions computing the same value on every
+ * iteration out of them and gives the values i * k + c
+ * computed from an induction variable i their own
+ * induction variable, stepped by an addition. f must
+ * be in SSA form. It adds the number of loops to
+ * count[0], of instructions moved to count[1] and
+ * of induction variables made to count[2]
+ */
+void irOptimizeLoops( IrFunc f, int * count );
+
+#endif
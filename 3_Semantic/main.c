@@ -6,6 +6,7 @@
 /****************************************************/
 
 #include "globals.h"
+#include <time.h>
 
 /* set NO_PARSE to TRUE to get a scanner-only compiler */
 #define NO_PARSE FALSE
@@ -15,17 +16,25 @@
 /* set NO_CODE to TRUE to get a compiler that does not
  * generate code
  */
-#define NO_CODE TRUE
+#define NO_CODE FALSE
 
 #include "util.h"
-#if NO_PARSE
 #include "scan.h"
-#else
+#include "tokcache.h"
+#include "pscan.h"
+#include "token.h"
+#include "outbuf.h"
+#if !NO_PARSE
 #include "parse.h"
 #if !NO_ANALYZE
 #include "analyze.h"
 #if !NO_CODE
 #include "cgen.h"
+#include "code.h"
+#include "irgen.h"
+#include "irtm.h"
+#include "opt.h"
+#include "stack.h"
 #endif
 #endif
 #endif
@@ -42,17 +51,152 @@ int TraceScan = FALSE;
 int TraceParse = FALSE;
 int TraceAnalyze = FALSE;
 int TraceCode = FALSE;
+int FastListing = FALSE;
+int Optimize = FALSE;
+int TracePeephole = FALSE;
+int TraceIrOpt = FALSE;
+int InlineBudget = 30;
 
 int Error = FALSE;
 
-main( int argc, char * argv[] )
+/* directory of the on-disk token cache, or NULL
+ * to scan the source on every run
+ */
+static char * tokenCacheDir = NULL;
+
+/* number of threads for the parallel scanner,
+ * 0 to use the serial getToken
+ */
+static int lexThreads = 0;
+
+/* number of scans to time with --lex-only,
+ * 0 to compile normally
+ */
+static int lexOnlyRuns = 0;
+
+/* codeListing = TRUE causes the generated code to
+ * be printed to the listing file with its labels
+ * and source lines
+ */
+static int codeListing = FALSE;
+
+/* useIr = TRUE causes the code to be generated
+ * through the three-address IR; irListing = TRUE
+ * causes the IR to be printed to the listing file;
+ * irOpt = TRUE causes the IR to be optimized
+ */
+static int useIr = FALSE;
+static int irListing = FALSE;
+static int irOpt = FALSE;
+
+/* stackListing = TRUE causes the call graph and the
+ * stack used by each function to be printed to the
+ * listing file
+ */
+static int stackListing = FALSE;
+
+static void usage( char * prog )
+{ fprintf(stderr,"usage: %s [--token-cache=<dir>] [--lex-threads=<n>]"
+                 " [--lex-only=<runs>]\n"
+                 "       [--trace-scan] [--trace-parse] [--trace-analyze]"
+                 " [--trace-code]\n"
+                 "       [--code-listing] [--fast-listing] [-O]"
+                 " [--trace-peephole] [--ir] [--ir-dump]\n"
+                 "       [--ir-opt] [--trace-ir-opt] [--no-inline]"
+                 " [--inline-budget=<n>]\n"
+                 "       [--stack-report] <filename>\n",prog);
+  exit(1);
+}
+
+/* lexBenchmark scans the source runs times without
+ * any trace output and reports the scanner throughput
+ */
+static void lexBenchmark( int runs )
+{ struct timespec t0, t1;
+  double secs;
+  long len;
+  char * text = readFile(source,&len);
+  int i;
+  if (text == NULL)
+  { fprintf(stderr,"Out of memory reading source\n");
+    exit(1);
+  }
+  TraceScan = FALSE;
+  EchoSource = FALSE;
+  clock_gettime(CLOCK_MONOTONIC,&t0);
+  for (i=0;i<runs;i++)
+  { resetTokens();
+    if (lexThreads > 0)
+      parallelTokens(text,len,lexThreads);
+    else
+    { resetScanner();
+      while (getToken() != ENDFILE);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC,&t1);
+  secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  if (secs <= 0) secs = 1e-9;
+  fprintf(listing,"lex-only: %d runs, %ld bytes, %d tokens per run, %.3f s\n",
+          runs,len,tokenCount,secs);
+  fprintf(listing,"lex-only: %.0f tokens/s, %.0f bytes/s\n",
+          (double) tokenCount * runs / secs,(double) len * runs / secs);
+  free(text);
+}
+
+int main( int argc, char * argv[] )
 { TreeNode * syntaxTree;
   char pgm[120]; /* source code file name */
-  if (argc != 2)
-    { fprintf(stderr,"usage: %s <filename>\n",argv[0]);
-      exit(1);
+  char * file = NULL;
+  int i;
+  for (i=1;i<argc;i++)
+  { if (strncmp(argv[i],"--token-cache=",14) == 0)
+      tokenCacheDir = argv[i]+14;
+    else if (strncmp(argv[i],"--lex-threads=",14) == 0)
+      lexThreads = atoi(argv[i]+14);
+    else if (strncmp(argv[i],"--lex-only=",11) == 0)
+    { lexOnlyRuns = atoi(argv[i]+11);
+      if (lexOnlyRuns <= 0) usage(argv[0]);
     }
-  strcpy(pgm,argv[1]) ;
+    else if (strcmp(argv[i],"--trace-scan") == 0)
+      TraceScan = TRUE;
+    else if (strcmp(argv[i],"--trace-parse") == 0)
+      TraceParse = TRUE;
+    else if (strcmp(argv[i],"--trace-analyze") == 0)
+      TraceAnalyze = TRUE;
+    else if (strcmp(argv[i],"--trace-code") == 0)
+      TraceCode = TRUE;
+    else if (strcmp(argv[i],"--code-listing") == 0)
+      codeListing = TRUE;
+    else if (strcmp(argv[i],"--fast-listing") == 0)
+      FastListing = TRUE;
+    else if (strcmp(argv[i],"-O") == 0)
+      Optimize = TRUE;
+    else if (strcmp(argv[i],"--trace-peephole") == 0)
+      Optimize = TracePeephole = TRUE;
+    else if (strcmp(argv[i],"--ir") == 0)
+      useIr = TRUE;
+    else if (strcmp(argv[i],"--ir-dump") == 0)
+      useIr = irListing = TRUE;
+    else if (strcmp(argv[i],"--ir-opt") == 0)
+      useIr = irOpt = TRUE;
+    else if (strcmp(argv[i],"--trace-ir-opt") == 0)
+      useIr = irOpt = TraceIrOpt = TRUE;
+    else if (strcmp(argv[i],"--no-inline") == 0)
+      InlineBudget = 0;
+    else if (strncmp(argv[i],"--inline-budget=",16) == 0)
+    { InlineBudget = atoi(argv[i]+16);
+      if (InlineBudget < 0) usage(argv[0]);
+    }
+    else if (strcmp(argv[i],"--stack-report") == 0)
+      stackListing = TRUE;
+    else if ((argv[i][0] == '-') || (file != NULL))
+      usage(argv[0]);
+    else
+      file = argv[i];
+  }
+  if ((file == NULL) || (strlen(file) >= sizeof(pgm)-4))
+    usage(argv[0]);
+  strcpy(pgm,file) ;
   if (strchr (pgm, '.') == NULL)
      strcat(pgm,".tny");
   source = fopen(pgm,"r");
@@ -61,27 +205,51 @@ main( int argc, char * argv[] )
     exit(1);
   }
   listing = stdout; /* send listing to screen */
-  fprintf(listing,"\nC-MINUS COMPILATION: %s\n",pgm);
+  outStr(listing,"\nC-MINUS COMPILATION: ");
+  outStr(listing,pgm);
+  outChar(listing,'\n');
+  if (lexOnlyRuns > 0)
+  { outFlush();
+    lexBenchmark(lexOnlyRuns);
+    fclose(source);
+    return 0;
+  }
+  /* a traced scan has to run the scanner itself */
+  if (!TraceScan && !EchoSource)
+  { if (tokenCacheDir != NULL)
+      cacheTokens(tokenCacheDir,lexThreads);
+    else if (lexThreads > 0)
+    { long len;
+      char * text = readFile(source,&len);
+      if (text == NULL)
+      { fprintf(stderr,"Out of memory reading %s\n",pgm);
+        exit(1);
+      }
+      parallelTokens(text,len,lexThreads);
+      free(text);
+    }
+  }
 #if NO_PARSE
   while (getToken()!=ENDFILE);
 #else
   syntaxTree = parse();
   if (TraceParse) {
-    fprintf(listing,"\nSyntax tree:\n");
+    outStr(listing,"\nSyntax tree:\n");
     printTree(syntaxTree);
   }
 #if !NO_ANALYZE
   if (! Error)
-  { if (TraceAnalyze) fprintf(listing,"\nBuilding Symbol Table...\n");
+  { if (TraceAnalyze) outStr(listing,"\nBuilding Symbol Table...\n");
     buildSymtab(syntaxTree);
-    if (TraceAnalyze) fprintf(listing,"\nChecking Types...\n");
+    if (TraceAnalyze) outStr(listing,"\nChecking Types...\n");
     typeCheck(syntaxTree);
-    if (TraceAnalyze) fprintf(listing,"\nType Checking Finished\n");
+    if (TraceAnalyze) outStr(listing,"\nType Checking Finished\n");
+    if (! Error) markReachable(syntaxTree);
   }
 #if !NO_CODE
   if (! Error)
   { char * codefile;
-    int fnlen = strcspn(pgm,".");
+    int fnlen = strrchr(pgm,'.') - pgm;
     codefile = (char *) calloc(fnlen+4, sizeof(char));
     strncpy(codefile,pgm,fnlen);
     strcat(codefile,".tm");
@@ -90,12 +258,26 @@ main( int argc, char * argv[] )
     { printf("Unable to open %s\n",codefile);
       exit(1);
     }
-    codeGen(syntaxTree,codefile);
+    outFlush();
+    if (useIr)
+    { IrProgram p = irGen(syntaxTree);
+      if (irOpt) irOptimize(p);
+      if (irListing) irDump(p);
+      irCodeGen(p,codefile);
+    }
+    else
+      codeGen(syntaxTree,codefile);
     fclose(code);
+    if (stackListing && ! Error) stackReport();
+    if (codeListing && ! Error)
+    { outStr(listing,"\nGenerated code:\n");
+      writeCode(listing,ListingFormat);
+    }
   }
 #endif
 #endif
 #endif
+  outFlush();
   fclose(source);
   return 0;
 }
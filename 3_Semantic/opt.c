@@ -0,0 +1,694 @@
+/****************************************************/
+/* File: opt.c                                      */
+/* Optimization passes on the IR for the C-MINUS    */
+/* compiler                                         */
+/****************************************************/
+
+#include "globals.h"
+#include "outbuf.h"
+#include "ir.h"
+#include "ssa.h"
+#include "loop.h"
+#include "inline.h"
+#include "opt.h"
+#include <time.h>
+
+/* The passes are listed in optPasses and run in
+ * that order on each function. A pass counts what
+ * it did in up to MAXCOUNTS counters.
+ */
+#define MAXCOUNTS 3
+
+typedef struct
+   { char * name;
+     void (* run)( IrFunc f, int * count );
+     char * counts[MAXCOUNTS]; /* what each counter counts */
+     int count[MAXCOUNTS];
+     double secs;
+   } OptPass;
+
+/* the registers read by instructions and terminators,
+ * indexed from useStart[r] to useStart[r+1]; useIdx
+ * is the instruction in useBlock, or -1 for the
+ * terminator
+ */
+static int * useStart = NULL, * useBlock = NULL, * useIdx = NULL;
+
+static void addUse( int r, int b, int i, int fill )
+{ if (r < 0) return;
+  if (fill)
+  { useBlock[useStart[r]] = b;
+    useIdx[useStart[r]++] = i;
+  }
+  else useStart[r+1]++;
+}
+
+/* buildUses fills in the use lists of f */
+static void buildUses( IrFunc f )
+{ int fill, b, i, j, r;
+  IrBlock blk;
+  IrInstr * in;
+  free(useStart);
+  free(useBlock);
+  free(useIdx);
+  useStart = (int *) irMalloc((f->nregs+2) * sizeof(int));
+  for (fill=0;fill<2;fill++)
+  { if (fill)
+    { for (r=0;r<f->nregs;r++) useStart[r+1] += useStart[r];
+      useBlock = (int *) irMalloc(useStart[f->nregs] * sizeof(int));
+      useIdx = (int *) irMalloc(useStart[f->nregs] * sizeof(int));
+    }
+    for (b=0;b<f->nblocks;b++)
+    { blk = f->blocks[b];
+      for (i=0;i<blk->ncode;i++)
+      { in = &blk->code[i];
+        addUse(in->a,b,i,fill);
+        addUse(in->b,b,i,fill);
+        for (j=0;j<in->nargs;j++) addUse(in->args[j],b,i,fill);
+      }
+      addUse(blk->a,b,-1,fill);
+      addUse(blk->b,b,-1,fill);
+    }
+  }
+  /* filling moved each start to the next one */
+  for (r=f->nregs;r>0;r--) useStart[r] = useStart[r-1];
+  useStart[0] = 0;
+}
+
+/* fold computes x op y into *r; it returns FALSE
+ * if that cannot be done at compile time
+ */
+static int fold( IrOp op, int x, int y, int * r )
+{ switch (op)
+  { case irAdd: *r = x + y; break;
+    case irSub: *r = x - y; break;
+    case irMul: *r = x * y; break;
+    case irDiv:
+      if (y == 0) return FALSE;
+      *r = x / y;
+      break;
+    case irLT: *r = x < y; break;
+    case irLE: *r = x <= y; break;
+    case irGT: *r = x > y; break;
+    case irGE: *r = x >= y; break;
+    case irEQ: *r = x == y; break;
+    case irNE: *r = x != y; break;
+    default: return FALSE;
+  }
+  return TRUE;
+}
+
+/********************************************/
+/* sparse conditional constant propagation  */
+/********************************************/
+
+/* the lattice values of the registers */
+typedef enum { latTop, latConst, latBottom } Lattice;
+
+static Lattice * kind;
+static int * value;
+static int * execBlock, * execEdge;
+static int * cfgWork, ncfg;
+static int * ssaWork, nssa;
+
+/* lower lowers the value of register r */
+static void lower( int r, Lattice k, int v )
+{ if (k <= kind[r]) return;
+  kind[r] = k;
+  value[r] = v;
+  ssaWork[nssa++] = r;
+}
+
+/* edgeExec tells if the edge from p to b is executable */
+static int edgeExec( IrBlock p, IrBlock b )
+{ int k;
+  for (k=0;k<p->nsucc;k++)
+    if ((p->succ[k] == b) && execEdge[p->id*2+k]) return TRUE;
+  return FALSE;
+}
+
+static void evalInstr( IrBlock b, IrInstr * in )
+{ Lattice k = latTop;
+  int v = 0, j, a;
+  if (in->dst < 0) return;
+  switch (in->op)
+  { case irPhi:
+      for (j=0;j<in->nargs;j++)
+      { if (!edgeExec(in->from[j],b)) continue;
+        a = in->args[j];
+        if ((kind[a] == latBottom) ||
+            ((kind[a] == latConst) && (k == latConst) && (value[a] != v)))
+        { k = latBottom;
+          break;
+        }
+        if (kind[a] == latConst)
+        { k = latConst;
+          v = value[a];
+        }
+      }
+      break;
+    case irConst:
+      k = latConst;
+      v = in->k;
+      break;
+    case irCopy:
+      k = kind[in->a];
+      v = value[in->a];
+      break;
+    case irAdd: case irSub: case irMul: case irDiv:
+    case irLT: case irLE: case irGT: case irGE: case irEQ: case irNE:
+      if ((kind[in->a] == latBottom) || (kind[in->b] == latBottom))
+        k = latBottom;
+      else if ((kind[in->a] == latConst) && (kind[in->b] == latConst))
+        k = fold(in->op,value[in->a],value[in->b],&v) ? latConst : latBottom;
+      break;
+    default:
+      k = latBottom;
+      break;
+  }
+  lower(in->dst,k,v);
+}
+
+static void markEdge( IrBlock b, int k )
+{ IrBlock s = b->succ[k];
+  int i;
+  if (execEdge[b->id*2+k]) return;
+  execEdge[b->id*2+k] = TRUE;
+  if (!execBlock[s->id])
+  { execBlock[s->id] = TRUE;
+    cfgWork[ncfg++] = s->id;
+  }
+  else
+    for (i=0;(i<s->ncode) && (s->code[i].op == irPhi);i++)
+      evalInstr(s,&s->code[i]);
+}
+
+static void evalTerm( IrBlock b )
+{ int r;
+  if (b->term == irJump) markEdge(b,0);
+  else if (b->term == irBranch)
+  { if ((kind[b->a] == latConst) && (kind[b->b] == latConst))
+    { fold(b->rel,value[b->a],value[b->b],&r);
+      markEdge(b,r ? 0 : 1);
+    }
+    else if ((kind[b->a] == latBottom) || (kind[b->b] == latBottom))
+    { markEdge(b,0);
+      markEdge(b,1);
+    }
+  }
+}
+
+/* rewrite replaces the registers found constant by
+ * constants, drops the phi arguments and branches
+ * on edges never executed, and returns the number
+ * of branches removed
+ */
+static int rewrite( IrFunc f, int * constants )
+{ int b, i, j, n, branches = 0;
+  IrBlock blk;
+  IrInstr * in, phi;
+  for (b=0;b<f->nblocks;b++)
+  { blk = f->blocks[b];
+    if (!execBlock[b]) continue;
+    for (i=0;i<blk->ncode;i++)
+    { in = &blk->code[i];
+      if ((in->dst >= 0) && (kind[in->dst] == latConst) &&
+          (in->op != irConst) && (in->op != irCall) && (in->op != irIn))
+      { free(in->args);
+        free(in->from);
+        in->args = NULL;
+        in->from = NULL;
+        in->nargs = 0;
+        in->op = irConst;
+        in->k = value[in->dst];
+        in->a = in->b = -1;
+        (*constants)++;
+      }
+      else if (in->op == irPhi)
+      { for (j=0,n=0;j<in->nargs;j++)
+          if (edgeExec(in->from[j],blk))
+          { in->args[n] = in->args[j];
+            in->from[n++] = in->from[j];
+          }
+        in->nargs = n;
+        if (n == 1)
+        { in->op = irCopy;
+          in->a = in->args[0];
+          free(in->args);
+          free(in->from);
+          in->args = NULL;
+          in->from = NULL;
+          in->nargs = 0;
+        }
+      }
+    }
+    /* the phis left go back to the head of the block,
+       ahead of those made constants or copies, as the
+       passes after only look at its leading phis */
+    for (i=0,n=0;i<blk->ncode;i++)
+      if (blk->code[i].op == irPhi)
+      { phi = blk->code[i];
+        for (j=i;j>n;j--) blk->code[j] = blk->code[j-1];
+        blk->code[n++] = phi;
+      }
+    if ((blk->term == irBranch) &&
+        (execEdge[b*2] != execEdge[b*2+1]))
+    { blk->term = irJump;
+      blk->succ[0] = blk->succ[execEdge[b*2] ? 0 : 1];
+      blk->nsucc = 1;
+      branches++;
+    }
+  }
+  return branches;
+}
+
+static void sccp( IrFunc f, int * count )
+{ int n = f->nregs, nb = f->nblocks, r, u, i;
+  IrBlock blk;
+  buildUses(f);
+  kind = (Lattice *) irMalloc(n * sizeof(Lattice));
+  value = (int *) irMalloc(n * sizeof(int));
+  execBlock = (int *) irMalloc(nb * sizeof(int));
+  execEdge = (int *) irMalloc(2 * nb * sizeof(int));
+  cfgWork = (int *) irMalloc(nb * sizeof(int));
+  ssaWork = (int *) irMalloc(2 * n * sizeof(int));
+  ncfg = nssa = 0;
+  for (i=0;i<f->nparams;i++) kind[f->params[i]] = latBottom;
+  execBlock[0] = TRUE;
+  cfgWork[ncfg++] = 0;
+  while ((ncfg > 0) || (nssa > 0))
+  { if (ncfg > 0)
+    { blk = f->blocks[cfgWork[--ncfg]];
+      for (i=0;i<blk->ncode;i++) evalInstr(blk,&blk->code[i]);
+      evalTerm(blk);
+    }
+    else
+    { r = ssaWork[--nssa];
+      for (u=useStart[r];u<useStart[r+1];u++)
+      { blk = f->blocks[useBlock[u]];
+        if (!execBlock[blk->id]) continue;
+        if (useIdx[u] < 0) evalTerm(blk);
+        else evalInstr(blk,&blk->code[useIdx[u]]);
+      }
+    }
+  }
+  count[1] += rewrite(f,&count[0]);
+  irBuildCFG(f);
+  count[2] += nb - f->nblocks;
+  free(kind);
+  free(value);
+  free(execBlock);
+  free(execEdge);
+  free(cfgWork);
+  free(ssaWork);
+}
+
+/********************************************/
+/* copy propagation                         */
+/********************************************/
+
+static int * rep;
+
+static int find( int r )
+{ while ((r >= 0) && (rep[r] != r)) r = rep[r];
+  return r;
+}
+
+static void copyProp( IrFunc f, int * count )
+{ int b, i, j;
+  IrBlock blk;
+  IrInstr * in;
+  rep = (int *) irMalloc(f->nregs * sizeof(int));
+  for (i=0;i<f->nregs;i++) rep[i] = i;
+  for (b=0;b<f->nblocks;b++)
+    for (i=0;i<f->blocks[b]->ncode;i++)
+    { in = &f->blocks[b]->code[i];
+      if (in->op == irCopy)
+      { rep[in->dst] = in->a;
+        count[0]++;
+      }
+    }
+  for (b=0;b<f->nblocks;b++)
+  { blk = f->blocks[b];
+    for (i=0;i<blk->ncode;i++)
+    { in = &blk->code[i];
+      in->a = find(in->a);
+      in->b = find(in->b);
+      for (j=0;j<in->nargs;j++) in->args[j] = find(in->args[j]);
+    }
+    blk->a = find(blk->a);
+    blk->b = find(blk->b);
+  }
+  free(rep);
+}
+
+/********************************************/
+/* dead code elimination                    */
+/********************************************/
+
+/* hasEffect tells if in must be kept even when
+ * its result is not used
+ */
+static int hasEffect( IrInstr * in )
+{ switch (in->op)
+  { case irStoreG: case irStore: case irIn: case irOut: case irCall:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+static void dce( IrFunc f, int * count )
+{ int * defBlock, * defIdx, * work, nwork = 0, cap = 0;
+  int b, i, j, r;
+  IrBlock blk;
+  IrInstr * in;
+  defBlock = (int *) irMalloc(f->nregs * sizeof(int));
+  defIdx = (int *) irMalloc(f->nregs * sizeof(int));
+  work = NULL;
+  for (r=0;r<f->nregs;r++) defBlock[r] = -1;
+  for (b=0;b<f->nblocks;b++)
+  { blk = f->blocks[b];
+    for (i=0;i<blk->ncode;i++)
+    { in = &blk->code[i];
+      in->mark = FALSE;
+      if (in->dst >= 0)
+      { defBlock[in->dst] = b;
+        defIdx[in->dst] = i;
+      }
+    }
+  }
+  /* mark the instructions with effects and the
+     terminators, then what they read */
+  for (b=0;b<f->nblocks;b++)
+  { blk = f->blocks[b];
+    irGrow((void **) &work,&cap,nwork+2,sizeof(int));
+    if (blk->a >= 0) work[nwork++] = blk->a;
+    if (blk->b >= 0) work[nwork++] = blk->b;
+    for (i=0;i<blk->ncode;i++)
+    { in = &blk->code[i];
+      if (!hasEffect(in)) continue;
+      in->mark = TRUE;
+      irGrow((void **) &work,&cap,nwork+2+in->nargs,sizeof(int));
+      if (in->a >= 0) work[nwork++] = in->a;
+      if (in->b >= 0) work[nwork++] = in->b;
+      for (j=0;j<in->nargs;j++) work[nwork++] = in->args[j];
+    }
+  }
+  while (nwork > 0)
+  { r = work[--nwork];
+    if (defBlock[r] < 0) continue;
+    in = &f->blocks[defBlock[r]]->code[defIdx[r]];
+    if (in->mark) continue;
+    in->mark = TRUE;
+    irGrow((void **) &work,&cap,nwork+2+in->nargs,sizeof(int));
+    if (in->a >= 0) work[nwork++] = in->a;
+    if (in->b >= 0) work[nwork++] = in->b;
+    for (j=0;j<in->nargs;j++) work[nwork++] = in->args[j];
+  }
+  for (b=0;b<f->nblocks;b++)
+  { blk = f->blocks[b];
+    for (i=0;i<blk->ncode;i++)
+      if (!blk->code[i].mark)
+      { blk->code[i].op = irNop;
+        count[0]++;
+      }
+    irRemoveNops(blk);
+  }
+  free(defBlock);
+  free(defIdx);
+  free(work);
+}
+
+/********************************************/
+/* SSA construction and destruction         */
+/********************************************/
+
+static void buildSSA( IrFunc f, int * count )
+{ count[0] += irBuildSSA(f); }
+
+static void leaveSSA( IrFunc f, int * count )
+{ count[0] += irLeaveSSA(f); }
+
+/********************************************/
+/* copy coalescing                          */
+/********************************************/
+
+/* sets of registers are bit vectors of words */
+#define WORDBITS 32
+#define HAS(s,r) (((s)[(r)/WORDBITS] >> ((r)%WORDBITS)) & 1)
+#define ADD(s,r) ((s)[(r)/WORDBITS] |= 1u << ((r)%WORDBITS))
+#define DEL(s,r) ((s)[(r)/WORDBITS] &= ~(1u << ((r)%WORDBITS)))
+
+static int words;
+static unsigned * interfere;  /* a row of words per register */
+static int * leader;
+
+static int leaderOf( int r )
+{ while (leader[r] != r) r = leader[r];
+  return r;
+}
+
+static void addEdge( int x, int y )
+{ ADD(&interfere[x*words],y);
+  ADD(&interfere[y*words],x);
+}
+
+/* liveOut computes the registers live at the end of
+ * each block, a row of words per block
+ */
+static unsigned * liveOut( IrFunc f )
+{ unsigned * out, * in, * gen, * kill, * row;
+  int nb = f->nblocks, b, i, j, w, changed = TRUE;
+  IrBlock blk;
+  IrInstr * ins;
+  out = (unsigned *) irMalloc(nb * words * sizeof(unsigned));
+  in = (unsigned *) irMalloc(nb * words * sizeof(unsigned));
+  gen = (unsigned *) irMalloc(nb * words * sizeof(unsigned));
+  kill = (unsigned *) irMalloc(nb * words * sizeof(unsigned));
+  for (b=0;b<nb;b++)
+  { blk = f->blocks[b];
+    row = &gen[b*words];
+    if (blk->a >= 0) ADD(row,blk->a);
+    if (blk->b >= 0) ADD(row,blk->b);
+    for (i=blk->ncode-1;i>=0;i--)
+    { ins = &blk->code[i];
+      if (ins->dst >= 0)
+      { DEL(row,ins->dst);
+        ADD(&kill[b*words],ins->dst);
+      }
+      if (ins->a >= 0) ADD(row,ins->a);
+      if (ins->b >= 0) ADD(row,ins->b);
+      for (j=0;j<ins->nargs;j++) ADD(row,ins->args[j]);
+    }
+  }
+  while (changed)
+  { changed = FALSE;
+    for (b=nb-1;b>=0;b--)
+    { blk = f->blocks[b];
+      for (j=0;j<blk->nsucc;j++)
+        for (w=0;w<words;w++)
+          out[b*words+w] |= in[blk->succ[j]->id*words+w];
+      for (w=0;w<words;w++)
+      { unsigned v = gen[b*words+w] | (out[b*words+w] & ~kill[b*words+w]);
+        if (v != in[b*words+w])
+        { in[b*words+w] = v;
+          changed = TRUE;
+        }
+      }
+    }
+  }
+  free(in);
+  free(gen);
+  free(kill);
+  return out;
+}
+
+/* renumber numbers the registers left by coalesce
+ * from 0, the parameters first; registers that do
+ * not interfere share a number, and so a frame slot,
+ * as out of SSA most are live in a few blocks only
+ */
+static void renumber( IrFunc f, int * count )
+{ int * number, * taken, n = f->nregs, b, i, j, r, s, c;
+  IrBlock blk;
+  IrInstr * in;
+  number = (int *) irMalloc(n * sizeof(int));
+  taken = (int *) irMalloc((n+1) * sizeof(int));
+  for (r=0;r<n;r++) number[r] = -1;
+  for (i=0;i<f->nparams;i++) number[f->params[i]] = i;
+  f->nregs = f->nparams;
+  for (r=0;r<n;r++)
+  { if ((leader[r] != r) || (number[r] >= 0)) continue;
+    /* the lowest number no register it interferes with has */
+    for (s=0;s<n;s++)
+      if (HAS(&interfere[r*words],s) && (number[leaderOf(s)] >= 0))
+        taken[number[leaderOf(s)]] = r + 1;
+    for (c=0;taken[c] == r + 1;c++);
+    number[r] = c;
+    if (c >= f->nregs) f->nregs = c + 1;
+  }
+  for (b=0;b<f->nblocks;b++)
+  { blk = f->blocks[b];
+    for (i=0;i<blk->ncode;i++)
+    { in = &blk->code[i];
+      if (in->dst >= 0) in->dst = number[leaderOf(in->dst)];
+      if (in->a >= 0) in->a = number[leaderOf(in->a)];
+      if (in->b >= 0) in->b = number[leaderOf(in->b)];
+      for (j=0;j<in->nargs;j++) in->args[j] = number[leaderOf(in->args[j])];
+    }
+    if (blk->a >= 0) blk->a = number[leaderOf(blk->a)];
+    if (blk->b >= 0) blk->b = number[leaderOf(blk->b)];
+  }
+  for (i=0;i<f->nparams;i++) f->params[i] = i;
+  count[1] += n - f->nregs;
+  free(number);
+  free(taken);
+}
+
+/* coalesce gives the source and target of copies
+ * the same register when their values are never
+ * live at the same time, which removes the copy,
+ * then renumbers the registers
+ */
+static void coalesce( IrFunc f, int * count )
+{ unsigned * out, * live;
+  int * param, n = f->nregs, b, i, j, r, x, y;
+  IrBlock blk;
+  IrInstr * in;
+  words = (n + WORDBITS - 1) / WORDBITS;
+  out = liveOut(f);
+  interfere = (unsigned *) irMalloc(n * words * sizeof(unsigned));
+  live = (unsigned *) irMalloc(words * sizeof(unsigned));
+  leader = (int *) irMalloc(n * sizeof(int));
+  param = (int *) irMalloc(n * sizeof(int));
+  for (r=0;r<n;r++) leader[r] = r;
+  /* the parameters are all live at the entry */
+  for (i=0;i<f->nparams;i++)
+  { param[f->params[i]] = TRUE;
+    for (j=0;j<i;j++) addEdge(f->params[i],f->params[j]);
+  }
+  for (b=0;b<f->nblocks;b++)
+  { blk = f->blocks[b];
+    memcpy(live,&out[b*words],words * sizeof(unsigned));
+    if (blk->a >= 0) ADD(live,blk->a);
+    if (blk->b >= 0) ADD(live,blk->b);
+    for (i=blk->ncode-1;i>=0;i--)
+    { in = &blk->code[i];
+      if (in->dst >= 0)
+      { for (r=0;r<n;r++)
+          if (HAS(live,r) && (r != in->dst) &&
+              !((in->op == irCopy) && (r == in->a)))
+            addEdge(in->dst,r);
+        DEL(live,in->dst);
+      }
+      if (in->a >= 0) ADD(live,in->a);
+      if (in->b >= 0) ADD(live,in->b);
+      for (j=0;j<in->nargs;j++) ADD(live,in->args[j]);
+    }
+  }
+  for (b=0;b<f->nblocks;b++)
+  { blk = f->blocks[b];
+    for (i=0;i<blk->ncode;i++)
+    { in = &blk->code[i];
+      if (in->op != irCopy) continue;
+      x = leaderOf(in->dst);
+      y = leaderOf(in->a);
+      if ((x == y) || HAS(&interfere[x*words],y) || (param[x] && param[y]))
+        continue;
+      /* a parameter keeps its register */
+      if (param[y])
+      { r = x;
+        x = y;
+        y = r;
+      }
+      leader[y] = x;
+      for (r=0;r<n;r++)
+        if (HAS(&interfere[y*words],r)) addEdge(x,r);
+      count[0]++;
+    }
+  }
+  renumber(f,count);
+  for (b=0;b<f->nblocks;b++)
+  { blk = f->blocks[b];
+    for (i=0;i<blk->ncode;i++)
+    { in = &blk->code[i];
+      if ((in->op == irCopy) && (in->dst == in->a)) in->op = irNop;
+    }
+    irRemoveNops(blk);
+  }
+  free(out);
+  free(interfere);
+  free(live);
+  free(leader);
+  free(param);
+}
+
+/* emptyBlocks makes jumps to a block holding only a
+ * jump go to its target
+ */
+static void emptyBlocks( IrFunc f, int * count )
+{ int nb = f->nblocks, b, k;
+  IrBlock blk, t;
+  for (b=0;b<nb;b++)
+  { blk = f->blocks[b];
+    for (k=0;k<blk->nsucc;k++)
+    { t = blk->succ[k];
+      while ((t->ncode == 0) && (t->term == irJump) && (t->succ[0] != t) &&
+             (t != blk))
+        t = t->succ[0];
+      blk->succ[k] = t;
+    }
+  }
+  irBuildCFG(f);
+  count[0] += nb - f->nblocks;
+}
+
+static OptPass optPasses[] =
+   { { "ssa construction", buildSSA, { "phis" }, { 0 }, 0 },
+     { "constant propagation", sccp,
+       { "constants", "branches folded", "blocks removed" }, { 0 }, 0 },
+     { "copy propagation", copyProp, { "copies" }, { 0 }, 0 },
+     { "dead code", dce, { "instructions" }, { 0 }, 0 },
+     { "loop optimization", irOptimizeLoops,
+       { "loops", "hoisted", "induction variables" }, { 0 }, 0 },
+     { "copy propagation", copyProp, { "copies" }, { 0 }, 0 },
+     { "dead code", dce, { "instructions" }, { 0 }, 0 },
+     { "out of ssa", leaveSSA, { "copies" }, { 0 }, 0 },
+     { "copy coalescing", coalesce, { "copies", "registers" },
+       { 0 }, 0 },
+     { "empty blocks", emptyBlocks, { "blocks removed" }, { 0 }, 0 },
+     { NULL, NULL, { NULL }, { 0 }, 0 } };
+
+/* Procedure irOptimize inlines the small functions
+ * of program p, then optimizes every function in
+ * SSA form
+ */
+void irOptimize( IrProgram p )
+{ OptPass * pass;
+  IrFunc f;
+  struct timespec t0, t1;
+  int i;
+  for (pass=optPasses;pass->name != NULL;pass++)
+  { pass->secs = 0;
+    for (i=0;i<MAXCOUNTS;i++) pass->count[i] = 0;
+  }
+  if (InlineBudget > 0) irInline(p);
+  for (f=p->funcs;f != NULL;f=f->next)
+    for (pass=optPasses;pass->name != NULL;pass++)
+    { clock_gettime(CLOCK_MONOTONIC,&t0);
+      pass->run(f,pass->count);
+      clock_gettime(CLOCK_MONOTONIC,&t1);
+      pass->secs += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    }
+  if (TraceIrOpt)
+  { outFlush();
+    fprintf(listing,"\nIR optimization:\n");
+    for (pass=optPasses;pass->name != NULL;pass++)
+    { fprintf(listing,"  %-22s %9.3f ms",pass->name,pass->secs * 1000);
+      for (i=0;(i<MAXCOUNTS) && (pass->counts[i] != NULL);i++)
+        fprintf(listing,"%s %d %s",i ? "," : "",pass->count[i],pass->counts[i]);
+      fprintf(listing,"\n");
+    }
+  }
+}
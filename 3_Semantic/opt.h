@@ -0,0 +1,21 @@
+/****************************************************/
+/* File: opt.h                                      */
+/* Optimization passes on the IR for the C-MINUS    */
+/* compiler                                         */
+/****************************************************/
+
+#ifndef _OPT_H_
+#define _OPT_H_
+
+#include "ir.h"
+
+/* Procedure irOptimize inlines the calls of program
+ * p to small functions, unless InlineBudget is 0,
+ * then optimizes every function in SSA form. If
+ * TraceIrOpt is TRUE what was inlined, the time
+ * spent in each pass and what it did are printed
+ * to the listing file
+ */
+void irOptimize( IrProgram p );
+
+#endif
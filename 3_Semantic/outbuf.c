@@ -0,0 +1,156 @@
+/****************************************************/
+/* File: outbuf.c                                   */
+/* Buffered listing output implementation           */
+/* for the C-MINUS compiler                         */
+/****************************************************/
+
+#include "globals.h"
+#include "outbuf.h"
+
+/* OUTBUFSIZE is the size of the output buffer */
+#define OUTBUFSIZE (1 << 20)
+
+static char outBuffer[OUTBUFSIZE];
+static int outLen = 0;
+static FILE * outFile = NULL; /* file the buffered text is for */
+
+/* FastListing only selects buffering for the listing
+ * file; output to any other file is always buffered
+ */
+#define BUFFERED(f) (FastListing || ((f) != listing))
+
+/* Procedure outFlush writes out any buffered text */
+void outFlush( void )
+{ if (outLen > 0)
+  { fwrite(outBuffer,1,outLen,outFile);
+    outLen = 0;
+  }
+}
+
+/* reserve makes room for n more characters for f
+ * and returns where they go
+ */
+static char * reserve( FILE * f, int n )
+{ if ((f != outFile) || (outLen + n > OUTBUFSIZE))
+  { outFlush();
+    outFile = f;
+  }
+  return outBuffer + outLen;
+}
+
+/* putBytes buffers the n characters at s for f */
+static void putBytes( FILE * f, const char * s, int n )
+{ char * p;
+  if (n > OUTBUFSIZE)
+  { outFlush();
+    fwrite(s,1,n,f);
+    return;
+  }
+  p = reserve(f,n);
+  memcpy(p,s,n);
+  outLen += n;
+}
+
+/* putSpaces buffers n blanks for f */
+static void putSpaces( FILE * f, int n )
+{ while (n > 0)
+  { int k = n < 64 ? n : 64;
+    memset(reserve(f,k),' ',k);
+    outLen += k;
+    n -= k;
+  }
+}
+
+/* formatInt writes n in decimal to the end of the
+ * 12 character buffer buf and returns its start
+ */
+static char * formatInt( char * buf, int n )
+{ char * p = buf + 12;
+  unsigned u = n < 0 ? 0u - (unsigned) n : (unsigned) n;
+  do
+  { *--p = (char) ('0' + u % 10);
+    u /= 10;
+  } while (u != 0);
+  if (n < 0) *--p = '-';
+  return p;
+}
+
+/* Procedure outStr writes the string s to f */
+void outStr( FILE * f, const char * s )
+{ if (BUFFERED(f)) putBytes(f,s,strlen(s));
+  else fputs(s,f);
+}
+
+/* Procedure outChar writes the character c to f */
+void outChar( FILE * f, int c )
+{ if (BUFFERED(f))
+  { *reserve(f,1) = (char) c;
+    outLen++;
+  }
+  else fputc(c,f);
+}
+
+/* Procedure outInt writes n in decimal to f */
+void outInt( FILE * f, int n )
+{ char buf[12];
+  char * p;
+  if (BUFFERED(f))
+  { p = formatInt(buf,n);
+    putBytes(f,p,buf+12-p);
+  }
+  else fprintf(f,"%d",n);
+}
+
+/* Procedure outPadStr writes s to f left justified
+ * in a field of width characters
+ */
+void outPadStr( FILE * f, const char * s, int width )
+{ int n;
+  if (BUFFERED(f))
+  { n = strlen(s);
+    putBytes(f,s,n);
+    putSpaces(f,width-n);
+  }
+  else fprintf(f,"%-*s",width,s);
+}
+
+/* Procedure outStrRight writes s to f right
+ * justified in a field of width characters
+ */
+void outStrRight( FILE * f, const char * s, int width )
+{ int n;
+  if (BUFFERED(f))
+  { n = strlen(s);
+    putSpaces(f,width-n);
+    putBytes(f,s,n);
+  }
+  else fprintf(f,"%*s",width,s);
+}
+
+/* Procedure outPadInt writes n to f left justified
+ * in a field of width characters
+ */
+void outPadInt( FILE * f, int n, int width )
+{ char buf[12];
+  char * p;
+  if (BUFFERED(f))
+  { p = formatInt(buf,n);
+    putBytes(f,p,buf+12-p);
+    putSpaces(f,width-(buf+12-p));
+  }
+  else fprintf(f,"%-*d",width,n);
+}
+
+/* Procedure outIntRight writes n to f right
+ * justified in a field of width characters
+ */
+void outIntRight( FILE * f, int n, int width )
+{ char buf[12];
+  char * p;
+  if (BUFFERED(f))
+  { p = formatInt(buf,n);
+    putSpaces(f,width-(buf+12-p));
+    putBytes(f,p,buf+12-p);
+  }
+  else fprintf(f,"%*d",width,n);
+}
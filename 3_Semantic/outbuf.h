@@ -0,0 +1,51 @@
+/****************************************************/
+/* File: outbuf.h                                   */
+/* Buffered listing output for the C-MINUS compiler */
+/* The trace printers write through these routines; */
+/* with FastListing set the text is formatted by    */
+/* hand into one large buffer instead of going      */
+/* through a stdio call per column. Output to files */
+/* other than the listing is always buffered        */
+/****************************************************/
+
+#ifndef _OUTBUF_H_
+#define _OUTBUF_H_
+
+/* Procedure outStr writes the string s to f */
+void outStr( FILE * f, const char * s );
+
+/* Procedure outChar writes the character c to f */
+void outChar( FILE * f, int c );
+
+/* Procedure outInt writes n in decimal to f */
+void outInt( FILE * f, int n );
+
+/* Procedure outPadStr writes s to f left justified
+ * in a field of width characters (like "%-*s")
+ */
+void outPadStr( FILE * f, const char * s, int width );
+
+/* Procedure outStrRight writes s to f right
+ * justified in a field of width characters
+ * (like "%*s")
+ */
+void outStrRight( FILE * f, const char * s, int width );
+
+/* Procedure outPadInt writes n to f left justified
+ * in a field of width characters (like "%-*d")
+ */
+void outPadInt( FILE * f, int n, int width );
+
+/* Procedure outIntRight writes n to f right
+ * justified in a field of width characters
+ * (like "%*d")
+ */
+void outIntRight( FILE * f, int n, int width );
+
+/* Procedure outFlush writes out any buffered text.
+ * It must be called before writing to the listing
+ * file by other means
+ */
+void outFlush( void );
+
+#endif
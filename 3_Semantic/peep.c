@@ -0,0 +1,402 @@
+/****************************************************/
+/* File: peep.c                                     */
+/* Peephole optimizer implementation                */
+/* for the C-MINUS compiler                         */
+/****************************************************/
+
+#include "globals.h"
+#include "outbuf.h"
+#include "code.h"
+#include "peep.h"
+
+/* Every rule is tried at every instruction. A rule
+ * removes instructions by setting their opcode to
+ * opNONE; the removed locations are squeezed out
+ * with compactCode after each pass, and passes are
+ * repeated until no rule applies.
+ *
+ * Before the first pass every pc-relative operand
+ * is turned into an absolute target, so that jumps
+ * stay correct when code is removed. refs counts
+ * the jumps to each location, to tell where control
+ * can enter other than from the previous instruction.
+ */
+
+/* MAXPASSES bounds the number of passes */
+#define MAXPASSES 100
+
+/* REGBUDGET bounds the number of instructions
+ * looked at to prove that a register is dead
+ */
+#define REGBUDGET 32
+
+typedef struct
+   { char * name;
+     int (* apply)( int loc );
+     int hits;
+   } PeepRule;
+
+static int * refs = NULL;
+
+/* isJump tells if i may transfer control to its target */
+static int isJump( TmInstr * i )
+{ return ((i->op == opLDA) && (i->r == pc)) ||
+         ((i->op >= opJLT) && (i->op <= opJNE));
+}
+
+/* isGoto tells if i always transfers control to its target */
+static int isGoto( TmInstr * i )
+{ return (i->op == opLDA) && (i->r == pc); }
+
+static int hasTarget( TmInstr * i )
+{ return (i->label >= 0) || (i->target >= 0); }
+
+/* targetOf returns the location i refers to */
+static int targetOf( TmInstr * i )
+{ return (i->label >= 0) ? labelLoc(i->label) : i->target; }
+
+/* resolve returns the first instruction kept
+ * at or after loc, or codeSize
+ */
+static int resolve( int loc )
+{ while ((loc < codeSize) && (codeBuf[loc].op == opNONE)) loc++;
+  return loc;
+}
+
+/* next returns the instruction after loc */
+static int next( int loc )
+{ return resolve(loc+1); }
+
+/* refsTo returns the number of jumps to the
+ * instruction at loc, including jumps to the
+ * removed locations just before it
+ */
+static int refsTo( int loc )
+{ int n = refs[loc];
+  while ((loc > 0) && (codeBuf[loc-1].op == opNONE)) n += refs[--loc];
+  return n;
+}
+
+/* removeInstr removes the instruction at loc */
+static void removeInstr( int loc )
+{ TmInstr * i = &codeBuf[loc];
+  if (hasTarget(i) && (targetOf(i) >= 0)) refs[targetOf(i)]--;
+  free(i->comment);
+  i->comment = NULL;
+  i->op = opNONE;
+}
+
+/* setTarget makes i refer to what j refers to */
+static void setTarget( TmInstr * i, TmInstr * j )
+{ if (hasTarget(i)) refs[targetOf(i)]--;
+  i->label = j->label;
+  i->target = j->target;
+  refs[targetOf(i)]++;
+}
+
+/* readsReg tells if i reads register r */
+static int readsReg( TmInstr * i, int r )
+{ switch (i->op)
+  { case opHALT: case opIN: return FALSE;
+    case opOUT: return i->r == r;
+    case opADD: case opSUB: case opMUL: case opDIV:
+      return (i->s == r) || (i->t == r);
+    case opST: return (i->r == r) || (i->s == r);
+    case opLDC: return FALSE;
+    case opLD: case opLDA: return i->s == r;
+    default: /* conditional jumps */
+      return (i->r == r) || (i->s == r);
+  }
+}
+
+/* writesReg tells if i writes register r */
+static int writesReg( TmInstr * i, int r )
+{ switch (i->op)
+  { case opIN: case opADD: case opSUB: case opMUL: case opDIV:
+    case opLD: case opLDA: case opLDC:
+      return i->r == r;
+    default:
+      return FALSE;
+  }
+}
+
+/* regDead tells if the value of register r at loc
+ * is certainly not used
+ */
+static int regDead( int loc, int r, int budget )
+{ TmInstr * i;
+  while (budget-- > 0)
+  { loc = resolve(loc);
+    if (loc >= codeSize) return TRUE;
+    i = &codeBuf[loc];
+    if (readsReg(i,r)) return FALSE;
+    if (writesReg(i,r) || (i->op == opHALT)) return TRUE;
+    /* a return may pass a value in r */
+    if ((i->op == opLD) && (i->r == pc)) return FALSE;
+    if (isJump(i))
+    { if (!hasTarget(i) || (targetOf(i) < 0)) return FALSE;
+      if (isGoto(i))
+      { loc = targetOf(i);
+        continue;
+      }
+      if (!regDead(targetOf(i),r,budget)) return FALSE;
+    }
+    loc++;
+  }
+  return FALSE;
+}
+
+/* jumpToNext removes a jump to the next instruction */
+static int jumpToNext( int loc )
+{ TmInstr * i = &codeBuf[loc];
+  if (!isJump(i) || !hasTarget(i)) return FALSE;
+  if (resolve(targetOf(i)) != next(loc)) return FALSE;
+  removeInstr(loc);
+  return TRUE;
+}
+
+/* jumpChain makes a jump to an unconditional jump
+ * go directly to its target, and replaces an
+ * unconditional jump to a return by the return
+ */
+static int jumpChain( int loc )
+{ TmInstr * i = &codeBuf[loc], * j;
+  int t;
+  if (!isJump(i) || !hasTarget(i)) return FALSE;
+  t = resolve(targetOf(i));
+  if ((t >= codeSize) || (t == loc)) return FALSE;
+  j = &codeBuf[t];
+  if (isGoto(j) && hasTarget(j))
+  { int t2 = resolve(targetOf(j));
+    if ((t2 == t) || (t2 == loc)) return FALSE;
+    setTarget(i,j);
+    return TRUE;
+  }
+  if (isGoto(i) && (j->op == opLD) && (j->r == pc))
+  { refs[targetOf(i)]--;
+    i->op = opLD;
+    i->d = j->d;
+    i->s = j->s;
+    i->label = i->target = -1;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/* unreachable removes an instruction that follows
+ * an unconditional transfer and is not jumped to
+ */
+static int unreachable( int loc )
+{ TmInstr * i = &codeBuf[loc];
+  int n;
+  if (!isGoto(i) && (i->op != opHALT) &&
+      !((i->op == opLD) && (i->r == pc))) return FALSE;
+  n = next(loc);
+  if ((n >= codeSize) || (refsTo(n) > 0)) return FALSE;
+  removeInstr(n);
+  return TRUE;
+}
+
+/* storeLoad removes a load of the value just stored */
+static int storeLoad( int loc )
+{ TmInstr * i = &codeBuf[loc], * j;
+  int n;
+  if ((i->op != opST) || i->temp || (i->r == pc)) return FALSE;
+  n = next(loc);
+  if ((n >= codeSize) || (refsTo(n) > 0)) return FALSE;
+  j = &codeBuf[n];
+  if ((j->op != opLD) || j->temp || (j->r != i->r) ||
+      (j->d != i->d) || (j->s != i->s)) return FALSE;
+  removeInstr(n);
+  return TRUE;
+}
+
+/* the jump taken when the condition of op is false */
+static TmOp negate( TmOp op )
+{ switch (op)
+  { case opJLT: return opJGE;
+    case opJLE: return opJGT;
+    case opJGT: return opJLE;
+    case opJGE: return opJLT;
+    case opJEQ: return opJNE;
+    default: return opJEQ;
+  }
+}
+
+/* compareBranch replaces the materialization of a
+ * comparison as 0 or 1 that is only tested by JEQ,
+ *      Jcc  ac,T        (T: the true case)
+ *      LDC  ac,0
+ *      LDA  pc,E
+ *   T: LDC  ac,1
+ *   E: JEQ  ac,L
+ * by a single jump on the opposite condition
+ *      J!cc ac,L
+ * provided the value of ac is dead afterwards
+ */
+static int compareBranch( int loc )
+{ int l[5], k;
+  TmInstr * i = &codeBuf[loc], * e;
+  if ((i->op < opJLT) || (i->op > opJNE) || (i->r != ac) ||
+      !hasTarget(i)) return FALSE;
+  l[0] = loc;
+  for (k=1;k<5;k++)
+  { l[k] = next(l[k-1]);
+    if (l[k] >= codeSize) return FALSE;
+  }
+  if ((codeBuf[l[1]].op != opLDC) || (codeBuf[l[1]].r != ac) ||
+      (codeBuf[l[1]].d != 0)) return FALSE;
+  if (!isGoto(&codeBuf[l[2]]) || !hasTarget(&codeBuf[l[2]]) ||
+      (resolve(targetOf(&codeBuf[l[2]])) != l[4])) return FALSE;
+  if ((codeBuf[l[3]].op != opLDC) || (codeBuf[l[3]].r != ac) ||
+      (codeBuf[l[3]].d != 1)) return FALSE;
+  e = &codeBuf[l[4]];
+  if ((e->op != opJEQ) || (e->r != ac) || !hasTarget(e)) return FALSE;
+  if (resolve(targetOf(i)) != l[3]) return FALSE;
+  if ((refsTo(l[1]) != 0) || (refsTo(l[2]) != 0) ||
+      (refsTo(l[3]) != 1) || (refsTo(l[4]) != 1)) return FALSE;
+  if (!regDead(targetOf(e),ac,REGBUDGET) ||
+      !regDead(next(l[4]),ac,REGBUDGET)) return FALSE;
+  i->op = negate(i->op);
+  setTarget(i,e);
+  for (k=1;k<5;k++) removeInstr(l[k]);
+  return TRUE;
+}
+
+/* tempInRegister keeps a temporary in ac1 when only
+ * one instruction that loads ac comes between its
+ * push and its pop:
+ *      ST   ac,t(fp)          LDA  ac1,0(ac)
+ *      X    ac,...      =>    X    ac,...
+ *      LD   ac1,t(fp)
+ */
+static int tempInRegister( int loc )
+{ TmInstr * i = &codeBuf[loc], * j, * k;
+  int n1, n2;
+  if ((i->op != opST) || !i->temp || (i->r != ac)) return FALSE;
+  n1 = next(loc);
+  if (n1 >= codeSize) return FALSE;
+  n2 = next(n1);
+  if (n2 >= codeSize) return FALSE;
+  j = &codeBuf[n1];
+  k = &codeBuf[n2];
+  if ((k->op != opLD) || !k->temp || (k->r != ac1) ||
+      (k->d != i->d) || (k->s != i->s)) return FALSE;
+  if (!writesReg(j,ac) || readsReg(j,ac) || readsReg(j,ac1) ||
+      writesReg(j,ac1) || hasTarget(j)) return FALSE;
+  if ((refsTo(n1) != 0) || (refsTo(n2) != 0)) return FALSE;
+  i->op = opLDA;
+  i->r = ac1;
+  i->d = 0;
+  i->s = ac;
+  i->temp = FALSE;
+  removeInstr(n2);
+  return TRUE;
+}
+
+/* moveFold loads a value straight into ac1 when
+ * it is only copied there from ac:
+ *      LD   ac,x              LD   ac1,x
+ *      LDA  ac1,0(ac)   =>
+ * provided the value of ac is dead afterwards
+ */
+static int moveFold( int loc )
+{ TmInstr * i = &codeBuf[loc], * j;
+  int n;
+  if (((i->op != opLD) && (i->op != opLDA) && (i->op != opLDC)) ||
+      (i->r != ac) || i->temp || hasTarget(i)) return FALSE;
+  n = next(loc);
+  if ((n >= codeSize) || (refsTo(n) != 0)) return FALSE;
+  j = &codeBuf[n];
+  if ((j->op != opLDA) || (j->r != ac1) || (j->d != 0) ||
+      (j->s != ac) || hasTarget(j)) return FALSE;
+  if (!regDead(next(n),ac,REGBUDGET)) return FALSE;
+  i->r = ac1;
+  removeInstr(n);
+  return TRUE;
+}
+
+/* the rule table; a new rule is added by writing
+ * its function and listing it here
+ */
+static PeepRule peepRules[] =
+   { { "jump to next", jumpToNext, 0 },
+     { "jump chain", jumpChain, 0 },
+     { "unreachable code", unreachable, 0 },
+     { "store-load", storeLoad, 0 },
+     { "compare and branch", compareBranch, 0 },
+     { "temp in register", tempInRegister, 0 },
+     { "move folding", moveFold, 0 },
+     { NULL, NULL, 0 } };
+
+/* makeAbsolute turns pc-relative operands into
+ * absolute targets
+ */
+static void makeAbsolute( void )
+{ int loc;
+  TmInstr * i;
+  for (loc=0;loc<codeSize;loc++)
+  { i = &codeBuf[loc];
+    if ((i->op >= opLDA) && (i->op != opLDC) && (i->s == pc) &&
+        !hasTarget(i))
+    { i->target = loc + 1 + i->d;
+      i->d = 0;
+    }
+  }
+}
+
+/* countRefs counts the jumps to each location */
+static void countRefs( void )
+{ int loc;
+  refs = (int *) realloc(refs,(codeSize+1) * sizeof(int));
+  if (refs == NULL)
+  { outFlush();
+    fprintf(listing,"Out of memory error in peephole optimizer\n");
+    exit(1);
+  }
+  for (loc=0;loc<=codeSize;loc++) refs[loc] = 0;
+  for (loc=0;loc<codeSize;loc++)
+    if (hasTarget(&codeBuf[loc]) && (targetOf(&codeBuf[loc]) >= 0))
+      refs[targetOf(&codeBuf[loc])]++;
+}
+
+/* Procedure peephole optimizes the code buffer */
+void peephole( void )
+{ PeepRule * r;
+  int loc, changed, passes = 0, before;
+  makeAbsolute();
+  before = codeSize;
+  if (TracePeephole)
+  { outStr(listing,"\nCode before peephole optimization:\n");
+    writeCode(listing,ListingFormat);
+  }
+  do
+  { changed = FALSE;
+    countRefs();
+    for (loc=0;loc<codeSize;loc++)
+      for (r=peepRules;r->name != NULL;r++)
+        if ((codeBuf[loc].op != opNONE) && r->apply(loc))
+        { r->hits++;
+          changed = TRUE;
+        }
+    compactCode();
+  } while (changed && (++passes < MAXPASSES));
+  free(refs);
+  refs = NULL;
+  if (TracePeephole)
+  { outStr(listing,"\nCode after peephole optimization:\n");
+    writeCode(listing,ListingFormat);
+    outStr(listing,"\nPeephole rule hits:\n");
+    for (r=peepRules;r->name != NULL;r++)
+    { outStr(listing,"  ");
+      outPadStr(listing,r->name,20);
+      outIntRight(listing,r->hits,6);
+      outChar(listing,'\n');
+    }
+    outStr(listing,"  instructions ");
+    outInt(listing,before);
+    outStr(listing," -> ");
+    outInt(listing,codeSize);
+    outChar(listing,'\n');
+  }
+}
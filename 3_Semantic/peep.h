@@ -0,0 +1,19 @@
+/****************************************************/
+/* File: peep.h                                     */
+/* Peephole optimizer for the TM code generated by  */
+/* the C-MINUS compiler. It rewrites the code       */
+/* buffer of code.c in place, applying a table of   */
+/* rules until none of them matches any more        */
+/****************************************************/
+
+#ifndef _PEEP_H_
+#define _PEEP_H_
+
+/* Procedure peephole optimizes the code buffer.
+ * If TracePeephole is TRUE the code is listed
+ * before and after, together with the number of
+ * times each rule was applied
+ */
+void peephole( void );
+
+#endif
@@ -0,0 +1,285 @@
+/****************************************************/
+/* File: pscan.c                                    */
+/* Parallel scanner implementation for the          */
+/* C-MINUS compiler                                 */
+/****************************************************/
+
+#include <pthread.h>
+#include "globals.h"
+#include "token.h"
+#include "pscan.h"
+
+/* The only lexical state that can cross a line
+ * boundary is being inside a comment, so the source
+ * is cut into chunks that each start right after a
+ * newline. Every chunk but the first is lexed twice,
+ * once assuming it starts outside a comment and once
+ * inside one; the chunks are then stitched together
+ * in order, picking for each chunk the run whose
+ * start state matches the end state of the previous
+ * one. Every newline is counted exactly once in
+ * either state, so the line numbers of a chunk only
+ * depend on the newlines before it.
+ *
+ * The lexer below follows the rules of cminus.l:
+ * longest match, reserved words before identifiers,
+ * any other single character is an ERROR token, and
+ * a comment ends at the first star-slash, at a NUL
+ * character or at the end of the source.
+ */
+
+/* CHUNKSPERTHREAD chunks are made per worker thread
+ * to even out the load, but no chunk is smaller
+ * than MINCHUNK bytes
+ */
+#define CHUNKSPERTHREAD 4
+#define MINCHUNK 65536
+
+/* a token found in a chunk; line is the number of
+ * newlines in the chunk before the token
+ */
+typedef struct
+   { int kind;
+     int offset;
+     int length;
+     int line;
+   } ChunkToken;
+
+/* the result of lexing one chunk from one start state */
+typedef struct
+   { ChunkToken * toks;
+     int count;
+     int cap;
+     int endInComment; /* chunk ends inside a comment */
+   } ChunkRun;
+
+typedef struct
+   { long begin, end;  /* source bytes [begin,end) */
+     int newlines;     /* newlines in the chunk */
+     ChunkRun run[2];  /* run[s]: lexed with start state s */
+   } Chunk;
+
+typedef struct
+   { const char * text;
+     Chunk * chunks;
+     int nchunks;
+     int first;        /* first chunk of this worker */
+     int step;         /* distance between its chunks */
+   } Worker;
+
+static int outOfMemory = FALSE;
+
+static void addToken( ChunkRun * r, int kind, long offset, long length, int line )
+{ if (r->count == r->cap)
+  { ChunkToken * t;
+    r->cap = r->cap ? r->cap*2 : 1024;
+    t = (ChunkToken *) realloc(r->toks,r->cap*sizeof(ChunkToken));
+    if (t == NULL)
+    { outOfMemory = TRUE;
+      r->count = 0;
+      return;
+    }
+    r->toks = t;
+  }
+  r->toks[r->count].kind = kind;
+  r->toks[r->count].offset = offset;
+  r->toks[r->count].length = length;
+  r->toks[r->count].line = line;
+  r->count++;
+}
+
+#define ISLETTER(c) ((((c) >= 'a') && ((c) <= 'z')) || (((c) >= 'A') && ((c) <= 'Z')))
+#define ISDIGIT(c) (((c) >= '0') && ((c) <= '9'))
+
+/* reservedKind returns the token kind of the
+ * identifier of length n at s
+ */
+static int reservedKind( const char * s, long n )
+{ switch (n)
+  { case 2: if (memcmp(s,"if",2) == 0) return IF; break;
+    case 3: if (memcmp(s,"int",3) == 0) return INT; break;
+    case 4: if (memcmp(s,"else",4) == 0) return ELSE;
+            if (memcmp(s,"void",4) == 0) return VOID; break;
+    case 5: if (memcmp(s,"while",5) == 0) return WHILE; break;
+    case 6: if (memcmp(s,"return",6) == 0) return RETURN; break;
+  }
+  return ID;
+}
+
+/* skipComment skips the body of a comment starting
+ * at p, where prev is the character before p.
+ * Returns the position after the comment, or end
+ * if the comment does not end in [p,end)
+ */
+static long skipComment( const char * text, long p, long end, char prev, int * closed )
+{ char c;
+  while (p < end)
+  { c = text[p++];
+    if ((c == '\0') || ((prev == '*') && (c == '/')))
+    { *closed = TRUE;
+      return p;
+    }
+    prev = c;
+  }
+  *closed = FALSE;
+  return end;
+}
+
+/* lexChunk lexes chunk c from start state inComment */
+static void lexChunk( const char * text, Chunk * c, int inComment )
+{ ChunkRun * r = &c->run[inComment];
+  long p = c->begin, end = c->end, start;
+  int line = 0, closed, kind;
+  char ch;
+  if (inComment)
+  { start = p;
+    p = skipComment(text,p,end,'\n',&closed);
+    while (start < p) if (text[start++] == '\n') line++;
+    if (!closed)
+    { r->endInComment = TRUE;
+      return;
+    }
+  }
+  while (p < end)
+  { start = p;
+    ch = text[p++];
+    if (ch == '\n') { line++; continue; }
+    if ((ch == ' ') || (ch == '\t')) continue;
+    if (ISLETTER(ch))
+    { while ((p < end) && (ISLETTER(text[p]) || ISDIGIT(text[p]))) p++;
+      kind = reservedKind(text+start,p-start);
+    }
+    else if (ISDIGIT(ch))
+    { while ((p < end) && ISDIGIT(text[p])) p++;
+      kind = NUM;
+    }
+    else
+    { char next = (p < end) ? text[p] : '\0';
+      switch (ch)
+      { case '=': if (next == '=') { p++; kind = EQ; } else kind = ASSIGN; break;
+        case '!': if (next == '=') { p++; kind = NE; } else kind = ERROR; break;
+        case '<': if (next == '=') { p++; kind = LE; } else kind = LT; break;
+        case '>': if (next == '=') { p++; kind = GE; } else kind = GT; break;
+        case '/':
+          if (next == '*')
+          { p = skipComment(text,p+1,end,'\0',&closed);
+            while (start < p) if (text[start++] == '\n') line++;
+            if (!closed)
+            { r->endInComment = TRUE;
+              return;
+            }
+            continue;
+          }
+          kind = OVER;
+          break;
+        case '+': kind = PLUS; break;
+        case '-': kind = MINUS; break;
+        case '*': kind = TIMES; break;
+        case '(': kind = LPAREN; break;
+        case ')': kind = RPAREN; break;
+        case '[': kind = LBRACE; break;
+        case ']': kind = RBRACE; break;
+        case '{': kind = LCURLY; break;
+        case '}': kind = RCURLY; break;
+        case ';': kind = SEMI; break;
+        case ',': kind = COMMA; break;
+        default: kind = ERROR; break;
+      }
+    }
+    addToken(r,kind,start,p-start,line);
+  }
+  r->endInComment = FALSE;
+}
+
+/* lexChunks is the body of a worker thread */
+static void * lexChunks( void * arg )
+{ Worker * w = (Worker *) arg;
+  int i;
+  long p;
+  for (i=w->first;i<w->nchunks;i+=w->step)
+  { Chunk * c = &w->chunks[i];
+    for (p=c->begin;p<c->end;p++)
+      if (w->text[p] == '\n') c->newlines++;
+    lexChunk(w->text,c,FALSE);
+    if (i > 0) lexChunk(w->text,c,TRUE);
+  }
+  return NULL;
+}
+
+/* Procedure parallelTokens fills the token buffer
+ * with the tokens of the source text, lexed on
+ * nthreads worker threads
+ */
+void parallelTokens( const char * text, long len, int nthreads )
+{ Chunk * chunks;
+  Worker * workers;
+  pthread_t * threads;
+  int * started;
+  int nchunks, i, j, state, baseline;
+  long size, p;
+  if (nthreads < 1) nthreads = 1;
+  nchunks = nthreads * CHUNKSPERTHREAD;
+  if (len / nchunks < MINCHUNK) nchunks = len / MINCHUNK + 1;
+  if (nchunks < nthreads) nthreads = nchunks;
+  chunks = (Chunk *) calloc(nchunks,sizeof(Chunk));
+  workers = (Worker *) calloc(nthreads,sizeof(Worker));
+  threads = (pthread_t *) calloc(nthreads,sizeof(pthread_t));
+  started = (int *) calloc(nthreads,sizeof(int));
+  if ((chunks == NULL) || (workers == NULL) || (threads == NULL) ||
+      (started == NULL))
+  { fprintf(listing,"Out of memory error in parallel scanner\n");
+    exit(1);
+  }
+  /* cut the source right after a newline near each
+   * multiple of the chunk size
+   */
+  size = len / nchunks;
+  for (i=0,p=0;i<nchunks;i++)
+  { chunks[i].begin = p;
+    if (i == nchunks-1) p = len;
+    else
+    { p = p + size > len ? len : p + size;
+      while ((p < len) && (text[p-1] != '\n')) p++;
+    }
+    chunks[i].end = p;
+  }
+  for (i=0;i<nthreads;i++)
+  { workers[i].text = text;
+    workers[i].chunks = chunks;
+    workers[i].nchunks = nchunks;
+    workers[i].first = i;
+    workers[i].step = nthreads;
+  }
+  for (i=1;i<nthreads;i++)
+  { started[i] = (pthread_create(&threads[i],NULL,lexChunks,&workers[i]) == 0);
+    /* without a thread its share is done on this one */
+    if (!started[i]) lexChunks(&workers[i]);
+  }
+  lexChunks(&workers[0]);
+  for (i=1;i<nthreads;i++)
+    if (started[i]) pthread_join(threads[i],NULL);
+  if (outOfMemory)
+  { fprintf(listing,"Out of memory error in parallel scanner\n");
+    exit(1);
+  }
+  /* stitch the runs together */
+  state = FALSE;
+  baseline = 1;
+  for (i=0;i<nchunks;i++)
+  { ChunkRun * r = &chunks[i].run[state];
+    for (j=0;j<r->count;j++)
+    { ChunkToken * t = &r->toks[j];
+      appendToken(t->kind,t->offset,t->length,baseline+t->line,
+                  text+t->offset);
+    }
+    state = r->endInComment;
+    baseline += chunks[i].newlines;
+    free(chunks[i].run[0].toks);
+    free(chunks[i].run[1].toks);
+  }
+  appendToken(ENDFILE,len,0,baseline,"");
+  free(chunks);
+  free(workers);
+  free(threads);
+  free(started);
+}
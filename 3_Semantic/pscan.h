@@ -0,0 +1,20 @@
+/****************************************************/
+/* File: pscan.h                                    */
+/* Parallel scanner interface for the C-MINUS       */
+/* compiler. The source is split into chunks at     */
+/* line boundaries and the chunks are lexed on      */
+/* worker threads                                   */
+/****************************************************/
+
+#ifndef _PSCAN_H_
+#define _PSCAN_H_
+
+/* Procedure parallelTokens fills the token buffer
+ * with the tokens of the len bytes of source text at
+ * text, lexed on nthreads worker threads. The tokens,
+ * spans and line numbers are exactly those getToken
+ * would produce for the same text, ENDFILE included
+ */
+void parallelTokens( const char * text, long len, int nthreads );
+
+#endif
@@ -8,14 +8,18 @@
 #include "globals.h"
 #include "util.h"
 #include "scan.h"
+#include "token.h"
+#include "outbuf.h"
 
 /* states in scanner DFA */
 typedef enum
    { START,INASSIGN,INNE,INLT,INGT,INOVER,INCOMMENT,INCOMMENT_,INNUM,INID,DONE }
    StateType;
 
-/* lexeme of identifier or reserved word */
-char tokenString[MAXTOKENLEN+1];
+/* lexeme of the current token; grown as needed
+   so that long identifiers are never truncated */
+static char * tokenString = NULL;
+static int tokenStringSize = 0;
 
 /* BUFLEN = length of the input buffer for
    source code lines */
@@ -24,6 +28,7 @@ char tokenString[MAXTOKENLEN+1];
 static char lineBuf[BUFLEN]; /* holds the current line */
 static int linepos = 0; /* current position in LineBuf */
 static int bufsize = 0; /* current size of buffer string */
+static int lineStart = 0; /* source offset of lineBuf[0] */
 static int EOF_flag = FALSE; /* corrects ungetNextChar behavior on EOF */
 
 /* getNextChar fetches the next non-blank character
@@ -31,19 +36,26 @@ static int EOF_flag = FALSE; /* corrects ungetNextChar behavior on EOF */
    exhausted */
 static int getNextChar(void)
 { if (!(linepos < bufsize))
-  { lineno++;
+  { if (EOF_flag) return EOF;
+    /* a line longer than lineBuf arrives in pieces */
+    if ((bufsize == 0) || (lineBuf[bufsize-1] == '\n')) lineno++;
+    lineStart += bufsize;
+    linepos = bufsize = 0;
     if (fgets(lineBuf,BUFLEN-1,source))
-    { if (EchoSource) fprintf(listing,"%4d: %s",lineno,lineBuf);
+    { if (EchoSource)
+      { outIntRight(listing,lineno,4);
+        outStr(listing,": ");
+        outStr(listing,lineBuf);
+      }
       bufsize = strlen(lineBuf);
-      linepos = 0;
-      return lineBuf[linepos++];
+      return (unsigned char) lineBuf[linepos++];
     }
     else
     { EOF_flag = TRUE;
       return EOF;
     }
   }
-  else return lineBuf[linepos++];
+  else return (unsigned char) lineBuf[linepos++];
 }
 
 /* ungetNextChar backtracks one character
@@ -63,7 +75,7 @@ static struct
 /* uses linear search */
 static TokenType reservedLookup (char * s)
 { int i;
-  for (i=0;i<MAXRESERVED;i++)
+  for (i=0;(i<MAXRESERVED) && (reservedWords[i].str!=NULL);i++)
     if (!strcmp(s,reservedWords[i].str))
       return reservedWords[i].tok;
   return ID;
@@ -78,6 +90,8 @@ static TokenType reservedLookup (char * s)
 TokenType getToken(void)
 {  /* index for storing into tokenString */
    int tokenStringIndex = 0;
+   /* source offset of the first character of the token */
+   int tokenStart = 0;
    /* holds current token to be returned */
    TokenType currentToken;
    /* current state - always begins at START */
@@ -179,7 +193,7 @@ TokenType getToken(void)
          else{
            ungetNextChar();
            save = FALSE;
-           state = ERROR;
+           currentToken = ERROR;
          }
          break;
        case INOVER:
@@ -243,23 +257,55 @@ TokenType getToken(void)
          break;
        case DONE:
        default: /* should never happen */
+         outFlush();
          fprintf(listing,"Scanner Bug: state= %d\n",state);
          state = DONE;
          currentToken = ERROR;
          break;
      }
-     if ((save) && (tokenStringIndex <= MAXTOKENLEN))
+     if (tokenStringIndex+1 >= tokenStringSize)
+     { tokenStringSize = tokenStringSize ? tokenStringSize*2 : 64;
+       tokenString = (char *) realloc(tokenString,tokenStringSize);
+       if (tokenString == NULL)
+       { outFlush();
+         fprintf(listing,"Out of memory error at line %d\n",lineno);
+         exit(1);
+       }
+     }
+     if (save)
+     { if (tokenStringIndex == 0) tokenStart = lineStart + linepos - 1;
        tokenString[tokenStringIndex++] = (char) c;
+     }
+     else if (c == EOF)
+       tokenStart = lineStart;
      if (state == DONE)
-     { tokenString[tokenStringIndex] = '\0';
+     { /* an unterminated comment leaves its opening
+          characters behind */
+       if (currentToken == ENDFILE) tokenStringIndex = 0;
+       tokenString[tokenStringIndex] = '\0';
        if (currentToken == ID)
          currentToken = reservedLookup(tokenString);
      }
    }
+   appendToken(currentToken,tokenStart,tokenStringIndex,lineno,tokenString);
    if (TraceScan) {
-     fprintf(listing,"\t%d: ",lineno);
+     outChar(listing,'\t');
+     outInt(listing,lineno);
+     outStr(listing,": ");
      printToken(currentToken,tokenString);
    }
    return currentToken;
 } /* end getToken */
 
+/* Procedure resetScanner rewinds the source file
+ * and puts the scanner back in its initial state
+ */
+void resetScanner(void)
+{ rewind(source);
+  linepos = 0;
+  bufsize = 0;
+  lineStart = 0;
+  EOF_flag = FALSE;
+  lineno = 0;
+}
+
@@ -8,21 +8,16 @@
 #ifndef _SCAN_H_
 #define _SCAN_H_
 
-/* MAXTOKENLEN is the maximum size of a token */
-#define MAXRECURSION 2000
-#define MAXTOKENLEN 40
-
-/* tokenString array stores the lexeme of each token */
-extern char tokenString[2][MAXTOKENLEN+1];
-extern char* savedNameStack[MAXRECURSION];
-extern int savedLineNoStack[MAXRECURSION];
-extern int curTokenPos;
-extern int curStackTop;
-extern int curLineTop;
-
 /* function getToken returns the 
- * next token in source file
+ * next token in source file and appends
+ * it to the token buffer (see token.h)
  */
 TokenType getToken(void);
 
+/* Procedure resetScanner rewinds the source file
+ * and puts the scanner back in its initial state,
+ * so that the source can be scanned again
+ */
+void resetScanner(void);
+
 #endif
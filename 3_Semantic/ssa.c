@@ -0,0 +1,298 @@
+/****************************************************/
+/* File: ssa.c                                      */
+/* Dominators and static single assignment form     */
+/* of the IR for the C-MINUS compiler               */
+/****************************************************/
+
+#include "globals.h"
+#include "ir.h"
+#include "ssa.h"
+
+/* Dominators are computed with the iterative
+ * algorithm of Cooper, Harvey and Kennedy, and phis
+ * are placed on the iterated dominance frontiers of
+ * the definitions of each register that is read in
+ * some block before being written in it.
+ */
+
+static int intersect( int * idom, int b1, int b2 )
+{ while (b1 != b2)
+  { while (b1 > b2) b1 = idom[b1];
+    while (b2 > b1) b2 = idom[b2];
+  }
+  return b1;
+}
+
+/* Function irDominators returns the immediate
+ * dominator of each block of f
+ */
+int * irDominators( IrFunc f )
+{ int * idom = (int *) irMalloc(f->nblocks * sizeof(int));
+  int changed = TRUE, b, j, d;
+  IrBlock blk;
+  for (b=0;b<f->nblocks;b++) idom[b] = -1;
+  idom[0] = 0;
+  while (changed)
+  { changed = FALSE;
+    for (b=1;b<f->nblocks;b++)
+    { blk = f->blocks[b];
+      d = -1;
+      for (j=0;j<blk->npred;j++)
+        if (idom[blk->pred[j]->id] >= 0)
+          d = (d < 0) ? blk->pred[j]->id : intersect(idom,blk->pred[j]->id,d);
+      if (idom[b] != d)
+      { idom[b] = d;
+        changed = TRUE;
+      }
+    }
+  }
+  return idom;
+}
+
+/* a growable list of ints */
+typedef struct
+   { int * v;
+     int n, cap;
+   } IntList;
+
+static void push( IntList * l, int x )
+{ irGrow((void **) &l->v,&l->cap,l->n+1,sizeof(int));
+  l->v[l->n++] = x;
+}
+
+/* state of the renaming walk */
+static IrFunc func;
+static int nvars;           /* registers before renaming */
+static IntList * stacks;    /* current names of each register */
+static IntList renamed;     /* registers pushed, to pop them */
+static IntList * children;  /* dominator tree */
+
+static int top( int v )
+{ if ((v < 0) || (v >= nvars) || (stacks[v].n == 0)) return v;
+  return stacks[v].v[stacks[v].n-1];
+}
+
+/* define gives register v a new name */
+static int define( int v )
+{ int r = irNewReg(func);
+  push(&stacks[v],r);
+  push(&renamed,v);
+  return r;
+}
+
+/* renameBlock renames the registers in block b
+ * and the blocks it dominates
+ */
+static void renameBlock( IrBlock b )
+{ int saved = renamed.n, i, j, k;
+  IrInstr * in;
+  IrBlock s;
+  for (i=0;i<b->ncode;i++)
+  { in = &b->code[i];
+    if (in->op != irPhi)
+    { in->a = top(in->a);
+      in->b = top(in->b);
+      for (j=0;j<in->nargs;j++) in->args[j] = top(in->args[j]);
+    }
+    if (in->dst >= 0) in->dst = define(in->dst);
+  }
+  b->a = top(b->a);
+  b->b = top(b->b);
+  for (k=0;k<b->nsucc;k++)
+  { s = b->succ[k];
+    if ((k == 1) && (s == b->succ[0])) break;
+    for (i=0;(i<s->ncode) && (s->code[i].op == irPhi);i++)
+      for (j=0;j<s->code[i].nargs;j++)
+        if (s->code[i].from[j] == b)
+          s->code[i].args[j] = top(s->code[i].k);
+  }
+  for (i=0;i<children[b->id].n;i++)
+    renameBlock(func->blocks[children[b->id].v[i]]);
+  while (renamed.n > saved) stacks[renamed.v[--renamed.n]].n--;
+}
+
+/* use records a read of register v in the block
+ * with stamp, unless it was written there before
+ */
+static void use( int v, int * killed, int stamp, int * global )
+{ if ((v >= 0) && (killed[v] != stamp)) global[v] = TRUE; }
+
+/* Function irBuildSSA puts f into SSA form and
+ * returns the number of phis inserted
+ */
+int irBuildSSA( IrFunc f )
+{ int n = f->nblocks, * idom, * killed, * global, * hasPhi, * inWork;
+  IntList * df, * defs, work;
+  int b, i, j, v, r, phis = 0;
+  IrBlock blk, y;
+  IrInstr * in;
+  func = f;
+  nvars = f->nregs;
+  idom = irDominators(f);
+  /* dominance frontiers */
+  df = (IntList *) irMalloc(n * sizeof(IntList));
+  for (b=0;b<n;b++)
+  { blk = f->blocks[b];
+    if (blk->npred < 2) continue;
+    for (j=0;j<blk->npred;j++)
+      for (r=blk->pred[j]->id;r != idom[b];r=idom[r])
+        if ((df[r].n == 0) || (df[r].v[df[r].n-1] != b)) push(&df[r],b);
+  }
+  /* registers read before written in some block */
+  killed = (int *) irMalloc(nvars * sizeof(int));
+  global = (int *) irMalloc(nvars * sizeof(int));
+  defs = (IntList *) irMalloc(nvars * sizeof(IntList));
+  for (i=0;i<f->nparams;i++) killed[f->params[i]] = 1;
+  for (b=0;b<n;b++)
+  { blk = f->blocks[b];
+    for (i=0;i<blk->ncode;i++)
+    { in = &blk->code[i];
+      use(in->a,killed,b+1,global);
+      use(in->b,killed,b+1,global);
+      for (j=0;j<in->nargs;j++) use(in->args[j],killed,b+1,global);
+      if (in->dst >= 0)
+      { killed[in->dst] = b+1;
+        if ((defs[in->dst].n == 0) || (defs[in->dst].v[defs[in->dst].n-1] != b))
+          push(&defs[in->dst],b);
+      }
+    }
+    use(blk->a,killed,b+1,global);
+    use(blk->b,killed,b+1,global);
+  }
+  /* parameters are defined at the entry, other
+     registers read before written are set to 0 */
+  for (i=0;i<f->nparams;i++) push(&defs[f->params[i]],0);
+  for (v=0;v<nvars;v++)
+    if (global[v])
+    { for (i=0;(i<f->nparams) && (f->params[i] != v);i++);
+      if (i < f->nparams) continue;
+      irInsert(f->blocks[0],0,irConst,v,-1,-1,0);
+      if ((defs[v].n == 0) || (defs[v].v[0] != 0)) push(&defs[v],0);
+    }
+  /* phis on the iterated dominance frontiers */
+  hasPhi = (int *) irMalloc(n * sizeof(int));
+  inWork = (int *) irMalloc(n * sizeof(int));
+  work.v = NULL;
+  work.n = work.cap = 0;
+  for (v=0;v<nvars;v++)
+  { if (!global[v]) continue;
+    for (i=0;i<defs[v].n;i++)
+    { push(&work,defs[v].v[i]);
+      inWork[defs[v].v[i]] = v+1;
+    }
+    while (work.n > 0)
+    { b = work.v[--work.n];
+      for (i=0;i<df[b].n;i++)
+      { y = f->blocks[df[b].v[i]];
+        if (hasPhi[y->id] == v+1) continue;
+        hasPhi[y->id] = v+1;
+        in = irInsert(y,0,irPhi,v,-1,-1,v);
+        in->nargs = y->npred;
+        in->args = (int *) irMalloc(y->npred * sizeof(int));
+        in->from = (IrBlock *) irMalloc(y->npred * sizeof(IrBlock));
+        for (j=0;j<y->npred;j++)
+        { in->args[j] = v;
+          in->from[j] = y->pred[j];
+        }
+        phis++;
+        if (inWork[y->id] != v+1)
+        { inWork[y->id] = v+1;
+          push(&work,y->id);
+        }
+      }
+    }
+  }
+  /* renaming along the dominator tree */
+  children = (IntList *) irMalloc(n * sizeof(IntList));
+  for (b=1;b<n;b++) push(&children[idom[b]],b);
+  stacks = (IntList *) irMalloc(nvars * sizeof(IntList));
+  renamed.v = NULL;
+  renamed.n = renamed.cap = 0;
+  for (i=0;i<f->nparams;i++) push(&stacks[f->params[i]],f->params[i]);
+  renameBlock(f->blocks[0]);
+  for (b=0;b<n;b++)
+  { free(df[b].v);
+    free(children[b].v);
+  }
+  for (v=0;v<nvars;v++)
+  { free(defs[v].v);
+    free(stacks[v].v);
+  }
+  free(df);
+  free(children);
+  free(defs);
+  free(stacks);
+  free(renamed.v);
+  free(work.v);
+  free(idom);
+  free(killed);
+  free(global);
+  free(hasPhi);
+  free(inWork);
+  return phis;
+}
+
+/* splitEdge puts a new block on the edge from p to
+ * b and returns it
+ */
+static IrBlock splitEdge( IrFunc f, IrBlock p, IrBlock b )
+{ IrBlock n = irNewBlock(f);
+  int k;
+  n->term = irJump;
+  n->nsucc = 1;
+  n->succ[0] = b;
+  for (k=0;k<p->nsucc;k++)
+    if (p->succ[k] == b) p->succ[k] = n;
+  return n;
+}
+
+/* Function irLeaveSSA replaces the phis of f by
+ * copies and returns the number of copies
+ */
+int irLeaveSSA( IrFunc f )
+{ int nb = f->nblocks, copies = 0, b, i, j, k, nphi, conflict, t;
+  IrBlock blk, p, at;
+  IrInstr * phi;
+  for (b=0;b<nb;b++)
+  { blk = f->blocks[b];
+    for (nphi=0;(nphi<blk->ncode) && (blk->code[nphi].op == irPhi);nphi++);
+    if (nphi == 0) continue;
+    for (j=0;j<blk->code[0].nargs;j++)
+    { p = blk->code[0].from[j];
+      at = (p->nsucc > 1) ? splitEdge(f,p,blk) : p;
+      /* the copies are done in parallel: when one
+         reads the target of another, they go
+         through new registers */
+      conflict = FALSE;
+      for (i=0;i<nphi;i++)
+        for (k=0;k<nphi;k++)
+          if ((i != k) && (blk->code[i].args[j] == blk->code[k].dst))
+            conflict = TRUE;
+      for (i=0;i<nphi;i++)
+      { phi = &blk->code[i];
+        if (phi->args[j] == phi->dst) continue;
+        if (conflict)
+        { t = irNewReg(f);
+          irEmit(at,irCopy,t,phi->args[j],-1,0);
+          phi->args[j] = t;
+          copies++;
+        }
+        else
+        { irEmit(at,irCopy,phi->dst,phi->args[j],-1,0);
+          copies++;
+        }
+      }
+      if (conflict)
+        for (i=0;i<nphi;i++)
+        { phi = &blk->code[i];
+          if (phi->args[j] == phi->dst) continue;
+          irEmit(at,irCopy,phi->dst,phi->args[j],-1,0);
+          copies++;
+        }
+    }
+    for (i=0;i<nphi;i++) blk->code[i].op = irNop;
+    irRemoveNops(blk);
+  }
+  irBuildCFG(f);
+  return copies;
+}
@@ -0,0 +1,33 @@
+/****************************************************/
+/* File: ssa.h                                      */
+/* Dominators and static single assignment form     */
+/* of the IR for the C-MINUS compiler               */
+/****************************************************/
+
+#ifndef _SSA_H_
+#define _SSA_H_
+
+#include "ir.h"
+
+/* Function irDominators returns the immediate
+ * dominator of each block of f, indexed by block
+ * id; the entry is its own. The blocks must be in
+ * reverse postorder, as left by irBuildCFG
+ */
+int * irDominators( IrFunc f );
+
+/* Function irBuildSSA puts f into SSA form and
+ * returns the number of phis inserted. Every
+ * definition gets a new register; a register read
+ * before it is written on some path is set to 0
+ * at the entry
+ */
+int irBuildSSA( IrFunc f );
+
+/* Function irLeaveSSA replaces the phis of f by
+ * copies at the end of the predecessors, splitting
+ * critical edges, and returns the number of copies
+ */
+int irLeaveSSA( IrFunc f );
+
+#endif
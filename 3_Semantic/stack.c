@@ -0,0 +1,196 @@
+/****************************************************/
+/* File: stack.c                                    */
+/* Call graph and stack depth analysis of the       */
+/* generated code for the C-MINUS compiler          */
+/****************************************************/
+
+#include "globals.h"
+#include "outbuf.h"
+#include "stack.h"
+
+/* words of TM data memory, DADDR_SIZE in tm.c */
+#define DMEM_SIZE 1024
+
+/* The code generators record each function with its
+ * frame and the calls it makes. The frame of a call
+ * starts where the caller's temps were when it was
+ * made, so the stack used from a function is the
+ * largest of its own frame and, for each call, the
+ * distance to the callee's frame plus the stack used
+ * from the callee. A function that can reach itself
+ * through calls may use any amount.
+ */
+
+typedef struct CallRec
+   { char * callee;
+     int base;
+     struct CallRec * next;
+   } * Call;
+
+typedef struct FuncRec
+   { char * name;
+     int frame;
+     Call calls;
+     int state;     /* 0 not visited, 1 being visited, 2 done */
+     int recursive;
+     int depth;     /* stack used from it, -1 if unbounded */
+     struct FuncRec * next;
+   } * Func;
+
+static Func funcs = NULL;
+static Func * lastFunc = &funcs;
+static Func curFunc = NULL;  /* the last one recorded */
+static int nfuncs = 0;
+static int globalWords = 0;
+
+/* the functions being visited, for the cycles */
+static Func * path;
+static int npath;
+
+static void * stackMalloc( int n )
+{ void * p = calloc(1,n);
+  if (p == NULL)
+  { outFlush();
+    fprintf(listing,"Out of memory error in stack analysis\n");
+    exit(1);
+  }
+  return p;
+}
+
+/* Procedure stackFunction records that the code of
+ * function name is being generated
+ */
+void stackFunction( char * name )
+{ Func f = (Func) stackMalloc(sizeof(struct FuncRec));
+  f->name = name;
+  *lastFunc = f;
+  lastFunc = &f->next;
+  curFunc = f;
+  nfuncs++;
+}
+
+/* Procedure stackFrame records the frame size of
+ * the last function recorded
+ */
+void stackFrame( int frame )
+{ curFunc->frame = frame; }
+
+/* Procedure stackCall records a call from the last
+ * function recorded to callee
+ */
+void stackCall( char * callee, int base )
+{ Call c = (Call) stackMalloc(sizeof(struct CallRec));
+  c->callee = callee;
+  c->base = base;
+  c->next = curFunc->calls;
+  curFunc->calls = c;
+}
+
+/* Procedure stackGlobals records the memory words
+ * taken by the globals
+ */
+void stackGlobals( int words )
+{ globalWords = words; }
+
+static Func findFunc( char * name )
+{ Func f;
+  for (f=funcs;f != NULL;f=f->next)
+    if (strcmp(f->name,name) == 0) return f;
+  return NULL;
+}
+
+/* visit computes the stack used from f, printing
+ * the cycles of calls it finds
+ */
+static void visit( Func f )
+{ Func g;
+  Call c;
+  int i, d;
+  f->state = 1;
+  path[npath++] = f;
+  f->depth = f->frame;
+  for (c=f->calls;c != NULL;c=c->next)
+  { g = findFunc(c->callee);
+    if (g == NULL) continue;
+    if (g->state == 1)
+    { /* g is on the path: everything from it on
+         is part of a cycle */
+      f->depth = -1;
+      /* another call closing the same cycle */
+      if (f->recursive && g->recursive) continue;
+      outStr(listing,"  recursion:");
+      for (i=npath-1;path[i] != g;i--);
+      for (;i<npath;i++)
+      { path[i]->recursive = TRUE;
+        outStr(listing," ");
+        outStr(listing,path[i]->name);
+        outStr(listing," ->");
+      }
+      outStr(listing," ");
+      outStr(listing,g->name);
+      outChar(listing,'\n');
+      continue;
+    }
+    if (g->state == 0) visit(g);
+    if ((g->depth < 0) || (f->depth < 0)) f->depth = -1;
+    else
+    { d = -c->base + g->depth;
+      if (d > f->depth) f->depth = d;
+    }
+  }
+  if (f->recursive) f->depth = -1;
+  npath--;
+  f->state = 2;
+}
+
+/* Procedure stackReport prints the frame of each
+ * function, the call graph, the recursive functions
+ * and the most stack the program can use
+ */
+void stackReport( void )
+{ Func f, entry;
+  Call c;
+  int total;
+  path = (Func *) stackMalloc((nfuncs+1) * sizeof(Func));
+  npath = 0;
+  outStr(listing,"\nStack analysis:\n");
+  for (f=funcs;f != NULL;f=f->next)
+    if (f->state == 0) visit(f);
+  outStr(listing,"  function       frame    stack  calls\n");
+  for (f=funcs;f != NULL;f=f->next)
+  { outStr(listing,"  ");
+    outPadStr(listing,f->name,13);
+    outIntRight(listing,f->frame,6);
+    if (f->depth < 0) outStrRight(listing,"any",9);
+    else outIntRight(listing,f->depth,9);
+    outStr(listing," ");
+    for (c=f->calls;c != NULL;c=c->next)
+    { outStr(listing," ");
+      outStr(listing,c->callee);
+      outChar(listing,'@');
+      outInt(listing,c->base);
+    }
+    outChar(listing,'\n');
+  }
+  entry = findFunc("main");
+  if ((entry == NULL) || (entry->depth < 0))
+  { outStr(listing,"  the stack from main is unbounded: it reaches recursion\n");
+    free(path);
+    return;
+  }
+  total = entry->depth + globalWords;
+  outStr(listing,"  the stack from main takes at most ");
+  outInt(listing,entry->depth);
+  outStr(listing," words; with ");
+  outInt(listing,globalWords);
+  outStr(listing," of globals, the program needs ");
+  outInt(listing,total);
+  outStr(listing," words of data memory");
+  if (total > DMEM_SIZE)
+  { outStr(listing,", more than the ");
+    outInt(listing,DMEM_SIZE);
+    outStr(listing," of TM");
+  }
+  outChar(listing,'\n');
+  free(path);
+}
@@ -0,0 +1,39 @@
+/****************************************************/
+/* File: stack.h                                    */
+/* Call graph and stack depth analysis of the       */
+/* generated code for the C-MINUS compiler          */
+/****************************************************/
+
+#ifndef _STACK_H_
+#define _STACK_H_
+
+/* Procedure stackFunction records that the code of
+ * function name is being generated
+ */
+void stackFunction( char * name );
+
+/* Procedure stackFrame records that the frame of the
+ * last function recorded takes frame words, from
+ * 0(fp) down, not counting the frames of its calls
+ */
+void stackFrame( int frame );
+
+/* Procedure stackCall records a call from the last
+ * function recorded to callee, whose frame starts
+ * at offset base from the caller's fp
+ */
+void stackCall( char * callee, int base );
+
+/* Procedure stackGlobals records the number of
+ * memory words taken by the globals
+ */
+void stackGlobals( int words );
+
+/* Procedure stackReport prints the frame of each
+ * function, the call graph, the recursive functions
+ * and the most stack the program can use, to the
+ * listing file
+ */
+void stackReport( void );
+
+#endif
@@ -13,6 +13,9 @@
 #include <string.h>
 #include "symtab.h"
 #include "util.h"
+#include "outbuf.h"
+
+ScopeList tree;
 
 /* the hash function */
 int hash(char * key)
@@ -122,42 +125,46 @@ void printSymtab(FILE* listing, ScopeList scope){
     { BucketList l = scope->hashTable[i];
       while (l != NULL)
       { LineList t = l->lines;
-        fprintf(listing,"%-13s  ",l->name);
+        outPadStr(listing,l->name,13);
+        outStr(listing,"  ");
         switch(l->type.sym){
           case Function:
-            fprintf(listing,"Function     ");
+            outStr(listing,"Function     ");
             break;
           default:
-            fprintf(listing,"Variable     ");
+            outStr(listing,"Variable     ");
             break;
         }
         switch(l->type.ret){
           case Void:
-            fprintf(listing,"void           ");
+            outStr(listing,"void           ");
             break;
           case Integer:
-            fprintf(listing,"int            ");
+            outStr(listing,"int            ");
             break;
           case VoidPtr:
-            fprintf(listing,"void[]         ");
+            outStr(listing,"void[]         ");
             break;
           case IntegerPtr:
-            fprintf(listing,"int[]          ");
+            outStr(listing,"int[]          ");
             break;
         }
-        fprintf(listing,"%-12s  ",l->scope);
-        fprintf(listing,"%-8d  ",l->memloc);
+        outPadStr(listing,l->scope,12);
+        outStr(listing,"  ");
+        outPadInt(listing,l->memloc,8);
+        outStr(listing,"  ");
         while (t != NULL)
-        { fprintf(listing,"%4d ",t->lineno);
+        { outIntRight(listing,t->lineno,4);
+          outChar(listing,' ');
           t = t->next;
         }
-        fprintf(listing,"\n");
+        outStr(listing,"\n");
         l = l->next;
       }
     }
   }
   if(scope == tree)
-    fprintf(listing, "value          Variable     int            output        0            0\n");
+    outStr(listing,"value          Variable     int            output        0            0\n");
   for(int i=0;i<scope->childcnt;++i){
     printSymtab(listing, scope->child[i]);
   }
@@ -171,7 +178,8 @@ void printFunctab(FILE* listing, ScopeList scope){
       { 
         switch(l->type.sym){
           case Function:
-            fprintf(listing,"%-13s  ", l->name);
+            outPadStr(listing,l->name,13);
+            outStr(listing,"  ");
             break;
           default:
             l = l->next;
@@ -179,27 +187,27 @@ void printFunctab(FILE* listing, ScopeList scope){
         }
         switch(l->type.ret){
           case Void:
-            fprintf(listing,"void           ");
+            outStr(listing,"void           ");
             break;
           case Integer:
-            fprintf(listing,"int            ");
+            outStr(listing,"int            ");
             break;
           case VoidPtr:
-            fprintf(listing,"void[]         ");
+            outStr(listing,"void[]         ");
             break;
           case IntegerPtr:
-            fprintf(listing,"int[]          ");
+            outStr(listing,"int[]          ");
             break;
         }
         if(l->type.argcnt == 0)
-          fprintf(listing, "                void");
-        fprintf(listing, "\n");
+          outStr(listing,"                void");
+        outStr(listing,"\n");
         if(strcmp(l->name, "input") == 0){
           l = l->next;
           continue;
         }
         else if(strcmp(l->name, "output") == 0){
-          fprintf(listing, "-              -              value           int\n");
+          outStr(listing,"-              -              value           int\n");
           l = l->next;
           continue;
         }
@@ -212,7 +220,10 @@ void printFunctab(FILE* listing, ScopeList scope){
           }
         }
         if(funcscope == NULL) // should not happen
-          fprintf(listing, "Failed to find scope %s\n", l->name);
+        { outStr(listing,"Failed to find scope ");
+          outStr(listing,l->name);
+          outChar(listing,'\n');
+        }
         if(strcmp(l->name, "output") != 0){
           for(int j=0;j<SIZE;++j){
             if (funcscope->hashTable[j] != NULL){
@@ -222,20 +233,21 @@ void printFunctab(FILE* listing, ScopeList scope){
                   nl = nl->next;
                   continue;
                 }
-                fprintf(listing, "-              -              ");
-                fprintf(listing, "%-14s  ", nl->name);
+                outStr(listing,"-              -              ");
+                outPadStr(listing,nl->name,14);
+                outStr(listing,"  ");
                 switch(nl->type.ret){
                   case Void:
-                    fprintf(listing,"void          \n");
+                    outStr(listing,"void          \n");
                     break;
                   case Integer:
-                    fprintf(listing,"int           \n");
+                    outStr(listing,"int           \n");
                     break;
                   case VoidPtr:
-                     fprintf(listing,"void[]        \n");
+                     outStr(listing,"void[]        \n");
                      break;
                   case IntegerPtr:
-                    fprintf(listing,"int[]         \n");
+                    outStr(listing,"int[]         \n");
                     break;
                 }
                 nl = nl->next;
@@ -255,27 +267,28 @@ void printGlobtab(FILE* listing, ScopeList scope){
     { BucketList l = scope->hashTable[i];
       while (l != NULL)
       { 
-        fprintf(listing, "%-13s  ", l->name);
+        outPadStr(listing,l->name,13);
+        outStr(listing,"  ");
         switch(l->type.sym){
           case Function:
-            fprintf(listing,"Function     ");
+            outStr(listing,"Function     ");
             break;
           default:
-            fprintf(listing,"Variable     ");
+            outStr(listing,"Variable     ");
             break;
         }
         switch(l->type.ret){
           case Void:
-            fprintf(listing,"void           \n");
+            outStr(listing,"void           \n");
             break;
           case Integer:
-            fprintf(listing,"int            \n");
+            outStr(listing,"int            \n");
             break;
           case VoidPtr:
-            fprintf(listing,"void[]         \n");
+            outStr(listing,"void[]         \n");
             break;
           case IntegerPtr:
-            fprintf(listing,"int[]          \n");
+            outStr(listing,"int[]          \n");
             break;
         }
         
@@ -294,21 +307,24 @@ void printScopetab(FILE* listing, ScopeList scope, int depth){
         while (l != NULL)
         { 
           exist = 1;
-          fprintf(listing, "%-12s  ", scope->scope);
-          fprintf(listing, "%-12d  ", depth);
-          fprintf(listing, "%-13s  ", l->name);
+          outPadStr(listing,scope->scope,12);
+          outStr(listing,"  ");
+          outPadInt(listing,depth,12);
+          outStr(listing,"  ");
+          outPadStr(listing,l->name,13);
+          outStr(listing,"  ");
           switch(l->type.ret){
             case Void:
-              fprintf(listing,"void           \n");
+              outStr(listing,"void           \n");
               break;
             case Integer:
-              fprintf(listing,"int            \n");
+              outStr(listing,"int            \n");
               break;
             case VoidPtr:
-              fprintf(listing,"void[]         \n");
+              outStr(listing,"void[]         \n");
               break;
             case IntegerPtr:
-              fprintf(listing,"int[]          \n");
+              outStr(listing,"int[]          \n");
               break;
           }
           
@@ -321,28 +337,28 @@ void printScopetab(FILE* listing, ScopeList scope, int depth){
     exist = 1;
   //printf("childs: %d\n",scope->childcnt);
   if(exist)
-    fprintf(listing, "\n");
+    outStr(listing,"\n");
   for(int i=0;i<scope->childcnt;++i)
     printScopetab(listing, scope->child[i], depth + 1);
 }
 
 void printTables(FILE* listing)
 { 
-  fprintf(listing,"\n\n< Symbol Table >\n");
-  fprintf(listing," Symbol Name   Symbol Kind   Symbol Type    Scope Name   Location  Line Numbers\n");
-  fprintf(listing,"-------------  -----------  -------------  ------------  --------  ------------\n");
+  outStr(listing,"\n\n< Symbol Table >\n");
+  outStr(listing," Symbol Name   Symbol Kind   Symbol Type    Scope Name   Location  Line Numbers\n");
+  outStr(listing,"-------------  -----------  -------------  ------------  --------  ------------\n");
   printSymtab(listing, tree);
-  fprintf(listing,"\n\n< Functions >\n");
-  fprintf(listing,"Function Name   Return Type   Parameter Name  Parameter Type\n");
-  fprintf(listing,"-------------  -------------  --------------  --------------\n");
+  outStr(listing,"\n\n< Functions >\n");
+  outStr(listing,"Function Name   Return Type   Parameter Name  Parameter Type\n");
+  outStr(listing,"-------------  -------------  --------------  --------------\n");
   printFunctab(listing, tree);
-  fprintf(listing,"\n\n< Global Symbols >\n");
-  fprintf(listing," Symbol Name   Symbol Kind   Symbol Type\n");
-  fprintf(listing,"-------------  -----------  -------------\n");
+  outStr(listing,"\n\n< Global Symbols >\n");
+  outStr(listing," Symbol Name   Symbol Kind   Symbol Type\n");
+  outStr(listing,"-------------  -----------  -------------\n");
   printGlobtab(listing, tree);
-  fprintf(listing,"\n\n< Scopes >\n");
-  fprintf(listing," Scope Name   Nested Level   Symbol Name   Symbol Type\n");
-  fprintf(listing,"------------  ------------  -------------  -----------\n");
-  fprintf(listing,"output        1             value          int        \n");
+  outStr(listing,"\n\n< Scopes >\n");
+  outStr(listing," Scope Name   Nested Level   Symbol Name   Symbol Type\n");
+  outStr(listing,"------------  ------------  -------------  -----------\n");
+  outStr(listing,"output        1             value          int        \n");
   printScopetab(listing, tree, 0);
 } 
@@ -51,6 +51,10 @@ typedef struct BucketListRec{
     Type type;
     LineList lines;
     int memloc ; /* memory location for variable */
+    int offset ; /* for code generation: gp or fp offset
+                    of a variable, entry label of a function */
+    int used ; /* for code generation: a global or function
+                  referenced from code reachable from main */
     struct BucketListRec * next;
 }* BucketList;
 
@@ -66,7 +70,8 @@ typedef struct ScopeListRec{
     int visit;
 }* ScopeList;
 
-ScopeList tree;
+/* the root (global) scope */
+extern ScopeList tree;
 
 int hash(char * key);
 
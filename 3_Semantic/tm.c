@@ -9,411 +9,169 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 
-#ifndef TRUE
-#define TRUE 1
-#endif
-#ifndef FALSE
-#define FALSE 0
-#endif
-
-/******* const *******/
-#define   IADDR_SIZE  1024 /* increase for large programs */
-#define   DADDR_SIZE  1024 /* increase for large programs */
-#define   NO_REGS 8
-#define   PC_REG  7
-
-#define   LINESIZE  121
-#define   WORDSIZE  20
-
-/******* type  *******/
-
-typedef enum {
-   opclRR,     /* reg operands r,s,t */
-   opclRM,     /* reg r, mem d+s */
-   opclRA      /* reg r, int d+s */
-   } OPCLASS;
-
-typedef enum {
-   /* RR instructions */
-   opHALT,    /* RR     halt, operands are ignored */
-   opIN,      /* RR     read into reg(r); s and t are ignored */
-   opOUT,     /* RR     write from reg(r), s and t are ignored */
-   opADD,    /* RR     reg(r) = reg(s)+reg(t) */
-   opSUB,    /* RR     reg(r) = reg(s)-reg(t) */
-   opMUL,    /* RR     reg(r) = reg(s)*reg(t) */
-   opDIV,    /* RR     reg(r) = reg(s)/reg(t) */
-   opRRLim,   /* limit of RR opcodes */
-
-   /* RM instructions */
-   opLD,      /* RM     reg(r) = mem(d+reg(s)) */
-   opST,      /* RM     mem(d+reg(s)) = reg(r) */
-   opRMLim,   /* Limit of RM opcodes */
-
-   /* RA instructions */
-   opLDA,     /* RA     reg(r) = d+reg(s) */
-   opLDC,     /* RA     reg(r) = d ; reg(s) is ignored */
-   opJLT,     /* RA     if reg(r)<0 then reg(7) = d+reg(s) */
-   opJLE,     /* RA     if reg(r)<=0 then reg(7) = d+reg(s) */
-   opJGT,     /* RA     if reg(r)>0 then reg(7) = d+reg(s) */
-   opJGE,     /* RA     if reg(r)>=0 then reg(7) = d+reg(s) */
-   opJEQ,     /* RA     if reg(r)==0 then reg(7) = d+reg(s) */
-   opJNE,     /* RA     if reg(r)!=0 then reg(7) = d+reg(s) */
-   opRALim    /* Limit of RA opcodes */
-   } OPCODE;
-
-typedef enum {
-   srOKAY,
-   srHALT,
-   srIMEM_ERR,
-   srDMEM_ERR,
-   srZERODIVIDE
-   } STEPRESULT;
-
-typedef struct {
-      int iop  ;
-      int iarg1  ;
-      int iarg2  ;
-      int iarg3  ;
-   } INSTRUCTION;
+#include "tm.h"
+#include "tmjit.h"
+#include "tmblock.h"
+#include "tmtrace.h"
+#include "tmundo.h"
+#include "tmremote.h"
 
 /******** vars ********/
 int iloc = 0 ;
 int dloc = 0 ;
 int traceflag = FALSE;
 int icountflag = FALSE;
-
-INSTRUCTION iMem [IADDR_SIZE];
-int dMem [DADDR_SIZE];
-int reg [NO_REGS];
-
-char * opCodeTab[]
-        = {"HALT","IN","OUT","ADD","SUB","MUL","DIV","????",
-            /* RR opcodes */
-           "LD","ST","????", /* RM opcodes */
-           "LDA","LDC","JLT","JLE","JGT","JGE","JEQ","JNE","????"
-           /* RA opcodes */
-          };
-
-char * stepResultTab[]
-        = {"OK","Halted","Instruction Memory Fault",
-           "Data Memory Fault","Division by 0"
-          };
+int jitflag = FALSE;
+int blockflag = FALSE;
 
 char pgmName[20];
-FILE *pgm  ;
-
-char in_Line[LINESIZE] ;
-int lineLen ;
-int inCol  ;
-int num  ;
-char word[WORDSIZE] ;
-char ch  ;
 int done  ;
 
-/********************************************/
-int opClass( int c )
-{ if      ( c <= opRRLim) return ( opclRR );
-  else if ( c <= opRMLim) return ( opclRM );
-  else                    return ( opclRA );
-} /* opClass */
-
-/********************************************/
-void writeInstruction ( int loc )
-{ printf( "%5d: ", loc) ;
-  if ( (loc >= 0) && (loc < IADDR_SIZE) )
-  { printf("%6s%3d,", opCodeTab[iMem[loc].iop], iMem[loc].iarg1);
-    switch ( opClass(iMem[loc].iop) )
-    { case opclRR: printf("%1d,%1d", iMem[loc].iarg2, iMem[loc].iarg3);
-                   break;
-      case opclRM:
-      case opclRA: printf("%3d(%1d)", iMem[loc].iarg2, iMem[loc].iarg3);
-                   break;
-    }
-    printf ("\n") ;
-  }
-} /* writeInstruction */
-
-/********************************************/
-void getCh (void)
-{ if (++inCol < lineLen)
-  ch = in_Line[inCol] ;
-  else ch = ' ' ;
-} /* getCh */
+/* the program read and the machine running it */
+TMPROGRAM program ;
+TM machine ;
+TM * tm = &machine ;
+
+/* the command being scanned */
+TMLINE cmdLine ;
+
+/* buffered IN and OUT, if asked for */
+TMIO io ;
+char * ioIn = NULL ;
+char * ioOut = NULL ;
+int ioBinary = FALSE ;
+
+/* the binary trace, if asked for */
+TRACE * trace = NULL ;
+char * traceName = NULL ;
+int traceLo = 0 ;
+int traceHi = IADDR_SIZE - 1 ;
+int traceLast = 0 ;
+
+/* the log of instructions executed, to go back
+ * through, if asked for
+ */
+UNDO * undo = NULL ;
+int undoSize = 0 ;
+
+/* the pcs to stop at and the dMem addresses to stop
+ * after writing; the program has them only if some
+ * are set
+ */
+TMTRAPS traps ;
+
+/* the stream or socket a debugger sends requests
+ * through instead of the commands, if asked for
+ */
+char * remoteName = NULL ;
+
+/* the state kept by 'mark', if marked */
+TMSNAP mark ;
+int marked = FALSE ;
 
 /********************************************/
-int nonBlank (void)
-{ while ((inCol < lineLen)
-         && (in_Line[inCol] == ' ') )
-    inCol++ ;
-  if (inCol < lineLen)
-  { ch = in_Line[inCol] ;
-    return TRUE ; }
-  else
-  { ch = ' ' ;
-    return FALSE ; }
-} /* nonBlank */
+/* fileName returns the rest of the command, a file
+ * name, or NULL if there is none
+ */
+char * fileName ( TMLINE * l )
+{ char * name ;
+  int end ;
+  if ( atEOL (l) ) return NULL ;
+  name = &l->text[l->col] ;
+  end = strlen(name) ;
+  while ( (end > 0) && isspace(name[end-1]) ) name[--end] = '\0' ;
+  return name ;
+} /* fileName */
 
 /********************************************/
-int getNum (void)
-{ int sign;
-  int term;
-  int temp = FALSE;
-  num = 0 ;
-  do
-  { sign = 1;
-    while ( nonBlank() && ((ch == '+') || (ch == '-')) )
-    { temp = FALSE ;
-      if (ch == '-')  sign = - sign ;
-      getCh();
-    }
-    term = 0 ;
-    nonBlank();
-    while (isdigit(ch))
-    { temp = TRUE ;
-      term = term * 10 + ( ch - '0' ) ;
-      getCh();
-    }
-    num = num + (term * sign) ;
-  } while ( (nonBlank()) && ((ch == '+') || (ch == '-')) ) ;
-  return temp;
-} /* getNum */
+/* written returns the dMem address written by the
+ * instruction at loc, just executed, or -1 if it is
+ * not a ST
+ */
+int written ( int loc )
+{ INSTRUCTION * in = &tm->prog->iMem[loc] ;
+  /* ST leaves the registers as they were */
+  if ( in->iop != opST ) return -1 ;
+  return in->iarg2 + tm->reg[in->iarg3] ;
+} /* written */
 
 /********************************************/
-int getWord (void)
-{ int temp = FALSE;
-  int length = 0;
-  if (nonBlank ())
-  { while (isalnum(ch))
-    { if (length < WORDSIZE-1) word [length++] =  ch ;
-      getCh() ;
-    }
-    word[length] = '\0';
-    temp = (length != 0);
-  }
-  return temp;
-} /* getWord */
+/* step executes an instruction, logging or tracing
+ * it as asked, and stops after it at a breakpoint or
+ * after a write to a watched address
+ */
+STEPRESULT step ( void )
+{ int pc = tm->reg[PC_REG] ;
+  STEPRESULT result ;
+  if ( undo != NULL ) result = undoStep (undo, tm);
+  else if ( trace != NULL ) result = traceStep (trace, tm);
+  else result = stepTM (tm);
+  if ( (result != srOKAY) || (program.traps == NULL) ) return result ;
+  if ( (written (pc) >= 0) && traps.watchAt[written (pc)] ) return srWATCH ;
+  pc = tm->reg[PC_REG] ;
+  if ( (pc >= 0) && (pc < IADDR_SIZE) && traps.breakAt[pc] ) return srBREAK ;
+  return srOKAY ;
+} /* step */
 
 /********************************************/
-int skipCh ( char c  )
-{ int temp = FALSE;
-  if ( nonBlank() && (ch == c) )
-  { getCh();
-    temp = TRUE;
+/* toggle sets or clears the mark of loc in marks,
+ * of size locations
+ */
+void toggle ( char * marks, int size, int loc, char * what )
+{ if ( (loc < 0) || (loc >= size) )
+  { printf("%s out of range\n", what) ;
+    return ;
   }
-  return temp;
-} /* skipCh */
-
-/********************************************/
-int atEOL(void)
-{ return ( ! nonBlank ());
-} /* atEOL */
+  marks[loc] = ! marks[loc] ;
+  printf("%s %d %s.\n", what, loc, marks[loc] ? "set" : "cleared") ;
+} /* toggle */
 
 /********************************************/
-int error( char * msg, int lineNo, int instNo)
-{ printf("Line %d",lineNo);
-  if (instNo >= 0) printf(" (Instruction %d)",instNo);
-  printf("   %s\n",msg);
-  return FALSE;
-} /* error */
+/* setTraps gives the traps to the program and drops
+ * what the engines made of it with the traps it had
+ */
+void setTraps ( void )
+{ tmTraps (&program, &traps) ;
+  jitFlush (&program) ;
+  blockFlush (&program) ;
+} /* setTraps */
 
 /********************************************/
-int readInstructions (void)
-{ OPCODE op;
-  int arg1, arg2, arg3;
-  int loc, regNo, lineNo;
-  for (regNo = 0 ; regNo < NO_REGS ; regNo++)
-      reg[regNo] = 0 ;
-  dMem[0] = DADDR_SIZE - 1 ;
-  for (loc = 1 ; loc < DADDR_SIZE ; loc++)
-      dMem[loc] = 0 ;
-  for (loc = 0 ; loc < IADDR_SIZE ; loc++)
-  { iMem[loc].iop = opHALT ;
-    iMem[loc].iarg1 = 0 ;
-    iMem[loc].iarg2 = 0 ;
-    iMem[loc].iarg3 = 0 ;
-  }
-  lineNo = 0 ;
-  while (! feof(pgm))
-  { fgets( in_Line, LINESIZE-2, pgm  ) ;
-    inCol = 0 ; 
-    lineNo++;
-    lineLen = strlen(in_Line)-1 ;
-    if (in_Line[lineLen]=='\n') in_Line[lineLen] = '\0' ;
-    else in_Line[++lineLen] = '\0';
-    if ( (nonBlank()) && (in_Line[inCol] != '*') )
-    { if (! getNum())
-        return error("Bad location", lineNo,-1);
-      loc = num;
-      if (loc > IADDR_SIZE)
-        return error("Location too large",lineNo,loc);
-      if (! skipCh(':'))
-        return error("Missing colon", lineNo,loc);
-      if (! getWord ())
-        return error("Missing opcode", lineNo,loc);
-      op = opHALT ;
-      while ((op < opRALim)
-             && (strncmp(opCodeTab[op], word, 4) != 0) )
-          op++ ;
-      if (strncmp(opCodeTab[op], word, 4) != 0)
-          return error("Illegal opcode", lineNo,loc);
-      switch ( opClass(op) )
-      { case opclRR :
-        /***********************************/
-        if ( (! getNum ()) || (num < 0) || (num >= NO_REGS) )
-            return error("Bad first register", lineNo,loc);
-        arg1 = num;
-        if ( ! skipCh(','))
-            return error("Missing comma", lineNo, loc);
-        if ( (! getNum ()) || (num < 0) || (num >= NO_REGS) )
-            return error("Bad second register", lineNo, loc);
-        arg2 = num;
-        if ( ! skipCh(',')) 
-            return error("Missing comma", lineNo,loc);
-        if ( (! getNum ()) || (num < 0) || (num >= NO_REGS) )
-            return error("Bad third register", lineNo,loc);
-        arg3 = num;
-        break;
-
-        case opclRM :
-        case opclRA :
-        /***********************************/
-        if ( (! getNum ()) || (num < 0) || (num >= NO_REGS) )
-            return error("Bad first register", lineNo,loc);
-        arg1 = num;
-        if ( ! skipCh(','))
-            return error("Missing comma", lineNo,loc);
-        if (! getNum ())
-            return error("Bad displacement", lineNo,loc);
-        arg2 = num;
-        if ( ! skipCh('(') && ! skipCh(',') )
-            return error("Missing LParen", lineNo,loc);
-        if ( (! getNum ()) || (num < 0) || (num >= NO_REGS))
-            return error("Bad second register", lineNo,loc);
-        arg3 = num;
-        break;
-        }
-      iMem[loc].iop = op;
-      iMem[loc].iarg1 = arg1;
-      iMem[loc].iarg2 = arg2;
-      iMem[loc].iarg3 = arg3;
+/* listMarks prints the locations marked in marks */
+void listMarks ( char * marks, int size, char * what )
+{ int loc, n = 0 ;
+  for (loc = 0 ; loc < size ; loc++)
+    if ( marks[loc] )
+    { printf("%s %d\n", what, loc) ;
+      n++ ;
     }
-  }
-  return TRUE;
-} /* readInstructions */
-
-
-/********************************************/
-STEPRESULT stepTM (void)
-{ INSTRUCTION currentinstruction  ;
-  int pc  ;
-  int r,s,t,m  ;
-  int ok ;
-
-  pc = reg[PC_REG] ;
-  if ( (pc < 0) || (pc > IADDR_SIZE)  )
-      return srIMEM_ERR ;
-  reg[PC_REG] = pc + 1 ;
-  currentinstruction = iMem[ pc ] ;
-  switch (opClass(currentinstruction.iop) )
-  { case opclRR :
-    /***********************************/
-      r = currentinstruction.iarg1 ;
-      s = currentinstruction.iarg2 ;
-      t = currentinstruction.iarg3 ;
-      break;
-
-    case opclRM :
-    /***********************************/
-      r = currentinstruction.iarg1 ;
-      s = currentinstruction.iarg3 ;
-      m = currentinstruction.iarg2 + reg[s] ;
-      if ( (m < 0) || (m > DADDR_SIZE))
-         return srDMEM_ERR ;
-      break;
-
-    case opclRA :
-    /***********************************/
-      r = currentinstruction.iarg1 ;
-      s = currentinstruction.iarg3 ;
-      m = currentinstruction.iarg2 + reg[s] ;
-      break;
-  } /* case */
+  if ( n == 0 ) printf("No %ss.\n", what) ;
+} /* listMarks */
 
-  switch ( currentinstruction.iop)
-  { /* RR instructions */
-    case opHALT :
-    /***********************************/
-      printf("HALT: %1d,%1d,%1d\n",r,s,t);
-      return srHALT ;
-      /* break; */
-
-    case opIN :
-    /***********************************/
-      do
-      { printf("Enter value for IN instruction: ") ;
-        fflush (stdin);
-        fflush (stdout);
-        gets(in_Line);
-        lineLen = strlen(in_Line) ;
-        inCol = 0;
-        ok = getNum();
-        if ( ! ok ) printf ("Illegal value\n");
-        else reg[r] = num;
-      }
-      while (! ok);
-      break;
-
-    case opOUT :  
-      printf ("OUT instruction prints: %d\n", reg[r] ) ;
-      break;
-    case opADD :  reg[r] = reg[s] + reg[t] ;  break;
-    case opSUB :  reg[r] = reg[s] - reg[t] ;  break;
-    case opMUL :  reg[r] = reg[s] * reg[t] ;  break;
-
-    case opDIV :
-    /***********************************/
-      if ( reg[t] != 0 ) reg[r] = reg[s] / reg[t];
-      else return srZERODIVIDE ;
-      break;
-
-    /*************** RM instructions ********************/
-    case opLD :    reg[r] = dMem[m] ;  break;
-    case opST :    dMem[m] = reg[r] ;  break;
-
-    /*************** RA instructions ********************/
-    case opLDA :    reg[r] = m ; break;
-    case opLDC :    reg[r] = currentinstruction.iarg2 ;   break;
-    case opJLT :    if ( reg[r] <  0 ) reg[PC_REG] = m ; break;
-    case opJLE :    if ( reg[r] <=  0 ) reg[PC_REG] = m ; break;
-    case opJGT :    if ( reg[r] >  0 ) reg[PC_REG] = m ; break;
-    case opJGE :    if ( reg[r] >=  0 ) reg[PC_REG] = m ; break;
-    case opJEQ :    if ( reg[r] == 0 ) reg[PC_REG] = m ; break;
-    case opJNE :    if ( reg[r] != 0 ) reg[PC_REG] = m ; break;
-
-    /* end of legal instructions */
-  } /* case */
-  return srOKAY ;
-} /* stepTM */
 
 /********************************************/
 int doCommand (void)
 { char cmd;
   int stepcnt=0, i;
+  clock_t start;
+  double seconds;
   int printcnt;
   int stepResult;
-  int regNo, loc;
+  int fast;
+  TMLINE * l = &cmdLine;
+  char * name;
+  long back;
   do
   { printf ("Enter command: ");
-    fflush (stdin);
     fflush (stdout);
-    gets(in_Line);
-    lineLen = strlen(in_Line);
-    inCol = 0;
+    /* the end of the commands quits */
+    if ( ! readLine (l, stdin) ) return FALSE;
   }
-  while (! getWord ());
+  while (! getWord (l));
 
-  cmd = word[0] ;
+  cmd = l->word[0] ;
   switch ( cmd )
   { case 't' :
     /***********************************/
@@ -440,8 +198,26 @@ int doCommand (void)
       printf("   p(rint         "\
              "Toggle print of total instructions executed"\
              " ('go' only)\n");
+      printf("   j(it           "\
+             "Toggle native execution of 'go' when not tracing\n");
       printf("   c(lear         "\
              "Reset simulator for new execution of program\n");
+      printf("   m(ark          "\
+             "Keep the state of the machine in memory\n");
+      printf("   a(gain         "\
+             "Return the machine to the state kept by mark\n");
+      printf("   b(reak <loc>   "\
+             "Set or clear a breakpoint at loc, or list them\n");
+      printf("   w(atch <addr>  "\
+             "Set or clear a watch on dMem addr, or list them\n");
+      printf("   back <n>       "\
+             "Go back n (default 1) instructions (--undo)\n");
+      printf("   rc             "\
+             "Run back to a breakpoint or watched write (--undo)\n");
+      printf("   save <file>    "\
+             "Save the state of the machine to file\n");
+      printf("   l(oad <file>   "\
+             "Load the state of the machine saved to file\n");
       printf("   h(elp          "\
              "Cause this list of commands to be printed\n");
       printf("   q(uit          "\
@@ -455,10 +231,22 @@ int doCommand (void)
       if ( icountflag ) printf("on.\n"); else printf("off.\n");
       break;
 
+    case 'j' :
+    /***********************************/
+      jitflag = ! jitflag ;
+      printf("Native execution now ");
+      if ( jitflag ) printf("on.\n"); else printf("off.\n");
+      break;
+
     case 's' :
     /***********************************/
-      if ( atEOL ())  stepcnt = 1;
-      else if ( getNum ())  stepcnt = abs(num);
+      if ( strcmp (l->word, "save") == 0 )
+      { name = fileName (l);
+        if ( name == NULL ) printf ("File name?\n");
+        else if ( tmSave (tm, name) ) printf ("Saved to %s\n", name);
+      }
+      else if ( atEOL (l))  stepcnt = 1;
+      else if ( getNum (l))  stepcnt = abs(l->num);
       else   printf("Step count?\n");
       break;
 
@@ -466,8 +254,21 @@ int doCommand (void)
 
     case 'r' :
     /***********************************/
+      if ( strcmp (l->word, "rc") == 0 )
+      { if ( undo == NULL )
+        { printf("Run with --undo to go back.\n");
+          break;
+        }
+        i = undoReverse (undo, tm, traps.breakAt, traps.watchAt, &back);
+        printf("Back %ld instructions%s\n", back,
+               i ? "" : ", as far as the log goes.");
+        if ( i ) printf("%s\n", stepResultTab
+                         [traps.breakAt[tm->reg[PC_REG]] ? srBREAK : srWATCH]);
+        writeInstruction (tm->prog, tm->reg[PC_REG]);
+        break;
+      }
       for (i = 0; i < NO_REGS; i++)
-      { printf("%1d: %4d    ", i,reg[i]);
+      { printf("%1d: %4d    ", i,tm->reg[i]);
         if ( (i % 4) == 3 ) printf ("\n");
       }
       break;
@@ -475,16 +276,16 @@ int doCommand (void)
     case 'i' :
     /***********************************/
       printcnt = 1 ;
-      if ( getNum ())
-      { iloc = num ;
-        if ( getNum ()) printcnt = num ;
+      if ( getNum (l))
+      { iloc = l->num ;
+        if ( getNum (l)) printcnt = l->num ;
       }
-      if ( ! atEOL ())
+      if ( ! atEOL (l))
         printf ("Instruction locations?\n");
       else
       { while ((iloc >= 0) && (iloc < IADDR_SIZE)
                 && (printcnt > 0) )
-        { writeInstruction(iloc);
+        { writeInstruction(tm->prog, iloc);
           iloc++ ;
           printcnt-- ;
         }
@@ -494,16 +295,16 @@ int doCommand (void)
     case 'd' :
     /***********************************/
       printcnt = 1 ;
-      if ( getNum  ())
-      { dloc = num ;
-        if ( getNum ()) printcnt = num ;
+      if ( getNum (l))
+      { dloc = l->num ;
+        if ( getNum (l)) printcnt = l->num ;
       }
-      if ( ! atEOL ())
+      if ( ! atEOL (l))
         printf("Data locations?\n");
       else
       { while ((dloc >= 0) && (dloc < DADDR_SIZE)
                   && (printcnt > 0))
-        { printf("%5d: %5d\n",dloc,dMem[dloc]);
+        { printf("%5d: %5d\n",dloc,tm->dMem[dloc]);
           dloc++;
           printcnt--;
         }
@@ -515,11 +316,68 @@ int doCommand (void)
       iloc = 0;
       dloc = 0;
       stepcnt = 0;
-      for (regNo = 0;  regNo < NO_REGS ; regNo++)
-            reg[regNo] = 0 ;
-      dMem[0] = DADDR_SIZE - 1 ;
-      for (loc = 1 ; loc < DADDR_SIZE ; loc++)
-            dMem[loc] = 0 ;
+      tmReset(tm);
+      if ( undo != NULL ) undoReset(undo);
+      break;
+
+    case 'b' :
+    /***********************************/
+      if ( strcmp (l->word, "back") == 0 )
+      { if ( undo == NULL )
+        { printf("Run with --undo to go back.\n");
+          break;
+        }
+        back = 1;
+        if ( getNum (l)) back = l->num;
+        if ( back < 0 ) back = 0;
+        back = undoBack (undo, tm, back);
+        printf("Back %ld instructions.\n", back);
+        writeInstruction (tm->prog, tm->reg[PC_REG]);
+      }
+      else if ( atEOL (l))
+        listMarks (traps.breakAt, IADDR_SIZE, "breakpoint");
+      else if ( getNum (l))
+      { toggle (traps.breakAt, IADDR_SIZE, l->num, "breakpoint");
+        setTraps ();
+      }
+      else printf ("Breakpoint location?\n");
+      break;
+
+    case 'w' :
+    /***********************************/
+      if ( atEOL (l)) listMarks (traps.watchAt, DADDR_SIZE, "watch");
+      else if ( getNum (l))
+      { toggle (traps.watchAt, DADDR_SIZE, l->num, "watch");
+        setTraps ();
+      }
+      else printf ("Watched address?\n");
+      break;
+
+    case 'm' :
+    /***********************************/
+      tmSnapshot(tm, &mark);
+      marked = TRUE;
+      printf("State marked.\n");
+      break;
+
+    case 'a' :
+    /***********************************/
+      if ( ! marked ) printf("No state marked.\n");
+      else
+      { tmRestore(tm, &mark);
+        if ( undo != NULL ) undoReset(undo);
+        printf("State returned to the mark.\n");
+      }
+      break;
+
+    case 'l' :
+    /***********************************/
+      name = fileName (l);
+      if ( name == NULL ) printf ("File name?\n");
+      else if ( tmLoad (tm, name) )
+      { if ( undo != NULL ) undoReset(undo);
+        printf ("Loaded %s\n", name);
+      }
       break;
 
     case 'q' : return FALSE;  /* break; */
@@ -530,23 +388,56 @@ int doCommand (void)
   if ( stepcnt > 0 )
   { if ( cmd == 'g' )
     { stepcnt = 0;
-      while (stepResult == srOKAY)
-      { iloc = reg[PC_REG] ;
-        if ( traceflag ) writeInstruction( iloc ) ;
-        stepResult = stepTM ();
+      start = clock();
+      /* the native and block runs only run, stopping
+       * at the traps made part of their code, before a
+       * breakpoint: the one the machine may be at is
+       * gone past first
+       */
+      fast = ! traceflag && (trace == NULL) && (undo == NULL) ;
+      if ( fast && (jitflag || blockflag) )
+      { stepResult = step ();
         stepcnt++;
+        if ( (stepResult == srOKAY) && jitflag )
+          stepResult = jitRun (tm, &stepcnt);
+        else if ( stepResult == srOKAY )
+          stepResult = blockRun (tm, &stepcnt);
       }
+      else if ( fast && (program.traps == NULL) )
+        while (stepResult == srOKAY)
+        { stepResult = stepTM (tm);
+          stepcnt++;
+        }
+      else
+        while (stepResult == srOKAY)
+        { iloc = tm->reg[PC_REG] ;
+          if ( traceflag ) writeInstruction( tm->prog, iloc ) ;
+          stepResult = step ();
+          stepcnt++;
+        }
+      seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
       if ( icountflag )
-        printf("Number of instructions executed = %d\n",stepcnt);
+      { printf("Number of instructions executed = %d\n",stepcnt);
+        if ( seconds > 0 )
+          printf("Instructions per second = %.0f\n",stepcnt / seconds);
+        if ( blockflag && ! jitflag && fast )
+          blockReport(seconds);
+      }
     }
     else
     { while ((stepcnt > 0) && (stepResult == srOKAY))
-      { iloc = reg[PC_REG] ;
-        if ( traceflag ) writeInstruction( iloc ) ;
-        stepResult = stepTM ();
+      { iloc = tm->reg[PC_REG] ;
+        if ( traceflag ) writeInstruction( tm->prog, iloc ) ;
+        stepResult = step ();
         stepcnt-- ;
       }
     }
+    if ( tm->io != NULL ) ioFlush (tm->io);
+    if ( trace != NULL ) traceFlush (trace);
+    if ( stepResult == srWATCH )
+    { i = written (tm->reg[PC_REG] - 1);
+      printf("dMem[%d] = %d\n", i, tm->dMem[i]);
+    }
     printf( "%s\n",stepResultTab[stepResult] );
   }
   return TRUE;
@@ -558,11 +449,39 @@ int doCommand (void)
 /********************************************/
 
 main( int argc, char * argv[] )
-{ if (argc != 2)
-  { printf("usage: %s <filename>\n",argv[0]);
+{ int arg = 1;
+  FILE * pgm;
+  while ((arg < argc - 1) && (argv[arg][0] == '-'))
+  { if (strcmp(argv[arg],"--jit") == 0) jitflag = TRUE;
+    else if (strcmp(argv[arg],"--blocks") == 0) blockflag = TRUE;
+    else if (strncmp(argv[arg],"--in=",5) == 0) ioIn = argv[arg] + 5;
+    else if (strncmp(argv[arg],"--out=",6) == 0) ioOut = argv[arg] + 6;
+    else if (strcmp(argv[arg],"--binary") == 0) ioBinary = TRUE;
+    else if (strncmp(argv[arg],"--trace=",8) == 0) traceName = argv[arg] + 8;
+    else if (strncmp(argv[arg],"--trace-pc=",11) == 0)
+    { if (sscanf(argv[arg] + 11,"%d,%d",&traceLo,&traceHi) != 2) break;
+    }
+    else if (strncmp(argv[arg],"--trace-last=",13) == 0)
+      traceLast = atoi(argv[arg] + 13);
+    else if (strcmp(argv[arg],"--undo") == 0) undoSize = 1 << 18;
+    else if (strncmp(argv[arg],"--undo=",7) == 0)
+      undoSize = atoi(argv[arg] + 7);
+    else if (strcmp(argv[arg],"--remote") == 0) remoteName = "-";
+    else if (strncmp(argv[arg],"--remote=",9) == 0)
+      remoteName = argv[arg] + 9;
+    else break;
+    arg++;
+  }
+  if ((arg != argc - 1) || ((traceName != NULL) && (undoSize > 0)) ||
+      ((remoteName != NULL) && ((traceName != NULL) || (undoSize > 0))))
+  { printf("usage: %s [--jit] [--blocks] [--in=<file>] [--out=<file>] "
+           "[--binary]\n          [--trace=<file> [--trace-pc=<lo>,<hi>] "
+           "[--trace-last=<n>]]\n          [--undo[=<n>]] "
+           "[--remote[=<socket>]] <filename>\n",
+           argv[0]);
     exit(1);
   }
-  strcpy(pgmName,argv[1]) ;
+  strcpy(pgmName,argv[arg]) ;
   if (strchr (pgmName, '.') == NULL)
      strcat(pgmName,".tm");
   pgm = fopen(pgmName,"r");
@@ -572,8 +491,64 @@ main( int argc, char * argv[] )
   }
 
   /* read the program */
-  if ( ! readInstructions ())
+  if ( ! readInstructions (&program, pgm))
          exit(1) ;
+  tmInit(tm, &program, stdin, stdout);
+  /* IN values from a file and OUT values to one, or
+   * to the standard output for -, buffered
+   */
+  if ( (ioIn != NULL) || (ioOut != NULL) )
+  { FILE * in = NULL, * out = NULL;
+    if ( ioIn != NULL )
+    { in = fopen(ioIn, ioBinary ? "rb" : "r");
+      if ( in == NULL )
+      { printf("file '%s' not found\n",ioIn);
+        exit(1);
+      }
+    }
+    if ( ioOut != NULL )
+    { out = strcmp(ioOut,"-") == 0 ? stdout
+                                   : fopen(ioOut, ioBinary ? "wb" : "w");
+      if ( out == NULL )
+      { printf("cannot write '%s'\n",ioOut);
+        exit(1);
+      }
+    }
+    ioOpen(&io, in, out, ioBinary);
+    tm->io = &io;
+  }
+  if ( traceName != NULL )
+  { trace = traceOpen(traceName, &program, traceLo, traceHi, traceLast);
+    if ( trace == NULL )
+    { printf("cannot write '%s'\n",traceName);
+      exit(1);
+    }
+  }
+  if ( undoSize > 0 )
+  { undo = undoOpen(undoSize);
+    if ( undo == NULL )
+    { printf("Out of memory for the undo log\n");
+      exit(1);
+    }
+  }
+  /* a debugger drives the machine instead of the
+   * commands; IN prompts, OUT and HALT keep off its
+   * stream, and without a terminal IN has no input
+   */
+  if ( remoteName != NULL )
+  { FILE * in, * out;
+    if ( ! remoteOpen(remoteName, &in, &out) )
+    { printf("cannot listen on '%s'\n",remoteName);
+      exit(1);
+    }
+    if ( in == stdin )
+    { tm->in = fopen("/dev/null", "r");
+      tm->out = stderr;
+    }
+    remoteServe(tm, &traps, in, out, jitflag, blockflag);
+    remoteClose(remoteName, in, out);
+    return 0;
+  }
   /* switch input file to terminal */
   /* reset( input ); */
   /* read-eval-print */
@@ -581,6 +556,7 @@ main( int argc, char * argv[] )
   do
      done = ! doCommand ();
   while (! done );
+  if ( trace != NULL ) traceClose(trace);
   printf("Simulation done.\n");
   return 0;
 }
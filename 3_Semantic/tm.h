@@ -0,0 +1,208 @@
+/****************************************************/
+/* File: tm.h                                       */
+/* The TM ("Tiny Machine") computer: the machine    */
+/* shared by the simulator and the tools around it  */
+/****************************************************/
+
+#ifndef _TM_H_
+#define _TM_H_
+
+#include <stdio.h>
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+/******* const *******/
+#define   IADDR_SIZE  1024 /* increase for large programs */
+#define   DADDR_SIZE  1024 /* increase for large programs */
+#define   NO_REGS 8
+#define   PC_REG  7
+
+/* the pages of dMem written are tracked, so that
+ * resetting a machine only touches those
+ */
+#define   DPAGE_SHIFT 6
+#define   DPAGES ((DADDR_SIZE + (1 << DPAGE_SHIFT) - 1) >> DPAGE_SHIFT)
+
+#define   LINESIZE  121
+#define   IOBUFSIZE 65536
+#define   WORDSIZE  20
+
+/******* type  *******/
+
+typedef enum {
+   opclRR,     /* reg operands r,s,t */
+   opclRM,     /* reg r, mem d+s */
+   opclRA      /* reg r, int d+s */
+   } OPCLASS;
+
+typedef enum {
+   /* RR instructions */
+   opHALT,    /* RR     halt, operands are ignored */
+   opIN,      /* RR     read into reg(r); s and t are ignored */
+   opOUT,     /* RR     write from reg(r), s and t are ignored */
+   opADD,    /* RR     reg(r) = reg(s)+reg(t) */
+   opSUB,    /* RR     reg(r) = reg(s)-reg(t) */
+   opMUL,    /* RR     reg(r) = reg(s)*reg(t) */
+   opDIV,    /* RR     reg(r) = reg(s)/reg(t) */
+   opRRLim,   /* limit of RR opcodes */
+
+   /* RM instructions */
+   opLD,      /* RM     reg(r) = mem(d+reg(s)) */
+   opST,      /* RM     mem(d+reg(s)) = reg(r) */
+   opRMLim,   /* Limit of RM opcodes */
+
+   /* RA instructions */
+   opLDA,     /* RA     reg(r) = d+reg(s) */
+   opLDC,     /* RA     reg(r) = d ; reg(s) is ignored */
+   opJLT,     /* RA     if reg(r)<0 then reg(7) = d+reg(s) */
+   opJLE,     /* RA     if reg(r)<=0 then reg(7) = d+reg(s) */
+   opJGT,     /* RA     if reg(r)>0 then reg(7) = d+reg(s) */
+   opJGE,     /* RA     if reg(r)>=0 then reg(7) = d+reg(s) */
+   opJEQ,     /* RA     if reg(r)==0 then reg(7) = d+reg(s) */
+   opJNE,     /* RA     if reg(r)!=0 then reg(7) = d+reg(s) */
+   opRALim    /* Limit of RA opcodes */
+   } OPCODE;
+
+typedef enum {
+   srOKAY,
+   srHALT,
+   srIMEM_ERR,
+   srDMEM_ERR,
+   srZERODIVIDE,
+   srNOINPUT,
+   srBADINPUT,
+   srBREAK,      /* the simulator stopped at a breakpoint */
+   srWATCH       /* or after a write to a watched address */
+   } STEPRESULT;
+
+typedef struct {
+      int iop  ;
+      int iarg1  ;
+      int iarg2  ;
+      int iarg3  ;
+   } INSTRUCTION;
+
+/* a line being scanned: a line of a program, a
+ * command or an IN value, and what was last
+ * scanned from it
+ */
+typedef struct {
+      char text [LINESIZE] ;
+      int len ;
+      int col ;
+      int num ;
+      char word [WORDSIZE] ;
+      char ch ;
+   } TMLINE;
+
+/* where machines stop: before executing the
+ * locations marked in breakAt, and after writing the
+ * dMem addresses marked in watchAt, whose pages are
+ * marked in watchPage
+ */
+typedef struct {
+      char breakAt [IADDR_SIZE] ;
+      char watchAt [DADDR_SIZE] ;
+      char watchPage [DPAGES] ;
+      int nbreaks ;
+      int nwatches ;
+   } TMTRAPS;
+
+/* a program: once read, its code is only read, so
+ * any number of machines may run it at once; jit
+ * and blocks are what tmjit.c and tmblock.c make
+ * of it, with the traps it had then
+ */
+typedef struct {
+      INSTRUCTION iMem [IADDR_SIZE] ;
+      void * jit ;
+      void * blocks ;
+      TMTRAPS * traps ; /* or NULL if there are none */
+   } TMPROGRAM;
+
+/* buffered IN and OUT, reading and writing values
+ * as text, one per line, or as 32-bit little-endian
+ * words if binary is TRUE, with no prompts or messages
+ */
+typedef struct {
+      FILE * in ;   /* or NULL to prompt for IN values */
+      FILE * out ;  /* or NULL to print OUT messages */
+      int binary ;
+      int inLen ;
+      int inPos ;
+      int outLen ;
+      unsigned char inBuf [IOBUFSIZE] ;
+      char outBuf [IOBUFSIZE] ;
+   } TMIO;
+
+/* the state of a machine at some point; the positions
+ * are -1 where its files cannot be positioned
+ */
+typedef struct {
+      TMPROGRAM * prog ;
+      int reg [NO_REGS] ;
+      int dMem [DADDR_SIZE] ;
+      long inPos ;
+      long outPos ;
+   } TMSNAP;
+
+/* a machine running a program */
+typedef struct {
+      TMPROGRAM * prog ;
+      int reg [NO_REGS] ;
+      int dMem [DADDR_SIZE] ;
+      unsigned char dirty [DPAGES] ; /* pages written since base */
+      TMSNAP * base ; /* or NULL for the cleared machine */
+      FILE * in ;     /* IN values come from here */
+      FILE * out ;    /* IN prompts, OUT and HALT go here */
+      TMLINE line ;   /* the last IN value */
+      TMIO * io ;     /* or NULL if IN and OUT use in and out */
+   } TM;
+
+/******** vars ********/
+/* in tmload.c */
+extern char * opCodeTab[];
+extern char * stepResultTab[];
+
+/******** procs ********/
+/* in tmload.c */
+int opClass( int c );
+int readLine ( TMLINE * l, FILE * f );
+void getCh ( TMLINE * l );
+int nonBlank ( TMLINE * l );
+int getNum ( TMLINE * l );
+int getWord ( TMLINE * l );
+int skipCh ( TMLINE * l, char c );
+int atEOL ( TMLINE * l );
+void writeInstruction ( TMPROGRAM * p, int loc );
+unsigned programHash ( TMPROGRAM * p );
+int error( char * msg, int lineNo, int instNo);
+int readInstructions ( TMPROGRAM * p, FILE * pgm );
+
+/* in tmexec.c */
+void tmInit ( TM * m, TMPROGRAM * p, FILE * in, FILE * out );
+void tmReset ( TM * m );
+STEPRESULT stepTM ( TM * m );
+STEPRESULT trapTM ( TM * m );
+void tmTraps ( TMPROGRAM * p, TMTRAPS * t );
+
+/* in tmio.c */
+void ioOpen ( TMIO * io, FILE * in, FILE * out, int binary );
+STEPRESULT ioRead ( TMIO * io, int * value );
+void ioWrite ( TMIO * io, int value );
+void ioFlush ( TMIO * io );
+long ioTell ( TMIO * io );
+void ioSeek ( TMIO * io, long pos );
+
+/* in tmsnap.c */
+void tmSnapshot ( TM * m, TMSNAP * s );
+void tmRestore ( TM * m, TMSNAP * s );
+int tmSave ( TM * m, char * name );
+int tmLoad ( TM * m, char * name );
+
+#endif
@@ -0,0 +1,334 @@
+/****************************************************/
+/* File: tm2c.c                                     */
+/* Translation of TM programs to C, to be compiled  */
+/* into programs that run without the simulator     */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "tm.h"
+
+/* The program read by readInstructions becomes a C
+ * main() with TM registers 0 to 6 in local variables
+ * and dMem in a static array. Each location is a case
+ * of a switch on the pc, falling through to the next
+ * one; the pc is a constant at each instruction, so a
+ * jump to a constant location is a goto its label and
+ * only computed jumps go back to the switch. Reading
+ * an IN value, the OUT and HALT messages and the
+ * checks of dMem and of division are those of stepTM.
+ * The program prints how it stopped as the simulator
+ * does after 'go', and exits with 0 if it halted, or
+ * the number of the fault: 1 for iMem, 2 for dMem and
+ * 3 for division by 0, or 4 if its input ran out.
+ */
+
+static FILE * out;
+
+/* the program translated */
+static TMPROGRAM program;
+static INSTRUCTION * iMem = program.iMem;
+
+/* locations with code, then HALT 0,0,0 to the end */
+static int ncode;
+
+/* locations that static jumps go to */
+static int target [IADDR_SIZE];
+
+/* the registers the program uses */
+static int used [NO_REGS];
+
+/* staticTarget returns the location the instruction
+ * at loc jumps to if it is a constant, or -1
+ */
+static int staticTarget( int loc )
+{ INSTRUCTION * in = &iMem[loc];
+  if ((in->iop >= opJLT) && (in->iarg3 == PC_REG))
+    return in->iarg2 + loc + 1;
+  if (in->iarg1 != PC_REG) return -1;
+  if ((in->iop == opLDA) && (in->iarg3 == PC_REG))
+    return in->iarg2 + loc + 1;
+  if (in->iop == opLDC) return in->iarg2;
+  return -1;
+}
+
+/* source returns the C for TM register r read at loc */
+static char * source( int r, int loc )
+{ static char buf [2][16];
+  static int which = 0;
+  which = 1 - which;
+  if (r == PC_REG) sprintf(buf[which],"%d",loc + 1);
+  else sprintf(buf[which],"r%d",r);
+  return buf[which];
+}
+
+/* emitGoto emits a jump to constant location t */
+static void emitGoto( int t )
+{ if ((t >= 0) && (t < ncode)) fprintf(out,"goto L%d;\n",t);
+  else fprintf(out,"{ pc = %d; continue; }\n",t);
+}
+
+/* emitSet emits the assignment of C expression e to
+ * TM register r; writing the pc is a jump
+ */
+static void emitSet( int r, char * e )
+{ if (r == PC_REG) fprintf(out,"{ pc = %s; continue; }\n",e);
+  else fprintf(out,"r%d = %s;\n",r,e);
+}
+
+/* emitAddress emits the check of the dMem address
+ * d+reg(s) of the instruction at loc and returns the
+ * C for it
+ */
+static char * emitAddress( int d, int s, int loc )
+{ static char buf [32];
+  if (s == PC_REG)
+  { if ((d + loc + 1 < 0) || (d + loc + 1 >= DADDR_SIZE))
+      fprintf(out,"        stop(%d);\n",srDMEM_ERR);
+    sprintf(buf,"%d",d + loc + 1);
+  }
+  else
+  { fprintf(out,"        m = r%d + %d;\n",s,d);
+    fprintf(out,"        if ((m < 0) || (m >= DADDR_SIZE)) stop(%d);\n",
+            srDMEM_ERR);
+    strcpy(buf,"m");
+  }
+  return buf;
+}
+
+/* emitInstruction emits the C of the instruction at loc */
+static void emitInstruction( int loc )
+{ INSTRUCTION * in = &iMem[loc];
+  int r = in->iarg1, s = in->iarg2, t = in->iarg3, d = in->iarg2;
+  char e [64];
+  char * a;
+  static char * ops [] = { "+", "-", "*" };
+  static char * tests [] = { "< 0", "<= 0", "> 0", ">= 0", "== 0", "!= 0" };
+  fprintf(out,"      case %d :",loc);
+  if (target[loc]) fprintf(out," L%d:",loc);
+  fprintf(out," /* %s %d,",opCodeTab[in->iop],r);
+  if (opClass(in->iop) == opclRR) fprintf(out,"%d,%d */\n",s,t);
+  else fprintf(out,"%d(%d) */\n",d,t);
+  switch (in->iop)
+  { case opHALT :
+      fprintf(out,"        printf(\"HALT: %d,%d,%d\\n\");\n",r,s,t);
+      fprintf(out,"        stop(%d);\n",srHALT);
+      break;
+    case opIN :
+      fprintf(out,"        ");
+      emitSet(r,"readValue()");
+      break;
+    case opOUT :
+      fprintf(out,"        printf(\"OUT instruction prints: %%d\\n\",%s);\n",
+              source(r,loc));
+      break;
+    case opADD :
+    case opSUB :
+    case opMUL :
+      /* TM arithmetic wraps around */
+      sprintf(e,"(int) ((unsigned) %s %s (unsigned) %s)",
+              source(s,loc),ops[in->iop - opADD],source(t,loc));
+      fprintf(out,"        ");
+      emitSet(r,e);
+      break;
+    case opDIV :
+      fprintf(out,"        if (%s == 0) stop(%d);\n",source(t,loc),
+              srZERODIVIDE);
+      sprintf(e,"%s / %s",source(s,loc),source(t,loc));
+      fprintf(out,"        ");
+      emitSet(r,e);
+      break;
+    case opLD :
+      a = emitAddress(d,t,loc);
+      sprintf(e,"dMem[%s]",a);
+      fprintf(out,"        ");
+      emitSet(r,e);
+      break;
+    case opST :
+      a = emitAddress(d,t,loc);
+      fprintf(out,"        dMem[%s] = %s;\n",a,source(r,loc));
+      break;
+    case opLDA :
+      fprintf(out,"        ");
+      if (t == PC_REG)
+      { if (r == PC_REG) emitGoto(d + loc + 1);
+        else fprintf(out,"r%d = %d;\n",r,d + loc + 1);
+      }
+      else
+      { sprintf(e,"r%d + %d",t,d);
+        emitSet(r,e);
+      }
+      break;
+    case opLDC :
+      fprintf(out,"        ");
+      if (r == PC_REG) emitGoto(d);
+      else fprintf(out,"r%d = %d;\n",r,d);
+      break;
+    default :
+      /* conditional jumps */
+      fprintf(out,"        ");
+      if (r != PC_REG)
+        fprintf(out,"if (r%d %s) ",r,tests[in->iop - opJLT]);
+      else if (! ((in->iop == opJGT) || (in->iop == opJGE) ||
+                  (in->iop == opJNE)))
+      { /* the pc is never <= 0 */
+        fprintf(out,";\n");
+        break;
+      }
+      if (t == PC_REG) emitGoto(d + loc + 1);
+      else fprintf(out,"{ pc = r%d + %d; continue; }\n",t,d);
+      break;
+  }
+}
+
+/* usesRegister tells if the instruction at loc reads
+ * or writes TM register r
+ */
+static int usesRegister( int loc, int r )
+{ INSTRUCTION * in = &iMem[loc];
+  if (in->iop == opHALT) return FALSE;
+  if (in->iarg1 == r) return TRUE;
+  if (opClass(in->iop) == opclRR)
+    return (in->iop > opOUT) && ((in->iarg2 == r) || (in->iarg3 == r));
+  return (in->iop != opLDC) && (in->iarg3 == r);
+}
+
+/* the code of every translation, after stepResultTab */
+static char * runtime [] =
+{ "static int dMem [DADDR_SIZE];",
+  "",
+  "static char line [LINESIZE];",
+  "static int lineLen, inCol, num;",
+  "static char ch;",
+  "",
+  "static void stop( int result )",
+  "{ printf(\"%s\\n\",stepResultTab[result]);",
+  "  exit(result - 1);",
+  "}",
+  "",
+  "static void getCh( void )",
+  "{ if (++inCol < lineLen) ch = line[inCol];",
+  "  else ch = ' ';",
+  "}",
+  "",
+  "static int nonBlank( void )",
+  "{ while ((inCol < lineLen) && (line[inCol] == ' ')) inCol++;",
+  "  ch = inCol < lineLen ? line[inCol] : ' ';",
+  "  return inCol < lineLen;",
+  "}",
+  "",
+  "/* getNum scans a number as the TM does */",
+  "static int getNum( void )",
+  "{ int sign, term, temp = 0;",
+  "  num = 0;",
+  "  do",
+  "  { sign = 1;",
+  "    while (nonBlank() && ((ch == '+') || (ch == '-')))",
+  "    { temp = 0;",
+  "      if (ch == '-') sign = - sign;",
+  "      getCh();",
+  "    }",
+  "    term = 0;",
+  "    nonBlank();",
+  "    while (isdigit(ch))",
+  "    { temp = 1;",
+  "      term = term * 10 + (ch - '0');",
+  "      getCh();",
+  "    }",
+  "    num = num + (term * sign);",
+  "  } while (nonBlank() && ((ch == '+') || (ch == '-')));",
+  "  return temp;",
+  "}",
+  "",
+  "/* readValue reads the value of an IN instruction */",
+  "static int readValue( void )",
+  "{ for (;;)",
+  "  { printf(\"Enter value for IN instruction: \");",
+  "    fflush(stdout);",
+  "    if (fgets(line,LINESIZE,stdin) == NULL)",
+  "      stop(NOINPUT);",
+  "    lineLen = strlen(line);",
+  "    if ((lineLen > 0) && (line[lineLen-1] == '\\n')) line[--lineLen] = '\\0';",
+  "    inCol = 0;",
+  "    if (getNum()) return num;",
+  "    printf(\"Illegal value\\n\");",
+  "  }",
+  "}",
+  "",
+  NULL
+};
+
+/* translate writes the C of the program in iMem */
+static void translate( char * name )
+{ int loc, r, usesM = FALSE;
+  for (ncode = IADDR_SIZE; ncode > 0; ncode--)
+  { INSTRUCTION * in = &iMem[ncode - 1];
+    if ((in->iop != opHALT) || (in->iarg1 != 0) || (in->iarg2 != 0) ||
+        (in->iarg3 != 0))
+      break;
+  }
+  for (loc = 0; loc < ncode; loc++)
+  { r = staticTarget(loc);
+    if ((r >= 0) && (r < ncode)) target[r] = TRUE;
+    for (r = 0; r < PC_REG; r++)
+      if (usesRegister(loc,r)) used[r] = TRUE;
+    if (((iMem[loc].iop == opLD) || (iMem[loc].iop == opST)) &&
+        (iMem[loc].iarg3 != PC_REG))
+      usesM = TRUE;
+  }
+  fprintf(out,"/* %s translated to C by tm2c */\n\n",name);
+  fprintf(out,"#define IADDR_SIZE %d\n",IADDR_SIZE);
+  fprintf(out,"#define DADDR_SIZE %d\n",DADDR_SIZE);
+  fprintf(out,"#define LINESIZE %d\n",LINESIZE);
+  fprintf(out,"#define NOINPUT %d\n\n",srNOINPUT);
+  fprintf(out,"#include <stdio.h>\n#include <stdlib.h>\n");
+  fprintf(out,"#include <string.h>\n#include <ctype.h>\n\n");
+  fprintf(out,"static char * stepResultTab [] =\n");
+  for (loc = srOKAY; loc <= srNOINPUT; loc++)
+    fprintf(out,"  %c \"%s\"\n",loc == srOKAY ? '{' : ',',stepResultTab[loc]);
+  fprintf(out,"  };\n\n");
+  for (r = 0; runtime[r] != NULL; r++) fprintf(out,"%s\n",runtime[r]);
+  fprintf(out,"int main( void )\n{ int pc = 0;\n");
+  if (usesM) fprintf(out,"  int m;\n");
+  for (r = 0; r < PC_REG; r++)
+    if (used[r]) fprintf(out,"  int r%d = 0;\n",r);
+  fprintf(out,"  dMem[0] = DADDR_SIZE - 1;\n");
+  fprintf(out,"  for (;;)\n    switch (pc)\n    {\n");
+  for (loc = 0; loc < ncode; loc++) emitInstruction(loc);
+  if (ncode > 0) fprintf(out,"        pc = %d;\n",ncode);
+  fprintf(out,"      default :\n");
+  fprintf(out,"        if ((pc >= 0) && (pc < IADDR_SIZE))\n");
+  fprintf(out,"        { printf(\"HALT: 0,0,0\\n\");\n");
+  fprintf(out,"          stop(%d);\n        }\n",srHALT);
+  fprintf(out,"        stop(%d);\n",srIMEM_ERR);
+  fprintf(out,"    }\n}\n");
+}
+
+/********************************************/
+/* E X E C U T I O N   B E G I N S   H E R E */
+/********************************************/
+
+int main( int argc, char * argv[] )
+{ char * name;
+  FILE * pgm;
+  if (argc != 2)
+  { printf("usage: %s <filename>\n",argv[0]);
+    exit(1);
+  }
+  name = (char *) malloc(strlen(argv[1]) + 4);
+  if (name == NULL) exit(1);
+  strcpy(name,argv[1]);
+  if (strchr(name,'.') == NULL) strcat(name,".tm");
+  pgm = fopen(name,"r");
+  if (pgm == NULL)
+  { printf("file '%s' not found\n",name);
+    exit(1);
+  }
+  if (! readInstructions(&program,pgm)) exit(1);
+  out = stdout;
+  translate(name);
+  return 0;
+}
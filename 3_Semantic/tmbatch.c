@@ -0,0 +1,237 @@
+/****************************************************/
+/* File: tmbatch.c                                  */
+/* Running batches of TM jobs on several threads,   */
+/* each program read once and shared by its jobs    */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "tm.h"
+#include "tmjit.h"
+
+/* Each line of the job file is a job, a program with
+ * the file its IN instructions read and the file
+ * what it prints goes to:
+ *
+ *   <program.tm> <input> <output>
+ *
+ * Blank lines and lines starting with # are skipped.
+ * A program is read once, however many jobs run it,
+ * and is then only read by the machines, which have
+ * their own registers, dMem and files, so any number
+ * of them run it at once. With --jit it is translated
+ * before the threads start. A job's output is what
+ * 'go' prints in the simulator, or with --fast-io
+ * only the OUT values, its input being only the IN
+ * values, as text or with --binary as 32-bit words.
+ * A line per job, in the order of the job file,
+ * tells how it stopped.
+ */
+
+#define NAMESIZE 256
+
+typedef struct
+   { char name [NAMESIZE];
+     TMPROGRAM * prog;
+   } PROGRAMREC;
+
+typedef struct
+   { TMPROGRAM * prog;
+     char in [NAMESIZE];
+     char out [NAMESIZE];
+     int opened;              /* FALSE if a file could not be */
+     STEPRESULT result;
+     int count;               /* instructions executed */
+   } JOB;
+
+static PROGRAMREC * programs;
+static int nprograms;
+
+static JOB * jobs;
+static int njobs;
+
+static int jitflag = FALSE;
+static int ioflag = FALSE;
+static int binaryflag = FALSE;
+
+/* the next job to run, taken under the lock */
+static int nextJob = 0;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* loadProgram returns the program read from file
+ * name, reading it the first time, or NULL
+ */
+static TMPROGRAM * loadProgram( char * name )
+{ FILE * pgm;
+  int i;
+  for (i = 0; i < nprograms; i++)
+    if (strcmp(programs[i].name,name) == 0) return programs[i].prog;
+  programs = (PROGRAMREC *) realloc(programs,
+                                    (nprograms + 1) * sizeof(PROGRAMREC));
+  if (programs == NULL)
+  { printf("Out of memory for programs\n");
+    exit(1);
+  }
+  strcpy(programs[nprograms].name,name);
+  programs[nprograms].prog = NULL;
+  pgm = fopen(name,"r");
+  if (pgm == NULL) printf("file '%s' not found\n",name);
+  else
+  { TMPROGRAM * p = (TMPROGRAM *) malloc(sizeof(TMPROGRAM));
+    if (p == NULL)
+    { printf("Out of memory for programs\n");
+      exit(1);
+    }
+    if (readInstructions(p,pgm))
+    { if (jitflag) jitPrepare(p);
+      programs[nprograms].prog = p;
+    }
+    else free(p);
+    fclose(pgm);
+  }
+  return programs[nprograms++].prog;
+}
+
+/* readJobs reads the job file f, returning FALSE if
+ * a line is wrong
+ */
+static int readJobs( FILE * f )
+{ char line [3 * NAMESIZE], name [NAMESIZE], extra [2];
+  int lineNo = 0, cap = 0;
+  JOB * j;
+  while (fgets(line,sizeof(line),f) != NULL)
+  { lineNo++;
+    if ((sscanf(line,"%1s",extra) != 1) || (extra[0] == '#')) continue;
+    if (njobs == cap)
+    { cap = cap == 0 ? 16 : 2 * cap;
+      jobs = (JOB *) realloc(jobs,cap * sizeof(JOB));
+      if (jobs == NULL)
+      { printf("Out of memory for jobs\n");
+        exit(1);
+      }
+    }
+    j = &jobs[njobs];
+    if (sscanf(line,"%255s %255s %255s %1s",name,j->in,j->out,extra) != 3)
+    { printf("job file line %d: expected <program> <input> <output>\n",
+             lineNo);
+      return FALSE;
+    }
+    j->prog = loadProgram(name);
+    if (j->prog == NULL) return FALSE;
+    njobs++;
+  }
+  return TRUE;
+}
+
+/* runJob runs job j on a machine of its own */
+static void runJob( JOB * j )
+{ TM * m = (TM *) malloc(sizeof(TM));
+  TMIO * io = NULL;
+  FILE * in, * out;
+  j->opened = FALSE;
+  j->count = 0;
+  if (m == NULL) return;
+  if (ioflag)
+  { io = (TMIO *) malloc(sizeof(TMIO));
+    if (io == NULL)
+    { free(m);
+      return;
+    }
+  }
+  in = fopen(j->in,binaryflag ? "rb" : "r");
+  out = fopen(j->out,binaryflag ? "wb" : "w");
+  if ((in != NULL) && (out != NULL))
+  { j->opened = TRUE;
+    tmInit(m,j->prog,in,out);
+    if (io != NULL)
+    { ioOpen(io,in,out,binaryflag);
+      m->io = io;
+    }
+    if (jitflag) j->result = jitRun(m,&j->count);
+    else
+    { j->result = srOKAY;
+      while (j->result == srOKAY)
+      { j->result = stepTM(m);
+        j->count++;
+      }
+    }
+    if (io != NULL) ioFlush(io);
+    else fprintf(out,"%s\n",stepResultTab[j->result]);
+  }
+  if (in != NULL) fclose(in);
+  if (out != NULL) fclose(out);
+  free(io);
+  free(m);
+}
+
+/* runJobs is the body of a worker thread */
+static void * runJobs( void * arg )
+{ int i;
+  for (;;)
+  { pthread_mutex_lock(&lock);
+    i = nextJob++;
+    pthread_mutex_unlock(&lock);
+    if (i >= njobs) break;
+    runJob(&jobs[i]);
+  }
+  return arg;
+}
+
+/********************************************/
+/* E X E C U T I O N   B E G I N S   H E R E */
+/********************************************/
+
+int main( int argc, char * argv[] )
+{ int arg = 1, nthreads = 1, i, failed = FALSE;
+  pthread_t * threads;
+  int * started;
+  FILE * f;
+  while ((arg < argc - 1) && (argv[arg][0] == '-'))
+  { if (strcmp(argv[arg],"--jit") == 0) jitflag = TRUE;
+    else if (strcmp(argv[arg],"--fast-io") == 0) ioflag = TRUE;
+    else if (strcmp(argv[arg],"--binary") == 0) ioflag = binaryflag = TRUE;
+    else if (strncmp(argv[arg],"--threads=",10) == 0)
+      nthreads = atoi(argv[arg] + 10);
+    else break;
+    arg++;
+  }
+  if ((arg != argc - 1) || (nthreads < 1))
+  { printf("usage: %s [--threads=<n>] [--jit] [--fast-io] [--binary] "
+           "<jobfile>\n",argv[0]);
+    exit(1);
+  }
+  f = fopen(argv[arg],"r");
+  if (f == NULL)
+  { printf("file '%s' not found\n",argv[arg]);
+    exit(1);
+  }
+  if (! readJobs(f)) exit(1);
+  fclose(f);
+  if (nthreads > njobs) nthreads = njobs > 0 ? njobs : 1;
+  threads = (pthread_t *) calloc(nthreads,sizeof(pthread_t));
+  started = (int *) calloc(nthreads,sizeof(int));
+  if ((threads == NULL) || (started == NULL))
+  { printf("Out of memory for threads\n");
+    exit(1);
+  }
+  for (i = 1; i < nthreads; i++)
+    started[i] = (pthread_create(&threads[i],NULL,runJobs,NULL) == 0);
+  /* jobs a thread could not be made for are run here */
+  runJobs(NULL);
+  for (i = 1; i < nthreads; i++)
+    if (started[i]) pthread_join(threads[i],NULL);
+  for (i = 0; i < njobs; i++)
+  { if (! jobs[i].opened)
+    { printf("job %d: cannot open '%s' or '%s'\n",i + 1,jobs[i].in,
+             jobs[i].out);
+      failed = TRUE;
+    }
+    else
+      printf("job %d: %s, %d instructions executed\n",i + 1,
+             stepResultTab[jobs[i].result],jobs[i].count);
+  }
+  return failed;
+}
@@ -0,0 +1,284 @@
+/****************************************************/
+/* File: tmblock.c                                  */
+/* Execution of TM programs by basic blocks decoded */
+/* once and kept in a translation cache             */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tm.h"
+#include "tmblock.h"
+
+/* A block starts at the location it is first entered
+ * at and ends at the first conditional jump, write to
+ * the pc, read of the pc other than as a base, HALT,
+ * IN or OUT. Its instructions are decoded once into
+ * the numbers of their operand registers, and the
+ * blocks that follow it are linked to it the first
+ * time they do, so that a loop goes from block to
+ * block without looking up the pc. While a block
+ * runs reg[PC_REG] holds the location after it, which
+ * is what its last instruction reads; a pc base in
+ * the others is folded into their displacement.
+ *
+ * HALT, IN, OUT and the instructions that fault are
+ * left to stepTM, with reg[PC_REG] at them, so that
+ * they behave exactly as when interpreted. TM code
+ * cannot write iMem, so blocks only go stale when
+ * the simulator itself changes it. The blocks of a
+ * program are kept in it, and made as it runs, so
+ * only one machine at a time may run it this way.
+ *
+ * The traps of the program are decoded in: a block
+ * ends before a breakpoint, and one starting at it
+ * is a single opTRAP, which leaves the block as HALT
+ * does; if addresses are watched, ST is decoded as
+ * opSTW, which leaves it if the page it writes holds
+ * one. trapTM then stops or executes the instruction.
+ */
+
+/* decoded only */
+#define opTRAP opRALim          /* stop at a breakpoint */
+#define opSTW  (opRALim + 1)    /* ST, maybe to a watched address */
+
+typedef struct
+   { int op;
+     int pc;
+     int dst;       /* register written */
+     int a;         /* first operand, or base */
+     int b;         /* second operand */
+     int k;         /* displacement or constant */
+   } DECODED;
+
+typedef struct BlockRec
+   { int start;
+     int n;
+     DECODED * code;
+     int nextPc [2];            /* fall through, jump target */
+     struct BlockRec * next [2];
+   } BLOCK;
+
+static long blocksRun = 0;
+static int blocksMade = 0;
+
+/* endsBlock tells if instruction in ends a block */
+static int endsBlock( INSTRUCTION * in )
+{ switch (in->iop)
+  { case opHALT :
+    case opIN :
+    case opOUT :
+      return TRUE;
+    case opST :
+      return in->iarg1 == PC_REG;
+    default :
+      if (opClass(in->iop) == opclRR)
+        return (in->iarg1 == PC_REG) || (in->iarg2 == PC_REG) ||
+               (in->iarg3 == PC_REG);
+      return (in->iop >= opJLT) || (in->iarg1 == PC_REG);
+  }
+}
+
+/* breakAt tells if a breakpoint of program p is at
+ * location loc
+ */
+static int breakAt( TMPROGRAM * p, int loc )
+{ return (p->traps != NULL) && p->traps->breakAt[loc];
+}
+
+/* makeBlock decodes the block of program p starting
+ * at pc
+ */
+static BLOCK * makeBlock( TMPROGRAM * p, int pc )
+{ BLOCK ** cache = (BLOCK **) p->blocks;
+  INSTRUCTION * iMem = p->iMem;
+  BLOCK * b = (BLOCK *) calloc(1,sizeof(BLOCK));
+  INSTRUCTION * in;
+  DECODED * d;
+  int n = 0, i;
+  if (b == NULL)
+  { printf("Out of memory for blocks\n");
+    exit(1);
+  }
+  if (breakAt(p,pc)) n = 1;
+  else
+  { while ((pc + n < IADDR_SIZE) && ! endsBlock(&iMem[pc + n]) &&
+           ! breakAt(p,pc + n))
+      n++;
+    if ((pc + n < IADDR_SIZE) && ! breakAt(p,pc + n)) n++;
+  }
+  b->code = (DECODED *) calloc(n,sizeof(DECODED));
+  if (b->code == NULL)
+  { printf("Out of memory for blocks\n");
+    exit(1);
+  }
+  b->start = pc;
+  b->n = n;
+  b->nextPc[0] = pc + n;
+  b->nextPc[1] = -1;
+  for (i = 0; i < n; i++)
+  { in = &iMem[pc + i];
+    d = &b->code[i];
+    d->op = in->iop;
+    d->pc = pc + i;
+    d->dst = in->iarg1;
+    if (in->iop < opRRLim)
+    { d->a = in->iarg2;
+      d->b = in->iarg3;
+    }
+    else
+    { d->k = in->iarg2;
+      d->a = in->iarg3;
+      d->b = in->iarg1;
+      if (in->iarg3 == PC_REG)
+      { /* the base reads the location after the block */
+        d->k += pc + i + 1 - b->nextPc[0];
+        if ((in->iop >= opJLT) ||
+            ((in->iop == opLDA) && (in->iarg1 == PC_REG)))
+          b->nextPc[1] = in->iarg2 + pc + i + 1;
+      }
+      else if ((in->iop == opLDC) && (in->iarg1 == PC_REG))
+        b->nextPc[1] = in->iarg2;
+    }
+    if (breakAt(p,pc + i)) d->op = opTRAP;
+    else if ((in->iop == opST) && (p->traps != NULL) &&
+             (p->traps->nwatches > 0))
+      d->op = opSTW;
+  }
+  blocksMade++;
+  return cache[pc] = b;
+}
+
+/* runBlock executes block b on machine m and returns
+ * how many of its instructions it executed; if that
+ * is not all, reg[PC_REG] is at the next one, left to
+ * stepTM
+ */
+static int runBlock( TM * m, BLOCK * b )
+{ DECODED * d = b->code;
+  int * reg = m->reg;
+  int * dMem = m->dMem;
+  int i, a;
+  /* a jump at the end writes over it */
+  reg[PC_REG] = b->nextPc[0];
+  for (i = 0; i < b->n; i++, d++)
+  { switch (d->op)
+    { case opHALT :
+      case opIN :
+      case opOUT :
+      case opTRAP :
+        reg[PC_REG] = d->pc;
+        return i;
+      case opADD : reg[d->dst] = reg[d->a] + reg[d->b]; break;
+      case opSUB : reg[d->dst] = reg[d->a] - reg[d->b]; break;
+      case opMUL : reg[d->dst] = reg[d->a] * reg[d->b]; break;
+      case opDIV :
+        if (reg[d->b] == 0)
+        { reg[PC_REG] = d->pc;
+          return i;
+        }
+        reg[d->dst] = reg[d->a] / reg[d->b];
+        break;
+      case opLD :
+      case opST :
+        a = reg[d->a] + d->k;
+        if ((a < 0) || (a >= DADDR_SIZE))
+        { reg[PC_REG] = d->pc;
+          return i;
+        }
+        if (d->op == opLD) reg[d->dst] = dMem[a];
+        else
+        { dMem[a] = reg[d->b];
+          m->dirty[a >> DPAGE_SHIFT] = 1;
+        }
+        break;
+      case opSTW :
+        a = reg[d->a] + d->k;
+        if ((a < 0) || (a >= DADDR_SIZE) ||
+            m->prog->traps->watchPage[a >> DPAGE_SHIFT])
+        { reg[PC_REG] = d->pc;
+          return i;
+        }
+        dMem[a] = reg[d->b];
+        m->dirty[a >> DPAGE_SHIFT] = 1;
+        break;
+      case opLDA : reg[d->dst] = reg[d->a] + d->k; break;
+      case opLDC : reg[d->dst] = d->k; break;
+      case opJLT : if (reg[d->b] <  0) reg[PC_REG] = reg[d->a] + d->k; break;
+      case opJLE : if (reg[d->b] <= 0) reg[PC_REG] = reg[d->a] + d->k; break;
+      case opJGT : if (reg[d->b] >  0) reg[PC_REG] = reg[d->a] + d->k; break;
+      case opJGE : if (reg[d->b] >= 0) reg[PC_REG] = reg[d->a] + d->k; break;
+      case opJEQ : if (reg[d->b] == 0) reg[PC_REG] = reg[d->a] + d->k; break;
+      case opJNE : if (reg[d->b] != 0) reg[PC_REG] = reg[d->a] + d->k; break;
+    }
+  }
+  return i;
+}
+
+/********************************************/
+STEPRESULT blockRun( TM * m, int * count )
+{ STEPRESULT result = srOKAY;
+  BLOCK ** cache;
+  BLOCK * b = NULL, * last = NULL;
+  int pc, n, i;
+  if (m->prog->blocks == NULL)
+  { m->prog->blocks = calloc(IADDR_SIZE,sizeof(BLOCK *));
+    if (m->prog->blocks == NULL)
+    { printf("Out of memory for blocks\n");
+      exit(1);
+    }
+  }
+  cache = (BLOCK **) m->prog->blocks;
+  while (result == srOKAY)
+  { pc = m->reg[PC_REG];
+    if ((pc >= 0) && (pc < IADDR_SIZE))
+    { /* follow the link from the last block if there is one */
+      b = NULL;
+      if (last != NULL)
+        for (i = 0; i < 2; i++)
+          if (last->nextPc[i] == pc)
+          { if (last->next[i] == NULL)
+              last->next[i] = cache[pc] != NULL ? cache[pc]
+                                                : makeBlock(m->prog,pc);
+            b = last->next[i];
+          }
+      if (b == NULL)
+        b = cache[pc] != NULL ? cache[pc] : makeBlock(m->prog,pc);
+      n = runBlock(m,b);
+      *count += n;
+      blocksRun++;
+      if (n == b->n)
+      { last = b;
+        continue;
+      }
+    }
+    /* the instruction the block stopped at */
+    last = NULL;
+    result = trapTM(m);
+    if (result != srBREAK) (*count)++;
+  }
+  return result;
+} /* blockRun */
+
+/********************************************/
+void blockFlush( TMPROGRAM * p )
+{ BLOCK ** cache = (BLOCK **) p->blocks;
+  int pc;
+  if (cache == NULL) return;
+  for (pc = 0; pc < IADDR_SIZE; pc++)
+    if (cache[pc] != NULL)
+    { free(cache[pc]->code);
+      free(cache[pc]);
+      cache[pc] = NULL;
+    }
+} /* blockFlush */
+
+/********************************************/
+void blockReport( double seconds )
+{ printf("Blocks executed = %ld, decoded = %d",blocksRun,blocksMade);
+  if (seconds > 0) printf(", blocks per second = %.0f",blocksRun / seconds);
+  printf("\n");
+  blocksRun = 0;
+  blocksMade = 0;
+} /* blockReport */
@@ -0,0 +1,32 @@
+/****************************************************/
+/* File: tmblock.h                                  */
+/* Execution of TM programs by basic blocks decoded */
+/* once and kept in a translation cache             */
+/****************************************************/
+
+#ifndef _TMBLOCK_H_
+#define _TMBLOCK_H_
+
+#include "tm.h"
+
+/* Function blockRun executes the program of machine m
+ * from its pc until it halts, faults or stops at a
+ * trap, as repeated calls of trapTM would, adds the
+ * number of instructions executed to *count, and
+ * returns the result of the last one
+ */
+STEPRESULT blockRun( TM * m, int * count );
+
+/* Procedure blockFlush drops every block decoded for
+ * program p; it must be called when its iMem or its
+ * traps change
+ */
+void blockFlush( TMPROGRAM * p );
+
+/* Procedure blockReport prints the number of blocks
+ * executed and decoded since the last call, and the
+ * blocks per second for the given run time
+ */
+void blockReport( double seconds );
+
+#endif
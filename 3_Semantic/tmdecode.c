@@ -0,0 +1,81 @@
+/****************************************************/
+/* File: tmdecode.c                                 */
+/* Printing the binary traces of TM programs that   */
+/* tm --trace writes                                */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tm.h"
+#include "tmtrace.h"
+
+/* Each instruction of the trace is printed as the
+ * simulator's t(race prints it, and with --values
+ * followed by what it wrote. The trace must be of
+ * the program given, read as the simulator reads it.
+ */
+
+#define READ_BLOCK 4096
+
+static TMPROGRAM program;
+
+static unsigned wordAt( unsigned char * b )
+{ return (unsigned) b[0] | ((unsigned) b[1] << 8) |
+         ((unsigned) b[2] << 16) | ((unsigned) b[3] << 24);
+}
+
+/********************************************/
+/* E X E C U T I O N   B E G I N S   H E R E */
+/********************************************/
+
+int main( int argc, char * argv[] )
+{ static unsigned char block [READ_BLOCK * TRACE_RECSIZE];
+  unsigned char header [8], * b;
+  int arg = 1, values = FALSE, n, i, r, addr;
+  unsigned w;
+  FILE * pgm, * f;
+  if ((argc > 1) && (strcmp(argv[1],"--values") == 0))
+  { values = TRUE;
+    arg++;
+  }
+  if (arg != argc - 2)
+  { printf("usage: %s [--values] <program.tm> <trace>\n",argv[0]);
+    exit(1);
+  }
+  pgm = fopen(argv[arg],"r");
+  if (pgm == NULL)
+  { printf("file '%s' not found\n",argv[arg]);
+    exit(1);
+  }
+  if (! readInstructions(&program,pgm)) exit(1);
+  fclose(pgm);
+  f = fopen(argv[arg + 1],"rb");
+  if (f == NULL)
+  { printf("file '%s' not found\n",argv[arg + 1]);
+    exit(1);
+  }
+  if ((fread(header,1,sizeof(header),f) != sizeof(header)) ||
+      (wordAt(header) != TRACE_MAGIC))
+  { printf("'%s' is not a TM trace\n",argv[arg + 1]);
+    exit(1);
+  }
+  if (wordAt(header + 4) != programHash(&program))
+  { printf("'%s' is a trace of another program\n",argv[arg + 1]);
+    exit(1);
+  }
+  while ((n = (int) fread(block,TRACE_RECSIZE,READ_BLOCK,f)) > 0)
+    for (i = 0, b = block; i < n; i++, b += TRACE_RECSIZE)
+    { w = wordAt(b);
+      writeInstruction(&program,TRACE_PC(w));
+      if (! values) continue;
+      r = TRACE_REG(w);
+      addr = (int) wordAt(b + 8);
+      if (r >= 0) printf("         reg[%d] = %d\n",r,(int) wordAt(b + 4));
+      if (addr >= 0)
+        printf("         dMem[%d] = %d\n",addr,(int) wordAt(b + 12));
+    }
+  fclose(f);
+  return 0;
+}
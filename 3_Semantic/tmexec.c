@@ -0,0 +1,196 @@
+/****************************************************/
+/* File: tmexec.c                                   */
+/* The TM ("Tiny Machine") computer: the machines   */
+/* and the execution of instructions                */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "tm.h"
+
+/********************************************/
+void tmInit ( TM * m, TMPROGRAM * p, FILE * in, FILE * out )
+{ m->prog = p ;
+  m->in = in ;
+  m->out = out ;
+  m->line.len = 0 ;
+  m->line.col = 0 ;
+  m->io = NULL ;
+  m->base = NULL ;
+  memset(m->dirty, 1, DPAGES) ;
+  tmReset(m) ;
+} /* tmInit */
+
+/********************************************/
+void tmReset ( TM * m )
+{ int regNo, page, loc, end ;
+  for (regNo = 0 ; regNo < NO_REGS ; regNo++)
+      m->reg[regNo] = 0 ;
+  /* only the pages written since it was cleared
+   * differ from the cleared machine
+   */
+  if ( m->base != NULL ) memset(m->dirty, 1, DPAGES) ;
+  m->base = NULL ;
+  for (page = 0 ; page < DPAGES ; page++)
+    if ( m->dirty[page] )
+    { loc = page << DPAGE_SHIFT ;
+      end = loc + (1 << DPAGE_SHIFT) ;
+      if ( end > DADDR_SIZE ) end = DADDR_SIZE ;
+      memset(&m->dMem[loc], 0, (end - loc) * sizeof(int)) ;
+      m->dirty[page] = 0 ;
+    }
+  m->dMem[0] = DADDR_SIZE - 1 ;
+} /* tmReset */
+
+/********************************************/
+STEPRESULT stepTM ( TM * m )
+{ INSTRUCTION currentinstruction  ;
+  int pc  ;
+  int r,s,t,a  ;
+  int ok ;
+  STEPRESULT result ;
+  int * reg = m->reg ;
+
+  pc = reg[PC_REG] ;
+  if ( (pc < 0) || (pc >= IADDR_SIZE)  )
+      return srIMEM_ERR ;
+  reg[PC_REG] = pc + 1 ;
+  currentinstruction = m->prog->iMem[ pc ] ;
+  switch (opClass(currentinstruction.iop) )
+  { case opclRR :
+    /***********************************/
+      r = currentinstruction.iarg1 ;
+      s = currentinstruction.iarg2 ;
+      t = currentinstruction.iarg3 ;
+      break;
+
+    case opclRM :
+    /***********************************/
+      r = currentinstruction.iarg1 ;
+      s = currentinstruction.iarg3 ;
+      a = currentinstruction.iarg2 + reg[s] ;
+      if ( (a < 0) || (a >= DADDR_SIZE))
+         return srDMEM_ERR ;
+      break;
+
+    case opclRA :
+    /***********************************/
+      r = currentinstruction.iarg1 ;
+      s = currentinstruction.iarg3 ;
+      a = currentinstruction.iarg2 + reg[s] ;
+      break;
+  } /* case */
+
+  switch ( currentinstruction.iop)
+  { /* RR instructions */
+    case opHALT :
+    /***********************************/
+      /* buffered OUT values are all there is */
+      if ( (m->io != NULL) && (m->io->out != NULL) ) ioFlush(m->io) ;
+      else fprintf(m->out,"HALT: %1d,%1d,%1d\n",r,s,t);
+      return srHALT ;
+      /* break; */
+
+    case opIN :
+    /***********************************/
+      if ( (m->io != NULL) && (m->io->in != NULL) )
+      { result = ioRead(m->io, &reg[r]) ;
+        if ( result != srOKAY ) return result ;
+        break;
+      }
+      do
+      { fprintf(m->out,"Enter value for IN instruction: ") ;
+        fflush (m->out);
+        if ( ! readLine(&m->line, m->in) ) return srNOINPUT ;
+        ok = getNum(&m->line);
+        if ( ! ok ) fprintf (m->out,"Illegal value\n");
+        else reg[r] = m->line.num;
+      }
+      while (! ok);
+      break;
+
+    case opOUT :  
+      if ( (m->io != NULL) && (m->io->out != NULL) ) ioWrite(m->io, reg[r]) ;
+      else fprintf (m->out,"OUT instruction prints: %d\n", reg[r] ) ;
+      break;
+    case opADD :  reg[r] = reg[s] + reg[t] ;  break;
+    case opSUB :  reg[r] = reg[s] - reg[t] ;  break;
+    case opMUL :  reg[r] = reg[s] * reg[t] ;  break;
+
+    case opDIV :
+    /***********************************/
+      if ( reg[t] != 0 ) reg[r] = reg[s] / reg[t];
+      else return srZERODIVIDE ;
+      break;
+
+    /*************** RM instructions ********************/
+    case opLD :    reg[r] = m->dMem[a] ;  break;
+    case opST :
+      m->dMem[a] = reg[r] ;
+      m->dirty[a >> DPAGE_SHIFT] = 1 ;
+      break;
+
+    /*************** RA instructions ********************/
+    case opLDA :    reg[r] = a ; break;
+    case opLDC :    reg[r] = currentinstruction.iarg2 ;   break;
+    case opJLT :    if ( reg[r] <  0 ) reg[PC_REG] = a ; break;
+    case opJLE :    if ( reg[r] <=  0 ) reg[PC_REG] = a ; break;
+    case opJGT :    if ( reg[r] >  0 ) reg[PC_REG] = a ; break;
+    case opJGE :    if ( reg[r] >=  0 ) reg[PC_REG] = a ; break;
+    case opJEQ :    if ( reg[r] == 0 ) reg[PC_REG] = a ; break;
+    case opJNE :    if ( reg[r] != 0 ) reg[PC_REG] = a ; break;
+
+    /* end of legal instructions */
+  } /* case */
+  return srOKAY ;
+} /* stepTM */
+
+/********************************************/
+/* trapTM stops at a breakpoint of the program of m
+ * before executing it, and otherwise executes an
+ * instruction as stepTM does, stopping after a write
+ * to a watched address
+ */
+STEPRESULT trapTM ( TM * m )
+{ TMTRAPS * t = m->prog->traps ;
+  INSTRUCTION * in ;
+  STEPRESULT result ;
+  int pc = m->reg[PC_REG] ;
+  if ( (t == NULL) || (pc < 0) || (pc >= IADDR_SIZE) ) return stepTM(m) ;
+  if ( t->breakAt[pc] ) return srBREAK ;
+  result = stepTM(m) ;
+  in = &m->prog->iMem[pc] ;
+  /* ST leaves the registers as they were, and its
+   * address in dMem
+   */
+  if ( (result == srOKAY) && (in->iop == opST) &&
+       t->watchAt[in->iarg2 + m->reg[in->iarg3]] )
+    return srWATCH ;
+  return result ;
+} /* trapTM */
+
+/********************************************/
+/* tmTraps counts the traps t, marks the pages of
+ * the addresses watched, and gives t to program p
+ * if any are set; what the engines made of p must
+ * then be dropped
+ */
+void tmTraps ( TMPROGRAM * p, TMTRAPS * t )
+{ int loc ;
+  t->nbreaks = 0 ;
+  t->nwatches = 0 ;
+  memset(t->watchPage, 0, DPAGES) ;
+  for (loc = 0 ; loc < IADDR_SIZE ; loc++)
+    if ( t->breakAt[loc] ) t->nbreaks++ ;
+  for (loc = 0 ; loc < DADDR_SIZE ; loc++)
+    if ( t->watchAt[loc] )
+    { t->nwatches++ ;
+      t->watchPage[loc >> DPAGE_SHIFT] = 1 ;
+    }
+  p->traps = (t->nbreaks > 0) || (t->nwatches > 0) ? t : NULL ;
+} /* tmTraps */
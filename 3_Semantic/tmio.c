@@ -0,0 +1,129 @@
+/****************************************************/
+/* File: tmio.c                                     */
+/* Buffered IN and OUT of TM machines, as text or   */
+/* as binary streams of 32-bit words                */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tm.h"
+
+/* IN values are read IOBUFSIZE bytes at a time and
+ * scanned in the buffer; as text they are decimal
+ * numbers with an optional sign, between any white
+ * space. OUT values are kept in a buffer written out
+ * when it is full, when the machine halts and when
+ * the simulator stops running it.
+ */
+
+/* the room an OUT value may take in the buffer */
+#define VALUESIZE 12
+
+/* nextByte returns the next byte of the input, or
+ * EOF, refilling the buffer when it is used up
+ */
+static int nextByte( TMIO * io )
+{ if (io->inPos == io->inLen)
+  { io->inLen = (int) fread(io->inBuf,1,IOBUFSIZE,io->in);
+    io->inPos = 0;
+    if (io->inLen <= 0)
+    { io->inLen = 0;
+      return EOF;
+    }
+  }
+  return io->inBuf[io->inPos++];
+}
+
+static int isBlank( int c )
+{ return (c == ' ') || (c == '\n') || (c == '\t') || (c == '\r') ||
+         (c == '\f') || (c == '\v');
+}
+
+/********************************************/
+void ioOpen( TMIO * io, FILE * in, FILE * out, int binary )
+{ io->in = in;
+  io->out = out;
+  io->binary = binary;
+  io->inLen = 0;
+  io->inPos = 0;
+  io->outLen = 0;
+} /* ioOpen */
+
+/********************************************/
+STEPRESULT ioRead( TMIO * io, int * value )
+{ unsigned v = 0;
+  int c, i, negative = FALSE;
+  if (io->binary)
+  { for (i = 0; i < 4; i++)
+    { c = nextByte(io);
+      if (c == EOF) return srNOINPUT;
+      v |= (unsigned) c << (8 * i);
+    }
+    *value = (int) v;
+    return srOKAY;
+  }
+  do c = nextByte(io);
+  while (isBlank(c));
+  if (c == EOF) return srNOINPUT;
+  if ((c == '-') || (c == '+'))
+  { negative = c == '-';
+    c = nextByte(io);
+  }
+  if ((c < '0') || (c > '9')) return srBADINPUT;
+  do
+  { v = v * 10 + (c - '0');
+    c = nextByte(io);
+  } while ((c >= '0') && (c <= '9'));
+  if ((c != EOF) && ! isBlank(c)) return srBADINPUT;
+  *value = (int) (negative ? 0u - v : v);
+  return srOKAY;
+} /* ioRead */
+
+/********************************************/
+void ioWrite( TMIO * io, int value )
+{ char digits [VALUESIZE];
+  unsigned v = (unsigned) value;
+  int n = 0;
+  if (io->outLen > IOBUFSIZE - VALUESIZE) ioFlush(io);
+  if (io->binary)
+  { io->outBuf[io->outLen++] = (char) (v & 0xff);
+    io->outBuf[io->outLen++] = (char) ((v >> 8) & 0xff);
+    io->outBuf[io->outLen++] = (char) ((v >> 16) & 0xff);
+    io->outBuf[io->outLen++] = (char) ((v >> 24) & 0xff);
+    return;
+  }
+  if (value < 0)
+  { io->outBuf[io->outLen++] = '-';
+    v = 0u - v;
+  }
+  do
+  { digits[n++] = (char) ('0' + v % 10);
+    v /= 10;
+  } while (v != 0);
+  while (n > 0) io->outBuf[io->outLen++] = digits[--n];
+  io->outBuf[io->outLen++] = '\n';
+} /* ioWrite */
+
+/********************************************/
+void ioFlush( TMIO * io )
+{ if ((io->out == NULL) || (io->outLen == 0)) return;
+  fwrite(io->outBuf,1,io->outLen,io->out);
+  fflush(io->out);
+  io->outLen = 0;
+} /* ioFlush */
+
+/********************************************/
+long ioTell( TMIO * io )
+{ long pos = ftell(io->in);
+  return pos < 0 ? pos : pos - (io->inLen - io->inPos);
+} /* ioTell */
+
+/********************************************/
+void ioSeek( TMIO * io, long pos )
+{ if (fseek(io->in,pos,SEEK_SET) == 0)
+  { io->inLen = 0;
+    io->inPos = 0;
+  }
+} /* ioSeek */
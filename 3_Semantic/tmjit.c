@@ -0,0 +1,522 @@
+/****************************************************/
+/* File: tmjit.c                                    */
+/* Translation of TM programs to native x86-64 code */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "tm.h"
+#include "tmjit.h"
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#include <sys/mman.h>
+#define JIT_NATIVE 1
+#else
+#define JIT_NATIVE 0
+#endif
+
+/* Each TM instruction becomes a few x86-64 ones, in
+ * the same order, so that falling through the code
+ * of one goes to the next. TM registers 0 to 6 stay
+ * in r8d to r14d, r15 points to dMem, rbx counts the
+ * instructions executed, rsi points to the table of
+ * the native code of each location, and rdi to reg,
+ * in the machine, so that ST marks its page of dMem
+ * written at a constant distance from it.
+ * The pc is known at each instruction: reading it
+ * gives a constant, and writing it a jump, straight
+ * to the native code when the target is a constant,
+ * through the table otherwise.
+ *
+ * HALT, IN and OUT, accesses outside dMem, division
+ * by 0 and jumps outside iMem leave the native code
+ * with reg[PC_REG] at the instruction, which stepTM
+ * then executes, so that they behave exactly as when
+ * interpreted.
+ *
+ * The traps of the program are translated in: a
+ * breakpoint leaves the native code as HALT does,
+ * and if addresses are watched ST first looks up
+ * the page it writes, leaving at a watched one.
+ * trapTM then stops or executes the instruction, so
+ * without traps the code is as fast as ever.
+ */
+
+#if JIT_NATIVE
+
+/* host registers */
+#define HAX  0
+#define HCX  1
+#define HDX  2
+#define HBX  3
+#define HSI  6
+#define HDI  7
+#define HR15 15
+
+/* the host register of TM register r, but the pc */
+#define TMREG(r) (8 + (r))
+
+/* condition codes of jcc */
+#define CC_E   0x4
+#define CC_NE  0x5
+#define CC_AE  0x3
+#define CC_L   0xC
+#define CC_GE  0xD
+#define CC_LE  0xE
+#define CC_G   0xF
+
+/* room for the native code of one instruction,
+ * with its exit, and for the entry and exit code
+ */
+#define INSTR_ROOM 112
+#define CODE_SIZE (INSTR_ROOM * (IADDR_SIZE + 1) + 256)
+
+/* a jump to the native code of location pc, or to
+ * its exit if slow is TRUE, whose 32-bit offset is
+ * at code[at]
+ */
+typedef struct
+   { int at;
+     int pc;
+     int slow;
+   } FIXUP;
+
+typedef long (* JITENTRY)( int * regs, void ** table, int * data,
+                           void * start );
+
+/* the native code of a program, kept in its jit */
+typedef struct
+   { JITENTRY entry;          /* NULL if it could not be made */
+     void * table [IADDR_SIZE];
+   } JITCODE;
+
+/* the program being translated and its code; as
+ * they are kept here, one program is translated at
+ * a time
+ */
+static INSTRUCTION * iMem;
+static TMTRAPS * traps;
+static unsigned char * code;
+static int codeLen;
+static int exitAt;
+static int nativeAt [IADDR_SIZE];
+static int slowAt [IADDR_SIZE];
+static FIXUP * fixups;
+static int nfixups;
+
+/********************************************/
+static void emitByte( int b )
+{ code[codeLen++] = (unsigned char) b;
+}
+
+static void emitInt( int n )
+{ emitByte(n & 0xff);
+  emitByte((n >> 8) & 0xff);
+  emitByte((n >> 16) & 0xff);
+  emitByte((n >> 24) & 0xff);
+}
+
+/* emitRex emits the REX prefix for the reg, index
+ * and r/m host registers r, x and b, if one is needed
+ */
+static void emitRex( int w, int r, int x, int b )
+{ int rex = 0x40 | (w << 3) | ((r >> 3) << 2) | ((x >> 3) << 1) | (b >> 3);
+  if (rex != 0x40) emitByte(rex);
+}
+
+static void emitModRM( int mod, int r, int m )
+{ emitByte((mod << 6) | ((r & 7) << 3) | (m & 7));
+}
+
+/* emitRR emits the 32-bit instruction op r/m,reg */
+static void emitRR( int op, int r, int m )
+{ emitRex(0,r,0,m);
+  emitByte(op);
+  emitModRM(3,r,m);
+}
+
+/* emitMovImm emits mov h,imm */
+static void emitMovImm( int h, int imm )
+{ emitRex(0,0,0,h);
+  emitByte(0xB8 + (h & 7));
+  emitInt(imm);
+}
+
+/* emitAddImm emits add eax,imm */
+static void emitAddImm( int imm )
+{ if (imm != 0)
+  { emitByte(0x05);
+    emitInt(imm);
+  }
+}
+
+/* emitCmpImm emits cmp eax,imm */
+static void emitCmpImm( int imm )
+{ emitByte(0x3D);
+  emitInt(imm);
+}
+
+/* emitCount counts an instruction executed */
+static void emitCount( void )
+{ emitByte(0x48); emitByte(0xFF); emitByte(0xC3); /* inc rbx */
+}
+
+/* emitJumpTo emits jmp (cc < 0) or jcc to offset at
+ * of the code
+ */
+static void emitJumpTo( int cc, int at )
+{ if (cc < 0) emitByte(0xE9);
+  else { emitByte(0x0F); emitByte(0x80 + cc); }
+  emitInt(at - (codeLen + 4));
+}
+
+/* emitJump emits jmp (cc < 0) or jcc to the native
+ * code of location pc, or to its exit if slow is TRUE
+ */
+static void emitJump( int cc, int pc, int slow )
+{ if (cc < 0) emitByte(0xE9);
+  else { emitByte(0x0F); emitByte(0x80 + cc); }
+  fixups[nfixups].at = codeLen;
+  fixups[nfixups].pc = pc;
+  fixups[nfixups].slow = slow;
+  nfixups++;
+  emitInt(0);
+}
+
+/* emitGet puts TM register s, as the instruction at
+ * pc sees it, into host register h
+ */
+static void emitGet( int h, int s, int pc )
+{ if (s == PC_REG) emitMovImm(h,pc + 1);
+  else emitRR(0x89,TMREG(s),h);
+}
+
+/* emitGotoAx emits a jump to the TM location in eax */
+static void emitGotoAx( void )
+{ emitCmpImm(IADDR_SIZE);
+  emitJumpTo(CC_AE,exitAt);
+  emitByte(0xFF); emitByte(0x24); emitByte(0xC6); /* jmp [rsi+rax*8] */
+}
+
+/* emitGoto emits a jump to TM location target */
+static void emitGoto( int target )
+{ if ((target >= 0) && (target < IADDR_SIZE)) emitJump(-1,target,FALSE);
+  else
+  { emitMovImm(HAX,target);
+    emitJumpTo(-1,exitAt);
+  }
+}
+
+/* emitSet puts eax into TM register r; writing the
+ * pc is a jump
+ */
+static void emitSet( int r )
+{ if (r == PC_REG) emitGotoAx();
+  else emitRR(0x89,HAX,TMREG(r));
+}
+
+/* emitAddress puts the dMem address d+reg(s) of the
+ * instruction at pc into eax, going to its exit if
+ * it is out of dMem
+ */
+static void emitAddress( int d, int s, int pc )
+{ emitGet(HAX,s,pc);
+  emitAddImm(d);
+  emitCmpImm(DADDR_SIZE);
+  emitJump(CC_AE,pc,TRUE);
+}
+
+/* taken tells if a conditional jump op is taken for
+ * the value v
+ */
+static int taken( int op, int v )
+{ switch (op)
+  { case opJLT : return v < 0;
+    case opJLE : return v <= 0;
+    case opJGT : return v > 0;
+    case opJGE : return v >= 0;
+    case opJEQ : return v == 0;
+    default :    return v != 0;
+  }
+}
+
+/* jumpCC returns the condition code of conditional
+ * jump op on a register tested against itself
+ */
+static int jumpCC( int op )
+{ switch (op)
+  { case opJLT : return CC_L;
+    case opJLE : return CC_LE;
+    case opJGT : return CC_G;
+    case opJGE : return CC_GE;
+    case opJEQ : return CC_E;
+    default :    return CC_NE;
+  }
+}
+
+/* translateJump translates the conditional jump at pc */
+static void translateJump( int pc )
+{ INSTRUCTION * in = &iMem[pc];
+  int r = in->iarg1, d = in->iarg2, s = in->iarg3;
+  int target = d + pc + 1, over;
+  emitCount();
+  if (r == PC_REG)
+  { /* the test is on a constant */
+    if (taken(in->iop,pc + 1))
+    { if (s == PC_REG) emitGoto(target);
+      else { emitGet(HAX,s,pc); emitAddImm(d); emitGotoAx(); }
+    }
+    return;
+  }
+  emitRR(0x85,TMREG(r),TMREG(r)); /* test r,r */
+  if ((s == PC_REG) && (target >= 0) && (target < IADDR_SIZE))
+    emitJump(jumpCC(in->iop),target,FALSE);
+  else
+  { /* skip the jump on the opposite condition */
+    emitByte(0x70 + (jumpCC(in->iop) ^ 1));
+    over = codeLen;
+    emitByte(0);
+    if (s == PC_REG) emitGoto(target);
+    else { emitGet(HAX,s,pc); emitAddImm(d); emitGotoAx(); }
+    code[over] = (unsigned char) (codeLen - over - 1);
+  }
+}
+
+/* translateInstruction translates the instruction at pc */
+static void translateInstruction( int pc )
+{ INSTRUCTION * in = &iMem[pc];
+  int r = in->iarg1, s = in->iarg2, t = in->iarg3, d = in->iarg2;
+  long page;
+  if ((traps != NULL) && traps->breakAt[pc])
+  { emitMovImm(HAX,pc);
+    emitJumpTo(-1,exitAt);
+    return;
+  }
+  switch (in->iop)
+  { case opHALT :
+    case opIN :
+    case opOUT :
+      emitMovImm(HAX,pc);
+      emitJumpTo(-1,exitAt);
+      break;
+
+    case opADD :
+    case opSUB :
+    case opMUL :
+      emitGet(HAX,s,pc);
+      emitGet(HCX,t,pc);
+      if (in->iop == opADD) emitRR(0x01,HCX,HAX);
+      else if (in->iop == opSUB) emitRR(0x29,HCX,HAX);
+      else { emitByte(0x0F); emitByte(0xAF); emitModRM(3,HAX,HCX); }
+      emitCount();
+      emitSet(r);
+      break;
+
+    case opDIV :
+      emitGet(HAX,s,pc);
+      emitGet(HCX,t,pc);
+      emitRR(0x85,HCX,HCX);           /* test ecx,ecx */
+      emitJump(CC_E,pc,TRUE);
+      /* x/-1 is -x, which idiv would fault on for INT_MIN */
+      emitByte(0x83); emitByte(0xF9); emitByte(0xFF); /* cmp ecx,-1 */
+      emitByte(0x75); emitByte(0x04);                 /* jne div */
+      emitByte(0xF7); emitByte(0xD8);                 /* neg eax */
+      emitByte(0xEB); emitByte(0x03);                 /* jmp done */
+      emitByte(0x99);                                 /* div: cdq */
+      emitByte(0xF7); emitByte(0xF9);                 /* idiv ecx */
+      emitCount();                                    /* done: */
+      emitSet(r);
+      break;
+
+    case opLD :
+      emitAddress(d,t,pc);
+      /* mov eax,[r15+rax*4] */
+      emitByte(0x41); emitByte(0x8B); emitByte(0x04); emitByte(0x87);
+      emitCount();
+      emitSet(r);
+      break;
+
+    case opST :
+      emitAddress(d,t,pc);
+      if ((traps != NULL) && (traps->nwatches > 0))
+      { page = (long) traps->watchPage;
+        emitRR(0x89,HAX,HDX);                        /* mov edx,eax */
+        emitByte(0xC1); emitByte(0xEA); emitByte(DPAGE_SHIFT); /* shr edx,k */
+        emitByte(0x48); emitByte(0xB9);              /* mov rcx,watchPage */
+        emitInt((int) page); emitInt((int) (page >> 32));
+        /* cmp byte [rcx+rdx],0 */
+        emitByte(0x80); emitByte(0x3C); emitByte(0x11); emitByte(0);
+        emitJump(CC_NE,pc,TRUE);
+      }
+      emitGet(HCX,r,pc);
+      /* mov [r15+rax*4],ecx */
+      emitByte(0x41); emitByte(0x89); emitByte(0x0C); emitByte(0x87);
+      emitByte(0xC1); emitByte(0xE8); emitByte(DPAGE_SHIFT); /* shr eax,k */
+      /* mov byte [rdi+rax+dirty],1 */
+      emitByte(0xC6); emitByte(0x84); emitByte(0x07);
+      emitInt(offsetof(TM,dirty) - offsetof(TM,reg));
+      emitByte(1);
+      emitCount();
+      break;
+
+    case opLDA :
+      emitCount();
+      if (t == PC_REG)
+      { if (r == PC_REG) emitGoto(d + pc + 1);
+        else emitMovImm(TMREG(r),d + pc + 1);
+      }
+      else
+      { emitGet(HAX,t,pc);
+        emitAddImm(d);
+        emitSet(r);
+      }
+      break;
+
+    case opLDC :
+      emitCount();
+      if (r == PC_REG) emitGoto(d);
+      else emitMovImm(TMREG(r),d);
+      break;
+
+    default :
+      translateJump(pc);
+      break;
+  }
+}
+
+/* emitProgram emits the native code of iMem into
+ * code, with the entry and exit code
+ */
+static void emitProgram( void )
+{ int pc, i, n;
+  nfixups = 0;
+  codeLen = 0;
+  /* entry: save the registers the C caller keeps */
+  emitByte(0x53);                              /* push rbx */
+  emitByte(0x41); emitByte(0x54);              /* push r12 */
+  emitByte(0x41); emitByte(0x55);              /* push r13 */
+  emitByte(0x41); emitByte(0x56);              /* push r14 */
+  emitByte(0x41); emitByte(0x57);              /* push r15 */
+  emitByte(0x49); emitByte(0x89); emitByte(0xD7); /* mov r15,rdx */
+  emitByte(0x31); emitByte(0xDB);              /* xor ebx,ebx */
+  for (i = 0; i < PC_REG; i++)
+  { emitRex(0,TMREG(i),0,HDI);                 /* mov r,[rdi+4i] */
+    emitByte(0x8B); emitModRM(1,TMREG(i),HDI); emitByte(4 * i);
+  }
+  emitByte(0xFF); emitByte(0xE1);              /* jmp rcx */
+  /* exit: eax is the new pc */
+  exitAt = codeLen;
+  for (i = 0; i < PC_REG; i++)
+  { emitRex(0,TMREG(i),0,HDI);                 /* mov [rdi+4i],r */
+    emitByte(0x89); emitModRM(1,TMREG(i),HDI); emitByte(4 * i);
+  }
+  emitByte(0x89); emitModRM(1,HAX,HDI); emitByte(4 * PC_REG);
+  emitByte(0x48); emitByte(0x89); emitByte(0xD8); /* mov rax,rbx */
+  emitByte(0x41); emitByte(0x5F);              /* pop r15 */
+  emitByte(0x41); emitByte(0x5E);              /* pop r14 */
+  emitByte(0x41); emitByte(0x5D);              /* pop r13 */
+  emitByte(0x41); emitByte(0x5C);              /* pop r12 */
+  emitByte(0x5B);                              /* pop rbx */
+  emitByte(0xC3);                              /* ret */
+  for (pc = 0; pc < IADDR_SIZE; pc++)
+  { nativeAt[pc] = codeLen;
+    translateInstruction(pc);
+  }
+  /* falling off the end of iMem */
+  emitMovImm(HAX,IADDR_SIZE);
+  emitJumpTo(-1,exitAt);
+  for (pc = 0; pc < IADDR_SIZE; pc++)
+  { slowAt[pc] = codeLen;
+    emitMovImm(HAX,pc);
+    emitJumpTo(-1,exitAt);
+  }
+  for (i = 0; i < nfixups; i++)
+  { n = fixups[i].slow ? slowAt[fixups[i].pc] : nativeAt[fixups[i].pc];
+    n -= fixups[i].at + 4;
+    codeLen = fixups[i].at;
+    emitInt(n);
+  }
+}
+
+/* translate translates iMem to native code, into
+ * jc if it can; the code is unmapped if it cannot
+ * be made or made executable
+ */
+static void translate( JITCODE * jc )
+{ int pc, ok;
+  code = (unsigned char *) mmap(NULL,CODE_SIZE,PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+  if (code == (unsigned char *) MAP_FAILED) return;
+  fixups = (FIXUP *) malloc(3 * IADDR_SIZE * sizeof(FIXUP));
+  ok = fixups != NULL;
+  if (ok)
+  { emitProgram();
+    free(fixups);
+    fixups = NULL;
+    ok = mprotect(code,CODE_SIZE,PROT_READ | PROT_EXEC) == 0;
+  }
+  if (! ok)
+  { munmap(code,CODE_SIZE);
+    return;
+  }
+  for (pc = 0; pc < IADDR_SIZE; pc++) jc->table[pc] = code + nativeAt[pc];
+  jc->entry = (JITENTRY) (void *) code;
+}
+
+#endif
+
+/********************************************/
+void jitPrepare( TMPROGRAM * p )
+{
+#if JIT_NATIVE
+  JITCODE * jc;
+  if (p->jit != NULL) return;
+  jc = (JITCODE *) calloc(1,sizeof(JITCODE));
+  if (jc == NULL) return;
+  iMem = p->iMem;
+  traps = p->traps;
+  translate(jc);
+  if (jc->entry == NULL)
+    printf("JIT: no executable memory, interpreting\n");
+  p->jit = jc;
+#endif
+} /* jitPrepare */
+
+/********************************************/
+STEPRESULT jitRun( TM * m, int * count )
+{ STEPRESULT result = srOKAY;
+#if JIT_NATIVE
+  JITCODE * jc;
+  int pc;
+  jitPrepare(m->prog);
+  jc = (JITCODE *) m->prog->jit;
+#endif
+  while (result == srOKAY)
+  {
+#if JIT_NATIVE
+    pc = m->reg[PC_REG];
+    if ((jc != NULL) && (jc->entry != NULL) && (pc >= 0) &&
+        (pc < IADDR_SIZE))
+      *count += (int) jc->entry(m->reg,jc->table,m->dMem,jc->table[pc]);
+#endif
+    /* the instruction the native code stopped at */
+    result = trapTM(m);
+    if (result != srBREAK) (*count)++;
+  }
+  return result;
+} /* jitRun */
+
+/********************************************/
+void jitFlush( TMPROGRAM * p )
+{
+#if JIT_NATIVE
+  JITCODE * jc = (JITCODE *) p->jit;
+  if (jc == NULL) return;
+  if (jc->entry != NULL) munmap((void *) jc->entry,CODE_SIZE);
+  free(jc);
+  p->jit = NULL;
+#endif
+} /* jitFlush */
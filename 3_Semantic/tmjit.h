@@ -0,0 +1,36 @@
+/****************************************************/
+/* File: tmjit.h                                    */
+/* Translation of TM programs to native x86-64 code */
+/****************************************************/
+
+#ifndef _TMJIT_H_
+#define _TMJIT_H_
+
+#include "tm.h"
+
+/* Procedure jitPrepare translates program p to
+ * native code, if it has not been yet. It is not
+ * reentrant, as translations share the state of
+ * this module: every program that machines on
+ * several threads run must be prepared on one thread
+ * before they start
+ */
+void jitPrepare( TMPROGRAM * p );
+
+/* Function jitRun executes the program of machine m
+ * from its pc until it halts, faults or stops at a
+ * trap, as repeated calls of trapTM would, adds the
+ * number of instructions executed to *count, and
+ * returns the result of the last one. The program is translated
+ * to native code the first time; where that is not
+ * possible every instruction is interpreted
+ */
+STEPRESULT jitRun( TM * m, int * count );
+
+/* Procedure jitFlush drops the native code of
+ * program p; it must be called when its iMem or its
+ * traps change
+ */
+void jitFlush( TMPROGRAM * p );
+
+#endif
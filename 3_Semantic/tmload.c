@@ -0,0 +1,253 @@
+/****************************************************/
+/* File: tmload.c                                   */
+/* The TM ("Tiny Machine") computer: the reading of */
+/* programs and of the lines given to it            */
+/* Compiler Construction: Principles and Practice   */
+/* Kenneth C. Louden                                */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "tm.h"
+
+/******** vars ********/
+char * opCodeTab[]
+        = {"HALT","IN","OUT","ADD","SUB","MUL","DIV","????",
+            /* RR opcodes */
+           "LD","ST","????", /* RM opcodes */
+           "LDA","LDC","JLT","JLE","JGT","JGE","JEQ","JNE","????"
+           /* RA opcodes */
+          };
+
+char * stepResultTab[]
+        = {"OK","Halted","Instruction Memory Fault",
+           "Data Memory Fault","Division by 0","End of input",
+           "Illegal value in input","Breakpoint","Watched write"
+          };
+
+/********************************************/
+int opClass( int c )
+{ if      ( c <= opRRLim) return ( opclRR );
+  else if ( c <= opRMLim) return ( opclRM );
+  else                    return ( opclRA );
+} /* opClass */
+
+/********************************************/
+int readLine ( TMLINE * l, FILE * f )
+{ if (fgets( l->text, LINESIZE, f ) == NULL)
+  { l->len = 0 ;
+    l->col = 0 ;
+    return FALSE ;
+  }
+  l->len = strlen(l->text) ;
+  if ((l->len > 0) && (l->text[l->len-1] == '\n'))
+    l->text[--l->len] = '\0' ;
+  l->col = 0 ;
+  return TRUE ;
+} /* readLine */
+
+/********************************************/
+void getCh ( TMLINE * l )
+{ if (++l->col < l->len)
+  l->ch = l->text[l->col] ;
+  else l->ch = ' ' ;
+} /* getCh */
+
+/********************************************/
+int nonBlank ( TMLINE * l )
+{ while ((l->col < l->len)
+         && (l->text[l->col] == ' ') )
+    l->col++ ;
+  if (l->col < l->len)
+  { l->ch = l->text[l->col] ;
+    return TRUE ; }
+  else
+  { l->ch = ' ' ;
+    return FALSE ; }
+} /* nonBlank */
+
+/********************************************/
+int getNum ( TMLINE * l )
+{ int sign;
+  int term;
+  int temp = FALSE;
+  l->num = 0 ;
+  do
+  { sign = 1;
+    while ( nonBlank(l) && ((l->ch == '+') || (l->ch == '-')) )
+    { temp = FALSE ;
+      if (l->ch == '-')  sign = - sign ;
+      getCh(l);
+    }
+    term = 0 ;
+    nonBlank(l);
+    while (isdigit(l->ch))
+    { temp = TRUE ;
+      term = term * 10 + ( l->ch - '0' ) ;
+      getCh(l);
+    }
+    l->num = l->num + (term * sign) ;
+  } while ( (nonBlank(l)) && ((l->ch == '+') || (l->ch == '-')) ) ;
+  return temp;
+} /* getNum */
+
+/********************************************/
+int getWord ( TMLINE * l )
+{ int temp = FALSE;
+  int length = 0;
+  if (nonBlank(l))
+  { while (isalnum(l->ch))
+    { if (length < WORDSIZE-1) l->word [length++] =  l->ch ;
+      getCh(l) ;
+    }
+    l->word[length] = '\0';
+    temp = (length != 0);
+  }
+  return temp;
+} /* getWord */
+
+/********************************************/
+int skipCh ( TMLINE * l, char c )
+{ int temp = FALSE;
+  if ( nonBlank(l) && (l->ch == c) )
+  { getCh(l);
+    temp = TRUE;
+  }
+  return temp;
+} /* skipCh */
+
+/********************************************/
+int atEOL ( TMLINE * l )
+{ return ( ! nonBlank(l));
+} /* atEOL */
+
+/********************************************/
+void writeInstruction ( TMPROGRAM * p, int loc )
+{ INSTRUCTION * in ;
+  printf( "%5d: ", loc) ;
+  if ( (loc >= 0) && (loc < IADDR_SIZE) )
+  { in = &p->iMem[loc] ;
+    printf("%6s%3d,", opCodeTab[in->iop], in->iarg1);
+    switch ( opClass(in->iop) )
+    { case opclRR: printf("%1d,%1d", in->iarg2, in->iarg3);
+                   break;
+      case opclRM:
+      case opclRA: printf("%3d(%1d)", in->iarg2, in->iarg3);
+                   break;
+    }
+    printf ("\n") ;
+  }
+} /* writeInstruction */
+
+/********************************************/
+unsigned programHash ( TMPROGRAM * p )
+{ unsigned h = 2166136261u ;
+  int loc, i, w[4] ;
+  for (loc = 0 ; loc < IADDR_SIZE ; loc++)
+  { w[0] = p->iMem[loc].iop ;
+    w[1] = p->iMem[loc].iarg1 ;
+    w[2] = p->iMem[loc].iarg2 ;
+    w[3] = p->iMem[loc].iarg3 ;
+    /* FNV-1a over the bytes of the words */
+    for (i = 0 ; i < 16 ; i++)
+      h = (h ^ ((unsigned) w[i / 4] >> (8 * (i % 4)) & 0xff)) * 16777619u ;
+  }
+  return h ;
+} /* programHash */
+
+/********************************************/
+int error( char * msg, int lineNo, int instNo)
+{ printf("Line %d",lineNo);
+  if (instNo >= 0) printf(" (Instruction %d)",instNo);
+  printf("   %s\n",msg);
+  return FALSE;
+} /* error */
+
+/********************************************/
+int readInstructions ( TMPROGRAM * p, FILE * pgm )
+{ OPCODE op;
+  int arg1, arg2, arg3;
+  int loc, lineNo;
+  TMLINE line;
+  TMLINE * l = &line;
+  p->jit = NULL;
+  p->blocks = NULL;
+  p->traps = NULL;
+  for (loc = 0 ; loc < IADDR_SIZE ; loc++)
+  { p->iMem[loc].iop = opHALT ;
+    p->iMem[loc].iarg1 = 0 ;
+    p->iMem[loc].iarg2 = 0 ;
+    p->iMem[loc].iarg3 = 0 ;
+  }
+  lineNo = 0 ;
+  while (! feof(pgm))
+  { fgets( l->text, LINESIZE-2, pgm  ) ;
+    l->col = 0 ; 
+    lineNo++;
+    l->len = strlen(l->text)-1 ;
+    if (l->text[l->len]=='\n') l->text[l->len] = '\0' ;
+    else l->text[++l->len] = '\0';
+    if ( (nonBlank(l)) && (l->text[l->col] != '*') )
+    { if (! getNum(l))
+        return error("Bad location", lineNo,-1);
+      loc = l->num;
+      if ((loc < 0) || (loc >= IADDR_SIZE))
+        return error("Location too large",lineNo,loc);
+      if (! skipCh(l,':'))
+        return error("Missing colon", lineNo,loc);
+      if (! getWord(l))
+        return error("Missing opcode", lineNo,loc);
+      op = opHALT ;
+      while ((op < opRALim)
+             && (strncmp(opCodeTab[op], l->word, 4) != 0) )
+          op++ ;
+      if (strncmp(opCodeTab[op], l->word, 4) != 0)
+          return error("Illegal opcode", lineNo,loc);
+      switch ( opClass(op) )
+      { case opclRR :
+        /***********************************/
+        if ( (! getNum(l)) || (l->num < 0) || (l->num >= NO_REGS) )
+            return error("Bad first register", lineNo,loc);
+        arg1 = l->num;
+        if ( ! skipCh(l,','))
+            return error("Missing comma", lineNo, loc);
+        if ( (! getNum(l)) || (l->num < 0) || (l->num >= NO_REGS) )
+            return error("Bad second register", lineNo, loc);
+        arg2 = l->num;
+        if ( ! skipCh(l,',')) 
+            return error("Missing comma", lineNo,loc);
+        if ( (! getNum(l)) || (l->num < 0) || (l->num >= NO_REGS) )
+            return error("Bad third register", lineNo,loc);
+        arg3 = l->num;
+        break;
+
+        case opclRM :
+        case opclRA :
+        /***********************************/
+        if ( (! getNum(l)) || (l->num < 0) || (l->num >= NO_REGS) )
+            return error("Bad first register", lineNo,loc);
+        arg1 = l->num;
+        if ( ! skipCh(l,','))
+            return error("Missing comma", lineNo,loc);
+        if (! getNum(l))
+            return error("Bad displacement", lineNo,loc);
+        arg2 = l->num;
+        if ( ! skipCh(l,'(') && ! skipCh(l,',') )
+            return error("Missing LParen", lineNo,loc);
+        if ( (! getNum(l)) || (l->num < 0) || (l->num >= NO_REGS))
+            return error("Bad second register", lineNo,loc);
+        arg3 = l->num;
+        break;
+        }
+      p->iMem[loc].iop = op;
+      p->iMem[loc].iarg1 = arg1;
+      p->iMem[loc].iarg2 = arg2;
+      p->iMem[loc].iarg3 = arg3;
+    }
+  }
+  return TRUE;
+} /* readInstructions */
+
@@ -0,0 +1,309 @@
+/****************************************************/
+/* File: tmremote.c                                 */
+/* Debugging TM programs from other programs, by a  */
+/* line-oriented protocol                           */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "tm.h"
+#include "tmjit.h"
+#include "tmblock.h"
+#include "tmremote.h"
+
+/* Each request is a line, a letter then numbers, and
+ * gets a line in reply: "ok" and the values asked
+ * for, "error" and what is wrong, or for the requests
+ * that execute instructions "stop", why, the pc, and
+ * after a watched write its address and value.
+ *
+ *   r                     ok reg[0] ... reg[7]
+ *   R <r> <v>             reg[r] = v; r 7 is the pc
+ *   m <a> [<n>]           ok dMem[a] ... dMem[a+n-1]
+ *   M <a> <v> ...         dMem[a], dMem[a+1] ... = v ...
+ *   i <loc> [<n>]         ok op r s t, of n instructions
+ *   I <loc> <op> <r> <s> <t>   iMem[loc] = op r,s,t
+ *   s [<n>]               execute n instructions
+ *   c                     execute until the machine stops
+ *   ?                     the last stop again
+ *   b <loc>, B <loc>      set, clear a breakpoint
+ *   w <a>, W <a>          set, clear a watch on dMem[a]
+ *   k                     reset the machine
+ *   q                     end the session
+ *
+ * s and c go past a breakpoint the machine is at,
+ * and stop before the next one. Writing iMem drops
+ * the native code and blocks made of the program.
+ */
+
+/* why the machine stopped, for each STEPRESULT */
+static char * stopTab[] =
+        { "step", "halt", "imem", "dmem", "zerodivide",
+          "noinput", "badinput", "break", "watch" };
+
+/* the session */
+static TM * m;
+static TMTRAPS * traps;
+static FILE * out;
+static int useJit, useBlocks;
+static STEPRESULT last;
+static int lastAddr;
+
+/* changed drops what the engines made of the
+ * program, whose code or traps changed
+ */
+static void changed( void )
+{ tmTraps(m->prog,traps);
+  jitFlush(m->prog);
+  blockFlush(m->prog);
+}
+
+/* number scans a number from lo to hi into *v; as
+ * numbers are only separated by blanks, getNum,
+ * which adds up signed terms, cannot be used
+ */
+static int number( TMLINE * l, int lo, int hi, int * v )
+{ char * end;
+  long n;
+  if (! nonBlank(l)) return FALSE;
+  n = strtol(&l->text[l->col],&end,10);
+  if ((end == &l->text[l->col]) || (n < lo) || (n > hi)) return FALSE;
+  l->col = (int) (end - l->text);
+  *v = (int) n;
+  return TRUE;
+}
+
+/* stepPast executes the instruction at the pc, even
+ * at a breakpoint, stopping after a write to a
+ * watched address
+ */
+static STEPRESULT stepPast( void )
+{ int pc = m->reg[PC_REG];
+  INSTRUCTION * in;
+  STEPRESULT result = stepTM(m);
+  if ((result != srOKAY) || (m->prog->traps == NULL)) return result;
+  in = &m->prog->iMem[pc];
+  /* ST leaves the registers as they were */
+  if ((in->iop == opST) && traps->watchAt[in->iarg2 + m->reg[in->iarg3]])
+    return srWATCH;
+  return result;
+}
+
+/* run executes n instructions, or if n is 0 until
+ * the machine stops, and keeps why it stopped
+ */
+static void run( int n )
+{ STEPRESULT result = stepPast();
+  INSTRUCTION * in;
+  int count = 0;
+  if ((n == 0) && (result == srOKAY))
+  { if (useJit) result = jitRun(m,&count);
+    else if (useBlocks) result = blockRun(m,&count);
+    else
+      while (result == srOKAY) result = trapTM(m);
+  }
+  else
+    while ((result == srOKAY) && (--n > 0)) result = trapTM(m);
+  if (m->io != NULL) ioFlush(m->io);
+  fflush(m->out);
+  last = result;
+  if (result == srWATCH)
+  { /* the ST just executed */
+    in = &m->prog->iMem[m->reg[PC_REG] - 1];
+    lastAddr = in->iarg2 + m->reg[in->iarg3];
+  }
+}
+
+/* stop replies where the machine last stopped */
+static void stop( void )
+{ fprintf(out,"stop %s %d",stopTab[last],m->reg[PC_REG]);
+  if (last == srWATCH) fprintf(out," %d %d",lastAddr,m->dMem[lastAddr]);
+  fprintf(out,"\n");
+}
+
+/* setInstruction scans the instruction for iMem[loc]
+ * and writes it there, returning FALSE if it is wrong
+ */
+static int setInstruction( TMLINE * l, int loc )
+{ INSTRUCTION in;
+  int op = opHALT;
+  if (! getWord(l)) return FALSE;
+  while ((op < opRALim) && (strncmp(opCodeTab[op],l->word,4) != 0)) op++;
+  if ((op == opRRLim) || (op == opRMLim) || (op == opRALim)) return FALSE;
+  in.iop = op;
+  if (! number(l,0,NO_REGS - 1,&in.iarg1)) return FALSE;
+  if (opClass(op) == opclRR)
+  { if (! number(l,0,NO_REGS - 1,&in.iarg2)) return FALSE;
+  }
+  else if (! number(l,INT_MIN,INT_MAX,&in.iarg2)) return FALSE;
+  if (! number(l,0,NO_REGS - 1,&in.iarg3) || ! atEOL(l)) return FALSE;
+  m->prog->iMem[loc] = in;
+  changed();
+  return TRUE;
+}
+
+/* request answers the request in l */
+static void request( TMLINE * l )
+{ char cmd = l->ch;
+  int a, n, v, i;
+  INSTRUCTION * in;
+  getCh(l);
+  switch (cmd)
+  { case 'r' :
+      if (! atEOL(l)) break;
+      fprintf(out,"ok");
+      for (i = 0; i < NO_REGS; i++) fprintf(out," %d",m->reg[i]);
+      fprintf(out,"\n");
+      return;
+
+    case 'R' :
+      if (! number(l,0,NO_REGS - 1,&i) || ! number(l,INT_MIN,INT_MAX,&v) ||
+          ! atEOL(l))
+        break;
+      m->reg[i] = v;
+      fprintf(out,"ok\n");
+      return;
+
+    case 'm' :
+    case 'i' :
+      v = cmd == 'm' ? DADDR_SIZE : IADDR_SIZE;
+      n = 1;
+      if (! number(l,0,v - 1,&a)) break;
+      if (! atEOL(l) && ! number(l,1,v - a,&n)) break;
+      if (! atEOL(l)) break;
+      fprintf(out,"ok");
+      for (i = a; i < a + n; i++)
+        if (cmd == 'm') fprintf(out," %d",m->dMem[i]);
+        else
+        { in = &m->prog->iMem[i];
+          fprintf(out," %s %d %d %d",opCodeTab[in->iop],in->iarg1,
+                  in->iarg2,in->iarg3);
+        }
+      fprintf(out,"\n");
+      return;
+
+    case 'M' :
+      if (! number(l,0,DADDR_SIZE - 1,&a) || atEOL(l)) break;
+      for (i = a; ! atEOL(l); i++)
+        if ((i >= DADDR_SIZE) || ! number(l,INT_MIN,INT_MAX,&v))
+        { fprintf(out,"error bad values, from %d\n",i);
+          return;
+        }
+        else
+        { m->dMem[i] = v;
+          m->dirty[i >> DPAGE_SHIFT] = 1;
+        }
+      fprintf(out,"ok\n");
+      return;
+
+    case 'I' :
+      if (! number(l,0,IADDR_SIZE - 1,&a) || ! setInstruction(l,a)) break;
+      fprintf(out,"ok\n");
+      return;
+
+    case 's' :
+    case 'c' :
+      n = cmd == 's' ? 1 : 0;
+      if ((cmd == 's') && ! atEOL(l) && ! number(l,1,INT_MAX,&n)) break;
+      if (! atEOL(l)) break;
+      run(n);
+      stop();
+      return;
+
+    case '?' :
+      if (! atEOL(l)) break;
+      stop();
+      return;
+
+    case 'b' :
+    case 'B' :
+    case 'w' :
+    case 'W' :
+      v = (cmd == 'b') || (cmd == 'B') ? IADDR_SIZE : DADDR_SIZE;
+      if (! number(l,0,v - 1,&a) || ! atEOL(l)) break;
+      if ((cmd == 'b') || (cmd == 'B')) traps->breakAt[a] = cmd == 'b';
+      else traps->watchAt[a] = cmd == 'w';
+      changed();
+      fprintf(out,"ok\n");
+      return;
+
+    case 'k' :
+      if (! atEOL(l)) break;
+      tmReset(m);
+      last = srOKAY;
+      fprintf(out,"ok\n");
+      return;
+  }
+  fprintf(out,"error bad request '%s'\n",l->text);
+}
+
+/********************************************/
+int remoteOpen( char * name, FILE ** in, FILE ** out )
+{ struct sockaddr_un addr;
+  struct stat st;
+  int s, c;
+  if (strcmp(name,"-") == 0)
+  { *in = stdin;
+    *out = stdout;
+    return TRUE;
+  }
+  if (strlen(name) >= sizeof(addr.sun_path)) return FALSE;
+  memset(&addr,0,sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path,name);
+  /* a socket left by an earlier session, but nothing else */
+  if ((stat(name,&st) == 0) && S_ISSOCK(st.st_mode)) unlink(name);
+  s = socket(AF_UNIX,SOCK_STREAM,0);
+  if (s < 0) return FALSE;
+  if ((bind(s,(struct sockaddr *) &addr,sizeof(addr)) != 0) ||
+      (listen(s,1) != 0))
+  { close(s);
+    return FALSE;
+  }
+  printf("Waiting for a debugger on %s\n",name);
+  fflush(stdout);
+  c = accept(s,NULL,NULL);
+  close(s);
+  if (c < 0) return FALSE;
+  *in = fdopen(c,"r");
+  *out = fdopen(dup(c),"w");
+  return (*in != NULL) && (*out != NULL);
+} /* remoteOpen */
+
+/********************************************/
+void remoteServe( TM * machine, TMTRAPS * t, FILE * in, FILE * o,
+                  int jit, int blocks )
+{ TMLINE line;
+  m = machine;
+  traps = t;
+  out = o;
+  useJit = jit;
+  useBlocks = blocks;
+  last = srOKAY;
+  while (readLine(&line,in))
+  { if (! nonBlank(&line)) continue;
+    if (line.ch == 'q')
+    { fprintf(out,"ok\n");
+      fflush(out);
+      return;
+    }
+    request(&line);
+    fflush(out);
+  }
+} /* remoteServe */
+
+/********************************************/
+void remoteClose( char * name, FILE * in, FILE * out )
+{ if (in == stdin) return;
+  fclose(in);
+  fclose(out);
+  unlink(name);
+} /* remoteClose */
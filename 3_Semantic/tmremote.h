@@ -0,0 +1,32 @@
+/****************************************************/
+/* File: tmremote.h                                 */
+/* Debugging TM programs from other programs, by a  */
+/* line-oriented protocol                           */
+/****************************************************/
+
+#ifndef _TMREMOTE_H_
+#define _TMREMOTE_H_
+
+#include "tm.h"
+
+/* Function remoteOpen opens the streams of a session:
+ * the standard input and output if name is "-", and
+ * otherwise the first connection to a Unix domain
+ * socket made at name; it returns FALSE if it cannot
+ */
+int remoteOpen( char * name, FILE ** in, FILE ** out );
+
+/* Procedure remoteServe answers the requests read
+ * from in, on out, until the end of in or a q, on
+ * machine m with the traps t, running it with the
+ * native code if jit is TRUE, or blocks if blocks is
+ */
+void remoteServe( TM * m, TMTRAPS * t, FILE * in, FILE * out,
+                  int jit, int blocks );
+
+/* Procedure remoteClose closes the streams of the
+ * session opened for name, and its socket
+ */
+void remoteClose( char * name, FILE * in, FILE * out );
+
+#endif
@@ -0,0 +1,218 @@
+/****************************************************/
+/* File: tmsnap.c                                   */
+/* Snapshots of TM machines, kept in memory or      */
+/* saved to files                                   */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tm.h"
+
+/* A machine marks each page of dMem it writes, and
+ * the marks tell what differs from its base, the
+ * snapshot it was last taken to or restored from, or
+ * the cleared machine; restoring the base copies back
+ * only those pages.
+ *
+ * A snapshot file holds, as 32-bit little-endian
+ * words: the magic word, DADDR_SIZE, NO_REGS, a hash
+ * of the program, the positions of the input and the
+ * output, the registers, then the runs of dMem that
+ * differ from the cleared machine, each as its start,
+ * its length and its words, ended by a run of length 0.
+ */
+
+#define SNAP_MAGIC 0x31534D54 /* "TMS1" */
+
+/* runs of dMem words that differ from the cleared
+ * machine are only split by gaps longer than this
+ */
+#define SNAP_GAP 2
+
+/* cleared returns the word at loc of a cleared machine */
+static int cleared( int loc )
+{ return loc == 0 ? DADDR_SIZE - 1 : 0;
+}
+
+static void writeWord( FILE * f, unsigned w )
+{ putc(w & 0xff,f);
+  putc((w >> 8) & 0xff,f);
+  putc((w >> 16) & 0xff,f);
+  putc((w >> 24) & 0xff,f);
+}
+
+/* readWord reads a word into *w, returning FALSE at
+ * the end of f
+ */
+static int readWord( FILE * f, int * w )
+{ unsigned u = 0;
+  int i, c;
+  for (i = 0; i < 4; i++)
+  { c = getc(f);
+    if (c == EOF) return FALSE;
+    u |= (unsigned) c << (8 * i);
+  }
+  *w = (int) u;
+  return TRUE;
+}
+
+/* inPosition returns the position of the input of
+ * machine m, or -1
+ */
+static long inPosition( TM * m )
+{ if ((m->io != NULL) && (m->io->in != NULL)) return ioTell(m->io);
+  return m->in == NULL ? -1 : ftell(m->in);
+}
+
+/* outFile returns the file the OUT values of machine
+ * m go to, with what is buffered for it written out
+ */
+static FILE * outFile( TM * m )
+{ if ((m->io != NULL) && (m->io->out != NULL))
+  { ioFlush(m->io);
+    return m->io->out;
+  }
+  if (m->out != NULL) fflush(m->out);
+  return m->out;
+}
+
+/* outPosition returns the position of the output of
+ * machine m, or -1
+ */
+static long outPosition( TM * m )
+{ FILE * f = outFile(m);
+  return f == NULL ? -1 : ftell(f);
+}
+
+/* reposition puts the input and output of machine m
+ * back at in and out, where they can be
+ */
+static void reposition( TM * m, long in, long out )
+{ FILE * f = outFile(m);
+  if (in >= 0)
+  { if ((m->io != NULL) && (m->io->in != NULL)) ioSeek(m->io,in);
+    else if (m->in != NULL) fseek(m->in,in,SEEK_SET);
+  }
+  if ((out >= 0) && (f != NULL)) fseek(f,out,SEEK_SET);
+}
+
+/********************************************/
+void tmSnapshot( TM * m, TMSNAP * s )
+{ s->prog = m->prog;
+  memcpy(s->reg,m->reg,sizeof(s->reg));
+  memcpy(s->dMem,m->dMem,sizeof(s->dMem));
+  s->inPos = inPosition(m);
+  s->outPos = outPosition(m);
+  memset(m->dirty,0,DPAGES);
+  m->base = s;
+} /* tmSnapshot */
+
+/********************************************/
+void tmRestore( TM * m, TMSNAP * s )
+{ int page, loc, end;
+  if (m->base != s) memset(m->dirty,1,DPAGES);
+  m->prog = s->prog;
+  memcpy(m->reg,s->reg,sizeof(m->reg));
+  for (page = 0; page < DPAGES; page++)
+    if (m->dirty[page])
+    { loc = page << DPAGE_SHIFT;
+      end = loc + (1 << DPAGE_SHIFT);
+      if (end > DADDR_SIZE) end = DADDR_SIZE;
+      memcpy(&m->dMem[loc],&s->dMem[loc],(end - loc) * sizeof(int));
+      m->dirty[page] = 0;
+    }
+  m->base = s;
+  reposition(m,s->inPos,s->outPos);
+} /* tmRestore */
+
+/********************************************/
+int tmSave( TM * m, char * name )
+{ FILE * f = fopen(name,"wb");
+  long in = inPosition(m), out = outPosition(m);
+  int loc, end, gap, i;
+  if (f == NULL)
+  { printf("cannot write '%s'\n",name);
+    return FALSE;
+  }
+  writeWord(f,SNAP_MAGIC);
+  writeWord(f,DADDR_SIZE);
+  writeWord(f,NO_REGS);
+  writeWord(f,programHash(m->prog));
+  writeWord(f,(unsigned) in);
+  writeWord(f,(unsigned) out);
+  for (i = 0; i < NO_REGS; i++) writeWord(f,m->reg[i]);
+  loc = 0;
+  while (loc < DADDR_SIZE)
+  { if (m->dMem[loc] == cleared(loc))
+    { loc++;
+      continue;
+    }
+    /* the run ends before more than SNAP_GAP cleared words */
+    end = loc + 1;
+    gap = 0;
+    for (i = end; (i < DADDR_SIZE) && (gap <= SNAP_GAP); i++)
+      if (m->dMem[i] == cleared(i)) gap++;
+      else
+      { end = i + 1;
+        gap = 0;
+      }
+    writeWord(f,loc);
+    writeWord(f,end - loc);
+    for (i = loc; i < end; i++) writeWord(f,m->dMem[i]);
+    loc = end;
+  }
+  writeWord(f,0);
+  writeWord(f,0);
+  if (fclose(f) != 0)
+  { printf("cannot write '%s'\n",name);
+    return FALSE;
+  }
+  return TRUE;
+} /* tmSave */
+
+/********************************************/
+int tmLoad( TM * m, char * name )
+{ FILE * f = fopen(name,"rb");
+  int w[6], reg[NO_REGS], loc, len = -1, i, ok = TRUE;
+  if (f == NULL)
+  { printf("file '%s' not found\n",name);
+    return FALSE;
+  }
+  for (i = 0; ok && (i < 6); i++) ok = readWord(f,&w[i]);
+  for (i = 0; ok && (i < NO_REGS); i++) ok = readWord(f,&reg[i]);
+  if (! ok || ((unsigned) w[0] != SNAP_MAGIC) || (w[1] != DADDR_SIZE) ||
+      (w[2] != NO_REGS))
+  { printf("'%s' is not a snapshot of this TM\n",name);
+    fclose(f);
+    return FALSE;
+  }
+  if ((unsigned) w[3] != programHash(m->prog))
+  { printf("'%s' is a snapshot of another program\n",name);
+    fclose(f);
+    return FALSE;
+  }
+  /* the runs are written over the cleared machine */
+  tmReset(m);
+  memcpy(m->reg,reg,sizeof(m->reg));
+  while (ok && readWord(f,&loc) && readWord(f,&len) && (len > 0))
+  { if ((loc < 0) || (len > DADDR_SIZE - loc))
+    { ok = FALSE;
+      break;
+    }
+    for (i = loc; ok && (i < loc + len); i++)
+    { ok = readWord(f,&m->dMem[i]);
+      m->dirty[i >> DPAGE_SHIFT] = 1;
+    }
+  }
+  if (! ok || (len != 0))
+  { printf("'%s' is cut short or damaged\n",name);
+    tmReset(m);
+    fclose(f);
+    return FALSE;
+  }
+  fclose(f);
+  reposition(m,w[4],w[5]);
+  return TRUE;
+} /* tmLoad */
@@ -0,0 +1,102 @@
+/****************************************************/
+/* File: tmtrace.c                                  */
+/* Binary traces of the execution of TM programs    */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tm.h"
+#include "tmtrace.h"
+
+/* Records go into a ring in memory. A full trace
+ * writes the ring to the file each time it fills,
+ * TRACE_BLOCK records at once; a trace of the last
+ * instructions only keeps the ring going round,
+ * and writes it, oldest first, when it is closed.
+ */
+#define TRACE_BLOCK 4096
+
+static void putWord( unsigned char * b, unsigned w )
+{ b[0] = (unsigned char) (w & 0xff);
+  b[1] = (unsigned char) ((w >> 8) & 0xff);
+  b[2] = (unsigned char) ((w >> 16) & 0xff);
+  b[3] = (unsigned char) ((w >> 24) & 0xff);
+}
+
+/* writes writes records from to to-1 of the ring */
+static void writes( TRACE * t, int from, int to )
+{ if (to > from)
+    fwrite(t->ring + from * TRACE_RECSIZE,TRACE_RECSIZE,to - from,t->f);
+}
+
+/********************************************/
+TRACE * traceOpen( char * name, TMPROGRAM * p, int lo, int hi, int last )
+{ TRACE * t = (TRACE *) calloc(1,sizeof(TRACE));
+  unsigned char header [8];
+  if (t == NULL) return NULL;
+  t->size = last > 0 ? last : TRACE_BLOCK;
+  t->ring = (unsigned char *) malloc((size_t) t->size * TRACE_RECSIZE);
+  t->f = fopen(name,"wb");
+  if ((t->ring == NULL) || (t->f == NULL))
+  { if (t->f != NULL) fclose(t->f);
+    free(t->ring);
+    free(t);
+    return NULL;
+  }
+  t->lo = lo;
+  t->hi = hi;
+  t->last = last;
+  putWord(header,TRACE_MAGIC);
+  putWord(header + 4,programHash(p));
+  fwrite(header,1,sizeof(header),t->f);
+  return t;
+} /* traceOpen */
+
+/********************************************/
+STEPRESULT traceStep( TRACE * t, TM * m )
+{ int pc = m->reg[PC_REG], r = -1, addr = -1;
+  INSTRUCTION * in;
+  STEPRESULT result;
+  unsigned char * b;
+  if ((pc < 0) || (pc >= IADDR_SIZE) || (pc < t->lo) || (pc > t->hi))
+    return stepTM(m);
+  in = &m->prog->iMem[pc];
+  if (in->iop == opST) addr = in->iarg2 + m->reg[in->iarg3];
+  result = stepTM(m);
+  if (result != srOKAY) addr = -1;
+  else if ((in->iop != opOUT) && (in->iop != opST) && (in->iop < opJLT))
+    r = in->iarg1;
+  b = t->ring + t->next * TRACE_RECSIZE;
+  putWord(b,(unsigned) pc | ((unsigned) (r + 1) << 24));
+  putWord(b + 4,r >= 0 ? m->reg[r] : 0);
+  putWord(b + 8,addr);
+  putWord(b + 12,addr >= 0 ? m->dMem[addr] : 0);
+  if (++t->next == t->size) t->next = 0;
+  if (t->n < t->size) t->n++;
+  if ((t->last == 0) && (t->n == t->size)) traceFlush(t);
+  return result;
+} /* traceStep */
+
+/********************************************/
+void traceFlush( TRACE * t )
+{ if (t->last > 0) return;
+  writes(t,0,t->n);
+  fflush(t->f);
+  t->n = 0;
+  t->next = 0;
+} /* traceFlush */
+
+/********************************************/
+void traceClose( TRACE * t )
+{ if (t->last == 0) traceFlush(t);
+  else if (t->n < t->size) writes(t,0,t->n);
+  else
+  { writes(t,t->next,t->size);
+    writes(t,0,t->next);
+  }
+  fclose(t->f);
+  free(t->ring);
+  free(t);
+} /* traceClose */
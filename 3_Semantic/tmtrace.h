@@ -0,0 +1,61 @@
+/****************************************************/
+/* File: tmtrace.h                                  */
+/* Binary traces of the execution of TM programs    */
+/****************************************************/
+
+#ifndef _TMTRACE_H_
+#define _TMTRACE_H_
+
+#include "tm.h"
+
+/* a trace file holds the magic word and the hash of
+ * the program, then a record per instruction
+ * executed, each of these four 32-bit little-endian
+ * words
+ */
+#define TRACE_MAGIC   0x31544D54 /* "TMT1" */
+#define TRACE_RECSIZE 16
+
+/* the first word of a record is the pc, with the
+ * register the instruction wrote plus 1, or 0, in its
+ * top byte; then come the value written, the dMem
+ * address written or -1, and the value written there
+ */
+#define TRACE_PC(w)  ((w) & 0xFFFFFF)
+#define TRACE_REG(w) ((int) ((unsigned) (w) >> 24) - 1)
+
+typedef struct
+   { FILE * f;
+     int lo, hi;                /* the pcs traced */
+     int last;                  /* if > 0, only the last this many */
+     unsigned char * ring;
+     int size;                  /* records the ring holds */
+     int n;                     /* records in the ring */
+     int next;                  /* where the next one goes */
+   } TRACE;
+
+/* Function traceOpen starts a trace of the execution
+ * of program p into the file name, of the pcs from
+ * lo to hi, and if last > 0 only of the last that
+ * many instructions; it returns NULL if the file
+ * cannot be written
+ */
+TRACE * traceOpen( char * name, TMPROGRAM * p, int lo, int hi, int last );
+
+/* Function traceStep executes an instruction of
+ * machine m as stepTM does, and records it in t
+ */
+STEPRESULT traceStep( TRACE * t, TM * m );
+
+/* Procedure traceFlush writes what t holds to its
+ * file; the last instructions are written when t is
+ * closed
+ */
+void traceFlush( TRACE * t );
+
+/* Procedure traceClose writes what t holds and
+ * closes its file
+ */
+void traceClose( TRACE * t );
+
+#endif
@@ -0,0 +1,243 @@
+/****************************************************/
+/* File: tmundo.c                                   */
+/* Running TM programs backwards, from a log of     */
+/* what each instruction wrote over                 */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tm.h"
+#include "tmundo.h"
+
+/* Each instruction executed puts a record of what it
+ * writes over into a ring, allocated once, so going
+ * back through the last size instructions undoes
+ * them one by one. Every half ring the whole machine
+ * is kept in a checkpoint. Going back further starts
+ * from the last checkpoint before and executes again
+ * up to there, quietly, the INs getting the values
+ * logged when they were first executed; as the TM is
+ * otherwise deterministic, the machine goes through
+ * the same states, and the ring is filled again.
+ */
+
+/* checkpoint returns the ith checkpoint of u, oldest
+ * first
+ */
+static CHECKPOINT * checkpoint( UNDO * u, int i )
+{ return &u->cps[(u->firstCp + i) % UNDO_CHECKPOINTS];
+}
+
+/* keep keeps machine m in a checkpoint, dropping the
+ * oldest one if they are all used
+ */
+static void keep( UNDO * u, TM * m )
+{ CHECKPOINT * cp;
+  long i, j;
+  if ((u->ncps > 0) && (checkpoint(u,u->ncps - 1)->time >= u->now)) return;
+  if (u->ncps < UNDO_CHECKPOINTS) u->ncps++;
+  else u->firstCp = (u->firstCp + 1) % UNDO_CHECKPOINTS;
+  cp = checkpoint(u,u->ncps - 1);
+  cp->time = u->now;
+  memcpy(cp->reg,m->reg,sizeof(cp->reg));
+  memcpy(cp->dMem,m->dMem,sizeof(cp->dMem));
+  /* the values read before the oldest one are not needed */
+  for (i = 0; (i < u->ninputs) &&
+              (u->inputs[i].time < checkpoint(u,0)->time); i++)
+    ;
+  if (i > 0)
+  { for (j = i; j < u->ninputs; j++) u->inputs[j - i] = u->inputs[j];
+    u->ninputs -= i;
+  }
+}
+
+/* input returns the value logged for the IN at time,
+ * in *value, or FALSE if it was not executed before
+ */
+static int input( UNDO * u, long time, int * value )
+{ long lo = 0, hi = u->ninputs - 1, mid;
+  while (lo <= hi)
+  { mid = (lo + hi) / 2;
+    if (u->inputs[mid].time == time)
+    { *value = u->inputs[mid].value;
+      return TRUE;
+    }
+    if (u->inputs[mid].time < time) lo = mid + 1;
+    else hi = mid - 1;
+  }
+  return FALSE;
+}
+
+/* logInput logs the value read by the IN at time */
+static void logInput( UNDO * u, long time, int value )
+{ if (u->ninputs == u->capInputs)
+  { u->capInputs = u->capInputs == 0 ? 256 : 2 * u->capInputs;
+    u->inputs = (INPUTREC *) realloc(u->inputs,
+                                     u->capInputs * sizeof(INPUTREC));
+    if (u->inputs == NULL)
+    { printf("Out of memory for the undo log\n");
+      exit(1);
+    }
+  }
+  u->inputs[u->ninputs].time = time;
+  u->inputs[u->ninputs].value = value;
+  u->ninputs++;
+}
+
+/* step executes an instruction of machine m, logging
+ * it; if quiet, OUT prints nothing
+ */
+static STEPRESULT step( UNDO * u, TM * m, int quiet )
+{ int pc = m->reg[PC_REG], a;
+  INSTRUCTION * in;
+  UNDOREC * rec;
+  STEPRESULT result;
+  if ((pc < 0) || (pc >= IADDR_SIZE)) return stepTM(m);
+  if (u->now % u->every == 0) keep(u,m);
+  in = &m->prog->iMem[pc];
+  rec = &u->ring[u->next];
+  rec->pc = pc;
+  rec->reg = -1;
+  rec->addr = -1;
+  if ((in->iop != opHALT) && (in->iop != opOUT) && (in->iop != opST) &&
+      (in->iop < opJLT))
+  { rec->reg = in->iarg1;
+    rec->regOld = m->reg[in->iarg1];
+  }
+  if (in->iop == opST)
+  { a = in->iarg2 + m->reg[in->iarg3];
+    if ((a >= 0) && (a < DADDR_SIZE))
+    { rec->addr = a;
+      rec->memOld = m->dMem[a];
+    }
+  }
+  if ((in->iop == opIN) && input(u,u->now,&a))
+  { m->reg[in->iarg1] = a;
+    m->reg[PC_REG] = pc + 1;
+    result = srOKAY;
+  }
+  else if ((in->iop == opOUT) && quiet)
+  { m->reg[PC_REG] = pc + 1;
+    result = srOKAY;
+  }
+  else
+  { result = stepTM(m);
+    if ((in->iop == opIN) && (result == srOKAY))
+      logInput(u,u->now,m->reg[in->iarg1]);
+  }
+  if (++u->next == u->size) u->next = 0;
+  if (u->n < u->size) u->n++;
+  u->now++;
+  return result;
+}
+
+/* pop undoes the last instruction logged in the ring
+ * and returns its record
+ */
+static UNDOREC * pop( UNDO * u, TM * m )
+{ UNDOREC * rec;
+  u->next = u->next == 0 ? u->size - 1 : u->next - 1;
+  rec = &u->ring[u->next];
+  u->n--;
+  u->now--;
+  if (rec->addr >= 0)
+  { m->dMem[rec->addr] = rec->memOld;
+    m->dirty[rec->addr >> DPAGE_SHIFT] = 1;
+  }
+  if (rec->reg >= 0) m->reg[rec->reg] = rec->regOld;
+  m->reg[PC_REG] = rec->pc;
+  return rec;
+}
+
+/* oldest returns the earliest time u reaches back to */
+static long oldest( UNDO * u )
+{ long t = u->now - u->n;
+  if ((u->ncps > 0) && (checkpoint(u,0)->time < t))
+    t = checkpoint(u,0)->time;
+  return t;
+}
+
+/* goBack takes machine m back to time, which u must
+ * reach back to
+ */
+static void goBack( UNDO * u, TM * m, long time )
+{ CHECKPOINT * cp = NULL;
+  int i;
+  if (time >= u->now - u->n)
+  { while (u->now > time) pop(u,m);
+    return;
+  }
+  for (i = 0; i < u->ncps; i++)
+    if (checkpoint(u,i)->time <= time) cp = checkpoint(u,i);
+  memcpy(m->reg,cp->reg,sizeof(m->reg));
+  memcpy(m->dMem,cp->dMem,sizeof(m->dMem));
+  memset(m->dirty,1,DPAGES);
+  u->n = 0;
+  u->next = 0;
+  u->now = cp->time;
+  while (u->now < time) step(u,m,TRUE);
+}
+
+/********************************************/
+UNDO * undoOpen( int size )
+{ UNDO * u = (UNDO *) calloc(1,sizeof(UNDO));
+  if (size < 2) size = 2;
+  if (u == NULL) return NULL;
+  u->ring = (UNDOREC *) malloc((size_t) size * sizeof(UNDOREC));
+  if (u->ring == NULL)
+  { free(u);
+    return NULL;
+  }
+  u->size = size;
+  u->every = size / 2;
+  return u;
+} /* undoOpen */
+
+/********************************************/
+void undoReset( UNDO * u )
+{ u->n = 0;
+  u->next = 0;
+  u->now = 0;
+  u->firstCp = 0;
+  u->ncps = 0;
+  u->ninputs = 0;
+} /* undoReset */
+
+/********************************************/
+STEPRESULT undoStep( UNDO * u, TM * m )
+{ return step(u,m,FALSE);
+} /* undoStep */
+
+/********************************************/
+long undoBack( UNDO * u, TM * m, long n )
+{ long from = u->now, time = u->now - n;
+  if (time < oldest(u)) time = oldest(u);
+  goBack(u,m,time);
+  return from - u->now;
+} /* undoBack */
+
+/********************************************/
+int undoReverse( UNDO * u, TM * m, char * breakAt, char * watchAt,
+                 long * count )
+{ long from = u->now, end;
+  UNDOREC * rec;
+  for (;;)
+  { while (u->n > 0)
+    { rec = pop(u,m);
+      if (((rec->addr >= 0) && watchAt[rec->addr]) || breakAt[rec->pc])
+      { *count = from - u->now;
+        return TRUE;
+      }
+    }
+    /* refill the ring from the checkpoint before */
+    if (oldest(u) >= u->now)
+    { *count = from - u->now;
+      return FALSE;
+    }
+    end = u->now;
+    goBack(u,m,u->now - 1);
+    while (u->now < end) step(u,m,TRUE);
+  }
+} /* undoReverse */
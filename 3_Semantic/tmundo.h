@@ -0,0 +1,91 @@
+/****************************************************/
+/* File: tmundo.h                                   */
+/* Running TM programs backwards, from a log of     */
+/* what each instruction wrote over                 */
+/****************************************************/
+
+#ifndef _TMUNDO_H_
+#define _TMUNDO_H_
+
+#include "tm.h"
+
+/* the checkpoints kept; with one every half ring of
+ * records, they reach back this many half rings
+ */
+#define UNDO_CHECKPOINTS 16
+
+/* what an instruction executed wrote over: the
+ * register, or -1, and its old value, and the dMem
+ * address, or -1, and its old value
+ */
+typedef struct
+   { int pc;
+     int reg;
+     int regOld;
+     int addr;
+     int memOld;
+   } UNDOREC;
+
+/* the whole state of the machine at a time */
+typedef struct
+   { long time;
+     int reg [NO_REGS];
+     int dMem [DADDR_SIZE];
+   } CHECKPOINT;
+
+/* the value read by the IN executed at a time */
+typedef struct
+   { long time;
+     int value;
+   } INPUTREC;
+
+typedef struct
+   { UNDOREC * ring;
+     int size;                  /* records the ring holds */
+     int n;                     /* records in it */
+     int next;                  /* where the next one goes */
+     long now;                  /* instructions executed */
+     long every;                /* instructions between checkpoints */
+     CHECKPOINT cps [UNDO_CHECKPOINTS];
+     int firstCp;
+     int ncps;
+     INPUTREC * inputs;
+     long ninputs;
+     long capInputs;
+   } UNDO;
+
+/* Function undoOpen returns a log of the last size
+ * instructions executed, or NULL if there is no
+ * memory for it
+ */
+UNDO * undoOpen( int size );
+
+/* Procedure undoReset forgets what u logged; it
+ * must be called when the machine is changed other
+ * than by executing it
+ */
+void undoReset( UNDO * u );
+
+/* Function undoStep executes an instruction of
+ * machine m as stepTM does, and logs it in u; an IN
+ * executed before, at the same time, gets the value
+ * it read then
+ */
+STEPRESULT undoStep( UNDO * u, TM * m );
+
+/* Function undoBack takes machine m back n
+ * instructions, or as far as u reaches, and returns
+ * how many it went back
+ */
+long undoBack( UNDO * u, TM * m, long n );
+
+/* Function undoReverse takes machine m back until it
+ * is at a pc marked in breakAt, or before writing a
+ * dMem address marked in watchAt, and returns TRUE,
+ * or as far as u reaches and returns FALSE; *count is
+ * set to how many instructions it went back
+ */
+int undoReverse( UNDO * u, TM * m, char * breakAt, char * watchAt,
+                 long * count );
+
+#endif
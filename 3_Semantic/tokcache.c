@@ -0,0 +1,196 @@
+/****************************************************/
+/* File: tokcache.c                                 */
+/* On-disk token cache implementation               */
+/* for the C-MINUS compiler                         */
+/****************************************************/
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "token.h"
+#include "pscan.h"
+#include "tokcache.h"
+
+/* a cache entry is laid out as
+ *
+ *   CacheHeader
+ *   TokenRec  tokens[ntokens]
+ *   int       stroff[nstrings]   (offsets into the text)
+ *   char      text[textsize]     (NUL terminated lexemes)
+ *
+ * so that the token array can be used in place once
+ * the file is mapped. Entries are named after the
+ * hash of the source contents, and the header repeats
+ * the hash and length to catch collisions
+ */
+#define CACHEMAGIC   0x4b544d43 /* "CMTK" */
+#define CACHEVERSION 1
+
+typedef struct
+   { int magic;
+     int version;
+     unsigned int hashlo, hashhi; /* FNV-1a hash of the source */
+     int srclen;
+     int ntokens;
+     int nstrings;
+     int textsize;
+   } CacheHeader;
+
+/* the 64 bit FNV-1a hash of n bytes at s */
+static unsigned long long hashSource( const char * s, long n )
+{ unsigned long long h = 14695981039346656037ULL;
+  long i;
+  for (i=0;i<n;i++)
+  { h ^= (unsigned char) s[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+/* loadCache maps the cache entry in file path and
+ * installs it as the token buffer. Returns FALSE if
+ * there is no usable entry
+ */
+static int loadCache( const char * path, unsigned long long h, long srclen )
+{ int fd, i, ok;
+  struct stat st;
+  char * map;
+  CacheHeader * hdr;
+  int * stroff;
+  char * text;
+  char ** strs;
+  TokenRec * toks;
+  size_t need;
+  fd = open(path,O_RDONLY);
+  if (fd < 0) return FALSE;
+  if ((fstat(fd,&st) < 0) || (st.st_size < (off_t) sizeof(CacheHeader)))
+  { close(fd);
+    return FALSE;
+  }
+  map = (char *) mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+  close(fd);
+  if (map == MAP_FAILED) return FALSE;
+  hdr = (CacheHeader *) map;
+  need = sizeof(CacheHeader) + (size_t) hdr->ntokens*sizeof(TokenRec)
+       + (size_t) hdr->nstrings*sizeof(int) + hdr->textsize;
+  if ((hdr->magic != CACHEMAGIC) || (hdr->version != CACHEVERSION) ||
+      (hdr->hashlo != (unsigned int) h) ||
+      (hdr->hashhi != (unsigned int) (h >> 32)) ||
+      (hdr->srclen != srclen) || (hdr->ntokens <= 0) ||
+      (hdr->nstrings < 0) || (hdr->textsize < 0) ||
+      (need != (size_t) st.st_size))
+  { munmap(map,st.st_size);
+    return FALSE;
+  }
+  stroff = (int *) (map + sizeof(CacheHeader) + hdr->ntokens*sizeof(TokenRec));
+  text = (char *) (stroff + hdr->nstrings);
+  strs = (char **) malloc((hdr->nstrings+1)*sizeof(char *));
+  if (strs == NULL)
+  { munmap(map,st.st_size);
+    return FALSE;
+  }
+  /* the records are checked too: a lexeme runs on to
+   * the NUL that ends the text, and a token's value
+   * indexes strs, so a damaged entry of the right
+   * size is rejected rather than read out of bounds
+   */
+  ok = (hdr->nstrings == 0) ||
+       ((hdr->textsize > 0) && (text[hdr->textsize-1] == '\0'));
+  for (i=0;ok && (i<hdr->nstrings);i++)
+  { ok = (stroff[i] >= 0) && (stroff[i] < hdr->textsize);
+    strs[i] = text + stroff[i];
+  }
+  toks = (TokenRec *) (map + sizeof(CacheHeader));
+  for (i=0;ok && (i<hdr->ntokens);i++)
+    ok = (toks[i].value >= 0) && (toks[i].value < hdr->nstrings);
+  if (!ok || (toks[hdr->ntokens-1].kind != ENDFILE))
+  { free(strs);
+    munmap(map,st.st_size);
+    return FALSE;
+  }
+  useTokens(toks,hdr->ntokens,strs,hdr->nstrings);
+  return TRUE;
+}
+
+/* storeCache writes the current token buffer to the
+ * cache entry in file path. The entry is written
+ * under a temporary name and renamed into place, so
+ * concurrent compilations never see a partial file
+ */
+static void storeCache( const char * path, unsigned long long h, long srclen )
+{ CacheHeader hdr;
+  char * tmp;
+  FILE * fp;
+  int i, off, ok;
+  hdr.magic = CACHEMAGIC;
+  hdr.version = CACHEVERSION;
+  hdr.hashlo = (unsigned int) h;
+  hdr.hashhi = (unsigned int) (h >> 32);
+  hdr.srclen = srclen;
+  hdr.ntokens = tokenCount;
+  hdr.nstrings = internCount();
+  hdr.textsize = 0;
+  for (i=0;i<hdr.nstrings;i++)
+    hdr.textsize += strlen(internName(i)) + 1;
+  tmp = (char *) malloc(strlen(path)+16);
+  if (tmp == NULL) return;
+  sprintf(tmp,"%s.%d",path,(int) getpid());
+  fp = fopen(tmp,"wb");
+  if (fp == NULL)
+  { free(tmp);
+    return;
+  }
+  ok = (fwrite(&hdr,sizeof(hdr),1,fp) == 1);
+  ok = ok && (fwrite(tokenBuf,sizeof(TokenRec),tokenCount,fp)
+              == (size_t) tokenCount);
+  for (i=0,off=0;ok && (i<hdr.nstrings);i++)
+  { ok = (fwrite(&off,sizeof(int),1,fp) == 1);
+    off += strlen(internName(i)) + 1;
+  }
+  for (i=0;ok && (i<hdr.nstrings);i++)
+    ok = (fwrite(internName(i),strlen(internName(i))+1,1,fp) == 1);
+  if (fclose(fp) != 0) ok = FALSE;
+  if (!ok || (rename(tmp,path) != 0))
+    remove(tmp);
+  free(tmp);
+}
+
+/* Function cacheTokens fills the token buffer for
+ * the whole source file, from the cache directory
+ * dir if possible
+ */
+int cacheTokens( const char * dir, int nthreads )
+{ char * src;
+  char * path;
+  long srclen;
+  unsigned long long h;
+  src = readFile(source,&srclen);
+  if (src == NULL)
+  { fprintf(listing,"Out of memory error reading source\n");
+    exit(1);
+  }
+  h = hashSource(src,srclen);
+  path = (char *) malloc(strlen(dir)+32);
+  if (path == NULL)
+  { fprintf(listing,"Out of memory error reading source\n");
+    exit(1);
+  }
+  sprintf(path,"%s/%016llx.tok",dir,h);
+  if (loadCache(path,h,srclen))
+  { free(path);
+    free(src);
+    return TRUE;
+  }
+  if (nthreads > 0)
+    parallelTokens(src,srclen,nthreads);
+  else
+    while (getToken() != ENDFILE);
+  storeCache(path,h,srclen);
+  free(path);
+  free(src);
+  return FALSE;
+}
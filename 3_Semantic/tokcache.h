@@ -0,0 +1,23 @@
+/****************************************************/
+/* File: tokcache.h                                 */
+/* On-disk token cache for the C-MINUS compiler     */
+/* A source file is scanned once; later runs on the */
+/* same contents map the stored token stream and    */
+/* skip scanning altogether                         */
+/****************************************************/
+
+#ifndef _TOKCACHE_H_
+#define _TOKCACHE_H_
+
+/* Function cacheTokens fills the token buffer for
+ * the whole source file. If the cache directory dir
+ * holds an entry for the current contents of source
+ * it is mapped and used directly; otherwise the file
+ * is scanned to the end, with getToken or, if
+ * nthreads > 0, with the parallel scanner, and the
+ * result is stored in dir for the next run. Returns
+ * TRUE if the tokens came from the cache
+ */
+int cacheTokens( const char * dir, int nthreads );
+
+#endif
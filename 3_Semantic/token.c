@@ -0,0 +1,170 @@
+/****************************************************/
+/* File: token.c                                    */
+/* Token buffer and string intern table             */
+/* implementation for the C-MINUS compiler          */
+/****************************************************/
+
+#include "globals.h"
+#include "token.h"
+
+/* INITTOKENS is the initial capacity of tokenBuf */
+#define INITTOKENS 1024
+
+TokenRec * tokenBuf = NULL;
+int tokenCount = 0;
+int tokenPos = 0;
+
+static int tokenCap = 0;
+
+/* the intern table: names[i] is the string with
+ * intern index i, chained through nameNext from
+ * the bucket heads in nameHash. The number of
+ * buckets is a power of two, doubled whenever the
+ * table holds more names than buckets
+ */
+static char ** names = NULL;
+static int * nameNext = NULL;
+static int nameCount = 0;
+static int nameCap = 0;
+static int * nameHash = NULL;
+static int hashSize = 0;
+
+/* the hash function for the intern table (FNV-1a) */
+static unsigned internHash( const char * s, int len )
+{ unsigned h = 2166136261u;
+  int i;
+  for (i=0;i<len;i++)
+  { h ^= (unsigned char) s[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+/* rehash rebuilds the bucket chains for size buckets */
+static void rehash( int size )
+{ int i;
+  unsigned h;
+  free(nameHash);
+  nameHash = (int *) malloc(size*sizeof(int));
+  nameNext = (int *) realloc(nameNext,nameCap*sizeof(int));
+  if ((nameHash == NULL) || ((nameCap > 0) && (nameNext == NULL)))
+  { fprintf(listing,"Out of memory error at line %d\n",lineno);
+    exit(1);
+  }
+  hashSize = size;
+  for (i=0;i<size;i++) nameHash[i] = -1;
+  for (i=0;i<nameCount;i++)
+  { h = internHash(names[i],strlen(names[i])) & (size-1);
+    nameNext[i] = nameHash[h];
+    nameHash[h] = i;
+  }
+}
+
+/* Function internString returns the intern index
+ * of the string s of length len, entering a new
+ * copy of it in the intern table if necessary
+ */
+int internString( const char * s, int len )
+{ unsigned h;
+  int i;
+  if (hashSize == 0)
+  { for (i=1024;i<nameCount;i*=2);
+    rehash(i);
+  }
+  h = internHash(s,len) & (hashSize-1);
+  for (i=nameHash[h];i>=0;i=nameNext[i])
+    if ((strncmp(names[i],s,len) == 0) && (names[i][len] == '\0'))
+      return i;
+  if (nameCount == nameCap)
+  { nameCap = nameCap ? nameCap*2 : 256;
+    names = (char **) realloc(names,nameCap*sizeof(char *));
+    nameNext = (int *) realloc(nameNext,nameCap*sizeof(int));
+    if ((names == NULL) || (nameNext == NULL))
+    { fprintf(listing,"Out of memory error at line %d\n",lineno);
+      exit(1);
+    }
+  }
+  names[nameCount] = (char *) malloc(len+1);
+  if (names[nameCount] == NULL)
+  { fprintf(listing,"Out of memory error at line %d\n",lineno);
+    exit(1);
+  }
+  memcpy(names[nameCount],s,len);
+  names[nameCount][len] = '\0';
+  nameNext[nameCount] = nameHash[h];
+  nameHash[h] = nameCount++;
+  if (nameCount > hashSize) rehash(hashSize*2);
+  return nameCount-1;
+}
+
+/* Function internName returns the interned string
+ * with index value
+ */
+char * internName( int value )
+{ return names[value]; }
+
+/* Function internCount returns the number of
+ * strings in the intern table
+ */
+int internCount( void )
+{ return nameCount; }
+
+/* Procedure useTokens makes the token buffer and the
+ * intern table refer to an existing token stream
+ */
+void useTokens( TokenRec * toks, int ntoks, char ** strs, int nstrs )
+{ int size;
+  tokenBuf = toks;
+  tokenCount = ntoks;
+  tokenCap = ntoks;
+  tokenPos = 0;
+  names = strs;
+  nameCount = nstrs;
+  nameCap = nstrs;
+  /* the chains are rebuilt over the new names, so
+   * that interning later finds them
+   */
+  for (size=1024;size<nameCount;size*=2);
+  rehash(size);
+}
+
+/* Procedure resetTokens empties the token buffer */
+void resetTokens( void )
+{ tokenCount = 0;
+  tokenPos = 0;
+}
+
+/* Function appendToken adds a token to the end of
+ * the token buffer and returns its index
+ */
+int appendToken( TokenType kind, int offset, int length,
+                 int line, const char * text )
+{ TokenRec * t;
+  if (tokenCount == tokenCap)
+  { tokenCap = tokenCap ? tokenCap*2 : INITTOKENS;
+    tokenBuf = (TokenRec *) realloc(tokenBuf,tokenCap*sizeof(TokenRec));
+    if (tokenBuf == NULL)
+    { fprintf(listing,"Out of memory error at line %d\n",lineno);
+      exit(1);
+    }
+  }
+  t = &tokenBuf[tokenCount];
+  t->kind = kind;
+  t->offset = offset;
+  t->length = length;
+  t->lineno = line;
+  t->value = internString(text,length);
+  return tokenCount++;
+}
+
+/* Function tokenText returns the lexeme of the
+ * token at index i
+ */
+char * tokenText( int i )
+{ return names[tokenBuf[i].value]; }
+
+/* Function tokenLine returns the source line of
+ * the token at index i
+ */
+int tokenLine( int i )
+{ return tokenBuf[i].lineno; }
@@ -0,0 +1,80 @@
+/****************************************************/
+/* File: token.h                                    */
+/* Token buffer interface for the C-MINUS compiler  */
+/* The scanner appends every token it recognizes    */
+/* to a single buffer which the parser then reads   */
+/* by index, so lexemes are never copied around     */
+/****************************************************/
+
+#ifndef _TOKEN_H_
+#define _TOKEN_H_
+
+/* TokenRec describes one token of the source
+ * program. All fields are plain ints so that a
+ * token stream can be stored in a file and used
+ * again without any conversion
+ */
+typedef struct
+   { int kind;   /* TokenType of the token */
+     int offset; /* byte offset of the lexeme in the source */
+     int length; /* length of the lexeme in bytes */
+     int lineno; /* source line the token was found on */
+     int value;  /* intern index of the lexeme */
+   } TokenRec;
+
+/* tokenBuf holds the tokens recognized so far,
+ * tokenCount is the number of valid entries and
+ * tokenPos the index of the next token to be
+ * handed to the parser
+ */
+extern TokenRec * tokenBuf;
+extern int tokenCount;
+extern int tokenPos;
+
+/* Function internString returns the intern index
+ * of the string s of length len, entering a new
+ * copy of it in the intern table if necessary
+ */
+int internString( const char * s, int len );
+
+/* Function internName returns the interned string
+ * with index value
+ */
+char * internName( int value );
+
+/* Function appendToken adds a token to the end of
+ * the token buffer and returns its index
+ */
+int appendToken( TokenType kind, int offset, int length,
+                 int line, const char * text );
+
+/* Function internCount returns the number of
+ * strings in the intern table
+ */
+int internCount( void );
+
+/* Procedure useTokens makes the token buffer and the
+ * intern table refer to an existing token stream of
+ * ntoks tokens whose lexemes are the nstrs strings
+ * in strs (e.g. one mapped from a token cache file).
+ * The stream must end with an ENDFILE token, and
+ * strings interned afterwards are found among strs
+ */
+void useTokens( TokenRec * toks, int ntoks, char ** strs, int nstrs );
+
+/* Procedure resetTokens empties the token buffer.
+ * The intern table is kept
+ */
+void resetTokens( void );
+
+/* Function tokenText returns the lexeme of the
+ * token at index i
+ */
+char * tokenText( int i );
+
+/* Function tokenLine returns the source line of
+ * the token at index i
+ */
+int tokenLine( int i );
+
+#endif
@@ -8,6 +8,7 @@
 
 #include "globals.h"
 #include "util.h"
+#include "outbuf.h"
 
 /* Procedure printToken prints a token 
  * and its lexeme to the listing file
@@ -20,43 +21,50 @@ void printToken( TokenType token, const char* tokenString )
     case RETURN:
     case INT:
     case VOID:
-      fprintf(listing,
-         "reserved word: %s\n",tokenString);
+      outStr(listing,"reserved word: ");
+      outStr(listing,tokenString);
+      outChar(listing,'\n');
       break;
-    case ASSIGN: fprintf(listing,"=\n"); break;
-    case LT: fprintf(listing,"<\n"); break;
-    case LE: fprintf(listing,"<=\n"); break;
-    case GT: fprintf(listing,">\n"); break;
-    case GE: fprintf(listing,">=\n"); break;
-    case EQ: fprintf(listing,"==\n"); break;
-    case NE: fprintf(listing,"!=\n"); break;
-    case LPAREN: fprintf(listing,"(\n"); break;
-    case RPAREN: fprintf(listing,")\n"); break;
-    case LBRACE: fprintf(listing,"[\n"); break;
-    case RBRACE: fprintf(listing,"]\n"); break;
-    case LCURLY: fprintf(listing,"{\n"); break;
-    case RCURLY: fprintf(listing,"}\n"); break;
-    case SEMI: fprintf(listing,";\n"); break;
-    case COMMA: fprintf(listing,",\n"); break;
-    case PLUS: fprintf(listing,"+\n"); break;
-    case MINUS: fprintf(listing,"-\n"); break;
-    case TIMES: fprintf(listing,"*\n"); break;
-    case OVER: fprintf(listing,"/\n"); break;
-    case ENDFILE: fprintf(listing,"EOF\n"); break;
+    case ASSIGN: outStr(listing,"=\n"); break;
+    case LT: outStr(listing,"<\n"); break;
+    case LE: outStr(listing,"<=\n"); break;
+    case GT: outStr(listing,">\n"); break;
+    case GE: outStr(listing,">=\n"); break;
+    case EQ: outStr(listing,"==\n"); break;
+    case NE: outStr(listing,"!=\n"); break;
+    case LPAREN: outStr(listing,"(\n"); break;
+    case RPAREN: outStr(listing,")\n"); break;
+    case LBRACE: outStr(listing,"[\n"); break;
+    case RBRACE: outStr(listing,"]\n"); break;
+    case LCURLY: outStr(listing,"{\n"); break;
+    case RCURLY: outStr(listing,"}\n"); break;
+    case SEMI: outStr(listing,";\n"); break;
+    case COMMA: outStr(listing,",\n"); break;
+    case PLUS: outStr(listing,"+\n"); break;
+    case MINUS: outStr(listing,"-\n"); break;
+    case TIMES: outStr(listing,"*\n"); break;
+    case OVER: outStr(listing,"/\n"); break;
+    case ENDFILE: outStr(listing,"EOF\n"); break;
     case NUM:
-      fprintf(listing,
-          "NUM, val= %s\n",tokenString);
+      outStr(listing,"NUM, val= ");
+      outStr(listing,tokenString);
+      outChar(listing,'\n');
       break;
     case ID:
-      fprintf(listing,
-          "ID, name= %s\n",tokenString);
+      outStr(listing,"ID, name= ");
+      outStr(listing,tokenString);
+      outChar(listing,'\n');
       break;
     case ERROR:
-      fprintf(listing,
-          "ERROR: %s\n",tokenString);
+      outStr(listing,"ERROR: ");
+      outStr(listing,tokenString);
+      outChar(listing,'\n');
       break;
     default: /* should never happen */
-      fprintf(listing,"Unknown token: %d\n",token);
+    { outStr(listing,"Unknown token: ");
+      outInt(listing,token);
+      outChar(listing,'\n');
+    }
   }
 }
 
@@ -67,7 +75,9 @@ TreeNode * newStmtNode(StmtKind kind)
 { TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode));
   int i;
   if (t==NULL)
+  { outFlush();
     fprintf(listing,"Out of memory error at line %d\n",lineno);
+  }
   else {
     for (i=0;i<MAXCHILDREN;i++) t->child[i] = NULL;
     t->sibling = NULL;
@@ -85,7 +95,9 @@ TreeNode * newExpNode(ExpKind kind)
 { TreeNode * t = (TreeNode *) malloc(sizeof(TreeNode));
   int i;
   if (t==NULL)
+  { outFlush();
     fprintf(listing,"Out of memory error at line %d\n",lineno);
+  }
   else {
     for (i=0;i<MAXCHILDREN;i++) t->child[i] = NULL;
     t->sibling = NULL;
@@ -107,11 +119,35 @@ char * copyString(char * s)
   n = strlen(s)+1;
   t = malloc(n);
   if (t==NULL)
+  { outFlush();
     fprintf(listing,"Out of memory error at line %d\n",lineno);
+  }
   else strcpy(t,s);
   return t;
 }
 
+/* Function readFile reads the remainder of file f
+ * into a newly allocated buffer and rewinds f
+ */
+char * readFile( FILE * f, long * len )
+{ char * buf;
+  long n = 0, cap = 65536, got;
+  buf = (char *) malloc(cap+1);
+  if (buf == NULL) return NULL;
+  while ((got = fread(buf+n,1,cap-n,f)) > 0)
+  { n += got;
+    if (n == cap)
+    { cap *= 2;
+      buf = (char *) realloc(buf,cap+1);
+      if (buf == NULL) return NULL;
+    }
+  }
+  buf[n] = '\0';
+  rewind(f);
+  *len = n;
+  return buf;
+}
+
 /* Variable indentno is used by printTree to
  * store current number of spaces to indent
  */
@@ -123,9 +159,7 @@ static indentno = 0;
 
 /* printSpaces indents by printing spaces */
 static void printSpaces(void)
-{ int i;
-  for (i=0;i<indentno;i++)
-    fprintf(listing," ");
+{ outPadStr(listing,"",indentno);
 }
 
 /* procedure printTree prints a syntax tree to the 
@@ -139,115 +173,127 @@ void printTree( TreeNode * tree )
     if (tree->nodekind==StmtK)
     { switch (tree->kind.stmt) {
         case IfK:
-          fprintf(listing,"If Statement:\n");
+          outStr(listing,"If Statement:\n");
           break;
         case IfElseK:
-          fprintf(listing,"If-Else Statement:\n");
+          outStr(listing,"If-Else Statement:\n");
           break;
         case WhileK:
-          fprintf(listing,"While Statement:\n");
+          outStr(listing,"While Statement:\n");
           break;
         case ReturnK:
-          fprintf(listing,"Return Statement:\n");
+          outStr(listing,"Return Statement:\n");
           break;
         case NReturnK:
-          fprintf(listing,"Non-value Return Statement:\n");
+          outStr(listing,"Non-value Return Statement:\n");
           break;
         case AssignK:
-          fprintf(listing,"Assign:\n");
+          outStr(listing,"Assign:\n");
           break;
         case VarDeclK:
-          fprintf(listing,"Variable Declaration: name = %s, ", tree->attr.name);
+          outStr(listing,"Variable Declaration: name = ");
+          outStr(listing,tree->attr.name);
+          outStr(listing,", ");
           switch(tree->type){
             case Void:
-              fprintf(listing, "type = void\n");
+              outStr(listing,"type = void\n");
               break;
             case Integer:
-              fprintf(listing, "type = int\n");
+              outStr(listing,"type = int\n");
               break;
             case VoidPtr:
-              fprintf(listing, "type = void[]\n");
+              outStr(listing,"type = void[]\n");
               break;
             case IntegerPtr:
-              fprintf(listing, "type = int[]\n");
+              outStr(listing,"type = int[]\n");
               break;
             default:
-              fprintf(listing,"Unknown Type\n");
+              outStr(listing,"Unknown Type\n");
               break;
           }
           break;
         case FunDeclK:
-          fprintf(listing, "Function Declaration: name = %s, ", tree->attr.name);
+          outStr(listing,"Function Declaration: name = ");
+          outStr(listing,tree->attr.name);
+          outStr(listing,", ");
           switch(tree->type){
           case Void:
-            fprintf(listing, "return type = void\n");
+            outStr(listing,"return type = void\n");
             break;
           case Integer:
-            fprintf(listing, "return type = int\n");
+            outStr(listing,"return type = int\n");
             break;
           case VoidPtr:
-            fprintf(listing, "return type = void[]\n");
+            outStr(listing,"return type = void[]\n");
             break;
           case IntegerPtr:
-            fprintf(listing, "return type = int[]\n");
+            outStr(listing,"return type = int[]\n");
             break;
           default:
-            fprintf(listing,"Unknown Type\n");
+            outStr(listing,"Unknown Type\n");
             break;
           }
           break;
         case VoidParamK:
-          fprintf(listing, "Void Parameter\n");
+          outStr(listing,"Void Parameter\n");
           break;
         case ParamK:
-          fprintf(listing,"Parameter: name = %s, ", tree->attr.name);
+          outStr(listing,"Parameter: name = ");
+          outStr(listing,tree->attr.name);
+          outStr(listing,", ");
           switch(tree->type){
             case Void:
-              fprintf(listing, "type = void\n");
+              outStr(listing,"type = void\n");
               break;
             case Integer:
-              fprintf(listing, "type = int\n");
+              outStr(listing,"type = int\n");
               break;
             case VoidPtr:
-              fprintf(listing, "type = void[]\n");
+              outStr(listing,"type = void[]\n");
               break;
             case IntegerPtr:
-              fprintf(listing, "type = int[]\n");
+              outStr(listing,"type = int[]\n");
               break;
             default:
-              fprintf(listing,"Unknown Type\n");
+              outStr(listing,"Unknown Type\n");
               break;
           }
           break;
         case CompoundK:
-          fprintf(listing, "Compound Statement:\n");
+          outStr(listing,"Compound Statement:\n");
           break;
         case CallK:
-          fprintf(listing, "Call: function name = %s\n", tree->attr.name);
+          outStr(listing,"Call: function name = ");
+          outStr(listing,tree->attr.name);
+          outChar(listing,'\n');
           break;
         default:
-          fprintf(listing,"Unknown StmtNode kind\n");
+          outStr(listing,"Unknown StmtNode kind\n");
           break;
       }
     }
     else if (tree->nodekind==ExpK)
     { switch (tree->kind.exp) {
         case OpK:
-          fprintf(listing,"Op: ");
+          outStr(listing,"Op: ");
           printToken(tree->attr.op,"\0");
           break;
         case ConstK:
-          fprintf(listing,"Const: %d\n",tree->attr.val);
+          outStr(listing,"Const: ");
+          outInt(listing,tree->attr.val);
+          outChar(listing,'\n');
           break;
         case IdK:
-          fprintf(listing,"Variable: name = %s\n",tree->attr.name);
+          outStr(listing,"Variable: name = ");
+          outStr(listing,tree->attr.name);
+          outChar(listing,'\n');
           break;
         default:
-          fprintf(listing,"Unknown ExpNode kind\n");
+          outStr(listing,"Unknown ExpNode kind\n");
           break;
       }
     }
-    else fprintf(listing,"Unknown node kind\n");
+    else outStr(listing,"Unknown node kind\n");
     for (i=0;i<MAXCHILDREN;i++)
          printTree(tree->child[i]);
     tree = tree->sibling;
@@ -28,6 +28,13 @@ TreeNode * newExpNode(ExpKind);
  */
 char * copyString( char * );
 
+/* Function readFile reads the remainder of file f
+ * into a newly allocated buffer, storing its length
+ * in *len, and rewinds f. Returns NULL if out of
+ * memory
+ */
+char * readFile( FILE * f, long * len );
+
 /* procedure printTree prints a syntax tree to the 
  * listing file using indentation to indicate subtrees
  */